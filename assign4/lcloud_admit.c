@@ -0,0 +1,225 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_admit.c
+//  Description    : This is the implementation of the cache admission filter
+//                   for the Lion Cloud filesystem.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project include files
+#include <lcloud_admit.h>
+
+// Information
+//
+// The frequencies are kept in a count-min sketch: LC_ADMIT_DEPTH rows of
+// small counters, each row indexed by its own hash of the block.  A block's
+// estimate is its smallest counter, and only the smallest counters are
+// raised (conservative update), which keeps collisions from inflating it.
+//
+// Every LC_ADMIT_SAMPLE_PER_BLOCK accesses per block of cache all counters
+// are halved, so the counts follow what is used now and not what was used
+// at the start of the run.
+//
+
+// The sketch
+static uint8_t *Admit_Counters = NULL;  // LC_ADMIT_DEPTH rows of Admit_Width counters
+static uint32_t Admit_Mask = 0;         // Admit_Width - 1 (a power of 2)
+static uint32_t Admit_Sample = 0;       // Accesses between agings
+static uint32_t Admit_Additions = 0;    // Accesses since the last aging
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : admit_index
+// Description  : The counter of a block in one row.
+//
+// Inputs       : key - the block's address, row - the row
+// Outputs      : the index into Admit_Counters
+static uint32_t admit_index( uint64_t key, int row ) {
+    key += (uint64_t)(row + 1) * 0x9e3779b97f4a7c15ull;
+    key ^= key >> 30;
+    key *= 0xbf58476d1ce4e5b9ull;
+    key ^= key >> 27;
+    key *= 0x94d049bb133111ebull;
+    key ^= key >> 31;
+    return (uint32_t)row * (Admit_Mask + 1) + ((uint32_t)key & Admit_Mask);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : admit_key
+// Description  : Pack a block's address into one number.
+//
+// Inputs       : did, sec, blk - the block
+// Outputs      : the key
+static uint64_t admit_key( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    return ((uint64_t)did << 32) | ((uint64_t)sec << 16) | blk;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_admit_init
+// Description  : Create an empty filter sized for the cache.
+//
+// Inputs       : maxblocks - the blocks in the cache
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_admit_init( int maxblocks ) {
+    uint32_t width = 64;
+
+    lcloud_admit_close();
+    while (width < (uint32_t)maxblocks * LC_ADMIT_WIDTH_PER_BLOCK) {
+        width *= 2;
+    }
+    Admit_Counters = calloc(LC_ADMIT_DEPTH, width);
+    if (Admit_Counters == NULL) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Admission filter: out of memory");
+        return -1;
+    }
+    Admit_Mask = width - 1;
+    Admit_Sample = maxblocks * LC_ADMIT_SAMPLE_PER_BLOCK;
+    Admit_Additions = 0;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_admit_resize
+// Description  : Size the filter for a cache that changed size, keeping what
+//                it has counted.  The widths are powers of 2, so a counter
+//                of the new width only ever shares its place with counters
+//                of the old width that had its low bits: a wider row copies
+//                them, a narrower one keeps the largest (no estimate drops).
+//
+// Inputs       : maxblocks - the blocks in the cache now
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_admit_resize( int maxblocks ) {
+    uint32_t width = 64, old_width = Admit_Mask + 1;
+    uint8_t *counters;
+
+    if (Admit_Counters == NULL) {
+        return lcloud_admit_init(maxblocks);
+    }
+    while (width < (uint32_t)maxblocks * LC_ADMIT_WIDTH_PER_BLOCK) {
+        width *= 2;
+    }
+    if (width != old_width) {
+        counters = calloc(LC_ADMIT_DEPTH, width);
+        if (counters == NULL) {
+            logMessage(LOG_ERROR_LEVEL, "           ### Admission filter: out of memory");
+            return -1;
+        }
+        for (uint32_t row = 0; row < LC_ADMIT_DEPTH; row++) {
+            uint8_t *from = Admit_Counters + row * old_width, *to = counters + row * width;
+            for (uint32_t i = 0; i < width || i < old_width; i++) {
+                if (width > old_width) {
+                    to[i] = from[i & (old_width - 1)];
+                }
+                else if (from[i] > to[i & (width - 1)]) {
+                    to[i & (width - 1)] = from[i];
+                }
+            }
+        }
+        free(Admit_Counters);
+        Admit_Counters = counters;
+        Admit_Mask = width - 1;
+    }
+    Admit_Sample = maxblocks * LC_ADMIT_SAMPLE_PER_BLOCK;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_admit_record
+// Description  : Count one access to a block, aging the sketch when the
+//                sample is complete.
+//
+// Inputs       : did, sec, blk - the block
+// Outputs      : none
+void lcloud_admit_record( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    uint64_t key = admit_key(did, sec, blk);
+    uint32_t index[LC_ADMIT_DEPTH];
+    int least = LC_ADMIT_MAX_COUNT;
+
+    if (Admit_Counters == NULL) {
+        return;
+    }
+    for (int row = 0; row < LC_ADMIT_DEPTH; row++) {
+        index[row] = admit_index(key, row);
+        if (Admit_Counters[index[row]] < least) {
+            least = Admit_Counters[index[row]];
+        }
+    }
+    if (least < LC_ADMIT_MAX_COUNT) {
+        for (int row = 0; row < LC_ADMIT_DEPTH; row++) {
+            if (Admit_Counters[index[row]] == least) {
+                Admit_Counters[index[row]]++;
+            }
+        }
+    }
+
+    if (++Admit_Additions >= Admit_Sample) {
+        for (uint32_t i = 0; i < LC_ADMIT_DEPTH * (Admit_Mask + 1); i++) {
+            Admit_Counters[i] >>= 1;
+        }
+        Admit_Additions /= 2;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_admit_estimate
+// Description  : How often the block has been used lately.
+//
+// Inputs       : did, sec, blk - the block
+// Outputs      : the estimate (never below the real count)
+int lcloud_admit_estimate( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    uint64_t key = admit_key(did, sec, blk);
+    int least = LC_ADMIT_MAX_COUNT;
+
+    if (Admit_Counters == NULL) {
+        return 0;
+    }
+    for (int row = 0; row < LC_ADMIT_DEPTH; row++) {
+        int count = Admit_Counters[admit_index(key, row)];
+        if (count < least) {
+            least = count;
+        }
+    }
+    return least;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_admit
+// Description  : Decide if a new block should take the victim's place.  It
+//                has to have been used more often lately than the victim.
+//
+// Inputs       : did, sec, blk - the new block
+//                vdid, vsec, vblk - the block it would replace
+// Outputs      : 1 if the new block goes in, 0 if the victim stays
+int lcloud_admit( LcDeviceId did, uint16_t sec, uint16_t blk,
+                  LcDeviceId vdid, uint16_t vsec, uint16_t vblk ) {
+    if (Admit_Counters == NULL) {
+        return 1;
+    }
+    return lcloud_admit_estimate(did, sec, blk) > lcloud_admit_estimate(vdid, vsec, vblk);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_admit_close
+// Description  : Release the filter.
+//
+// Inputs       : none
+// Outputs      : none
+void lcloud_admit_close( void ) {
+    free(Admit_Counters);
+    Admit_Counters = NULL;
+    Admit_Mask = 0;
+}
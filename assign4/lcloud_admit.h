@@ -0,0 +1,48 @@
+#ifndef LCLOUD_ADMIT_INCLUDED
+#define LCLOUD_ADMIT_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_admit.h
+//  Description    : This is the admission filter for the Lion Cloud cache
+//                   (TinyLFU).  It estimates how often each block has been
+//                   used lately, so a block used once does not push out one
+//                   that is used again and again.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+#include <lcloud_controller.h>
+
+// Defines
+#define LC_ADMIT_DEPTH 4          // Rows of the count-min sketch
+#define LC_ADMIT_WIDTH_PER_BLOCK 8 // Counters per row for each block of cache
+#define LC_ADMIT_SAMPLE_PER_BLOCK 10 // Accesses per block of cache between agings
+#define LC_ADMIT_MAX_COUNT 15     // Counters stop here (4 bits worth)
+
+//
+// Functional Prototypes
+
+int lcloud_admit_init( int maxblocks );
+    // Size the filter for a cache of maxblocks blocks
+
+int lcloud_admit_resize( int maxblocks );
+    // Size the filter for a cache that changed size (keeping the counts)
+
+void lcloud_admit_record( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Count one access to a block
+
+int lcloud_admit_estimate( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // How often the block has been used lately
+
+int lcloud_admit( LcDeviceId did, uint16_t sec, uint16_t blk,
+                  LcDeviceId vdid, uint16_t vsec, uint16_t vblk );
+    // Check if a new block should replace the victim
+
+void lcloud_admit_close( void );
+    // Release the filter
+
+#endif
@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_arena.c
+//  Description    : This is the implementation of the arena allocator for the
+//                   Lion Cloud filesystem.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdlib.h>
+
+// Project include files
+#include <lcloud_arena.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : arena_chunk
+// Description  : Start a new chunk big enough for a request.
+//
+// Inputs       : arena - the arena, bytes - the request
+// Outputs      : 0 if successful, -1 if out of memory
+static int arena_chunk( LcArena *arena, size_t bytes ) {
+    size_t size = (bytes > LC_ARENA_CHUNK) ? bytes : LC_ARENA_CHUNK;
+    LcArenaChunk *chunk = malloc(sizeof(LcArenaChunk));
+
+    if (chunk == NULL) {
+        return -1;
+    }
+    if (posix_memalign((void **)&chunk->data, LC_ARENA_ALIGN, size) != 0) {
+        free(chunk);
+        return -1;
+    }
+    chunk->size = size;
+    chunk->used = 0;
+    chunk->next = arena->chunks;
+    arena->chunks = chunk;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_arena_alloc
+// Description  : Get bytes from the arena, aligned to LC_ARENA_ALIGN.  Only
+//                a full chunk costs a malloc.
+//
+// Inputs       : arena - the arena, bytes - the size wanted
+// Outputs      : the memory, NULL if out of memory
+void * lcloud_arena_alloc( LcArena *arena, size_t bytes ) {
+    LcArenaChunk *chunk = arena->chunks;
+
+    bytes = (bytes + LC_ARENA_ALIGN - 1) & ~((size_t)LC_ARENA_ALIGN - 1);
+    if (chunk == NULL || chunk->size - chunk->used < bytes) {
+        if (arena_chunk(arena, bytes) != 0) {
+            return NULL;
+        }
+        chunk = arena->chunks;
+    }
+    chunk->used += bytes;
+    return chunk->data + chunk->used - bytes;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_arena_reset
+// Description  : Give back everything handed out.  The oldest chunk is kept
+//                (empty) so the next use does not have to malloc again.
+//
+// Inputs       : arena - the arena
+// Outputs      : none
+void lcloud_arena_reset( LcArena *arena ) {
+    while (arena->chunks != NULL && arena->chunks->next != NULL) {
+        LcArenaChunk *chunk = arena->chunks;
+        arena->chunks = chunk->next;
+        free(chunk->data);
+        free(chunk);
+    }
+    if (arena->chunks != NULL) {
+        arena->chunks->used = 0;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_arena_close
+// Description  : Give back everything, chunks included.
+//
+// Inputs       : arena - the arena
+// Outputs      : none
+void lcloud_arena_close( LcArena *arena ) {
+    lcloud_arena_reset(arena);
+    if (arena->chunks != NULL) {
+        free(arena->chunks->data);
+        free(arena->chunks);
+        arena->chunks = NULL;
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef LCLOUD_ARENA_INCLUDED
+#define LCLOUD_ARENA_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_arena.h
+//  Description    : This is a simple arena (bump) allocator for the Lion
+//                   Cloud filesystem.  Memory is handed out from large
+//                   chunks and given back all at once, so the I/O paths do
+//                   not call malloc.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stddef.h>
+
+// Defines
+#define LC_ARENA_ALIGN 64            // Every allocation starts on a CPU cache line
+#define LC_ARENA_CHUNK (64 * 1024)   // The size of a chunk (bigger requests get their own)
+
+// One chunk of an arena
+typedef struct LcArenaChunk {
+    struct LcArenaChunk *next;  // The chunk filled before this one
+    size_t size;                // Bytes in data
+    size_t used;                // Bytes handed out
+    char *data;
+} LcArenaChunk;
+
+// An arena
+typedef struct {
+    LcArenaChunk *chunks;   // The chunk being filled (NULL if none yet)
+} LcArena;
+
+//
+// Functional Prototypes
+
+void * lcloud_arena_alloc( LcArena *arena, size_t bytes );
+    // Get bytes from the arena (NULL if out of memory)
+
+void lcloud_arena_reset( LcArena *arena );
+    // Give back everything, keeping the first chunk for reuse
+
+void lcloud_arena_close( LcArena *arena );
+    // Give back everything, chunks included
+
+#endif
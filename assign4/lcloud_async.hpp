@@ -0,0 +1,269 @@
+#ifndef LCLOUD_ASYNC_INCLUDED
+#define LCLOUD_ASYNC_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_async.hpp
+//  Description    : This is the coroutine (C++20) interface to the Lion
+//                   Cloud filesystem.  co_open, co_read, co_write ... are
+//                   awaited from a coroutine, which suspends while the
+//                   reactor's I/O threads drive the bus, and is resumed by
+//                   the thread running the reactor when the operation is
+//                   done.  One thread running the reactor can have any
+//                   number of operations outstanding.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <condition_variable>
+#include <coroutine>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <lcloud_file.hpp>
+
+namespace lcloud {
+
+// Information
+//
+// The bus is one connection shared by every file and the filesystem takes
+// one call at a time, so an operation is the unit that waits: it is queued
+// for the I/O threads (it lives in the awaiting coroutine's frame, so the
+// queues are linked through it and nothing is allocated), run there with
+// the blocking C call, and queued back.  run() and poll() resume the
+// coroutines of the finished operations on the calling thread, and so
+// does the reactor's destructor for any still out.
+//
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Class        : LcOperation
+// Description  : One operation waiting on the reactor.
+//
+class LcOperation {
+public:
+    virtual void execute() noexcept = 0;    // Run the call (on an I/O thread)
+
+    LcOperation *next = nullptr;            // The one after it in its queue
+    std::coroutine_handle<> waiter;         // The coroutine to resume
+
+protected:
+    ~LcOperation() = default;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Class        : LcReactor
+// Description  : The I/O threads and the queues of operations to run and
+//                operations done.
+//
+class LcReactor {
+public:
+    explicit LcReactor( int threads = 1 ) {
+        for (int i = 0; i < (threads > 0 ? threads : 1); i++) {
+            workers_.emplace_back([this] { work(); });
+        }
+    }
+
+    LcReactor( const LcReactor & ) = delete;
+    LcReactor & operator=( const LcReactor & ) = delete;
+
+    // Finish the operations still out first, resuming their coroutines
+    // here (what they queue next is finished too), so no coroutine is
+    // left suspended on the reactor.  Then stop the I/O threads.
+    ~LcReactor() {
+        run();
+        {
+            std::lock_guard<std::mutex> hold(lock_);
+            stopping_ = true;
+        }
+        submitted_.notify_all();
+        for (std::thread &worker : workers_) {
+            worker.join();
+        }
+    }
+
+    // Queue an operation for the I/O threads
+    void submit( LcOperation *op ) noexcept {
+        {
+            std::lock_guard<std::mutex> hold(lock_);
+            push(todo_, op);
+            outstanding_++;
+        }
+        submitted_.notify_one();
+    }
+
+    // Resume the coroutines of the operations done (never waits)
+    int poll() {
+        return resume(take(false));
+    }
+
+    // Wait for an operation to finish, then resume those done (0 if none is out)
+    int run_once() {
+        return resume(take(true));
+    }
+
+    // Resume coroutines until no operation is out
+    void run() {
+        while (run_once() > 0) {
+        }
+    }
+
+    // Operations submitted and not yet resumed
+    int outstanding() const {
+        std::lock_guard<std::mutex> hold(lock_);
+        return outstanding_;
+    }
+
+private:
+    struct Queue {
+        LcOperation *head = nullptr;
+        LcOperation *tail = nullptr;
+    };
+
+    static void push( Queue &q, LcOperation *op ) noexcept {
+        op->next = nullptr;
+        (q.tail != nullptr ? q.tail->next : q.head) = op;
+        q.tail = op;
+    }
+
+    // Take the whole list of done operations (waiting for one if asked)
+    LcOperation * take( bool wait ) {
+        std::unique_lock<std::mutex> hold(lock_);
+        if (wait) {
+            completed_.wait(hold, [this] { return done_.head != nullptr || outstanding_ == 0; });
+        }
+        LcOperation *list = done_.head;
+        for (LcOperation *op = list; op != nullptr; op = op->next) {
+            outstanding_--;
+        }
+        done_ = Queue();
+        return list;
+    }
+
+    static int resume( LcOperation *list ) {
+        int count = 0;
+        while (list != nullptr) {
+            LcOperation *op = list;
+            list = op->next;        // The coroutine may free op when resumed
+            op->waiter.resume();
+            count++;
+        }
+        return count;
+    }
+
+    // An I/O thread: run what is queued until the reactor stops
+    void work() {
+        std::unique_lock<std::mutex> hold(lock_);
+        for (;;) {
+            submitted_.wait(hold, [this] { return stopping_ || todo_.head != nullptr; });
+            if (stopping_) {
+                return;
+            }
+            LcOperation *op = todo_.head;
+            todo_.head = op->next;
+            if (todo_.head == nullptr) {
+                todo_.tail = nullptr;
+            }
+            hold.unlock();
+            op->execute();
+            hold.lock();
+            push(done_, op);
+            completed_.notify_all();
+        }
+    }
+
+    mutable std::mutex lock_;
+    std::condition_variable submitted_;     // Signalled when todo_ gets an operation
+    std::condition_variable completed_;     // Signalled when done_ gets one
+    Queue todo_, done_;
+    int outstanding_ = 0;
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Class        : LcAwait
+// Description  : The awaitable of one call: co_await runs call on the
+//                reactor and gives back what it returned.
+//
+template <typename Call>
+class LcAwait final : public LcOperation {
+public:
+    using Result = std::invoke_result_t<Call &>;
+
+    LcAwait( LcReactor &reactor, Call call ) : reactor_(reactor), call_(std::move(call)) {}
+
+    bool await_ready() const noexcept { return false; }
+
+    void await_suspend( std::coroutine_handle<> handle ) noexcept {
+        waiter = handle;
+        reactor_.submit(this);
+    }
+
+    Result await_resume() noexcept { return std::move(result_); }
+
+private:
+    void execute() noexcept override { result_ = call_(); }
+
+    LcReactor &reactor_;
+    Call call_;
+    Result result_{};
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Class        : LcTask
+// Description  : A coroutine that starts at once and is not waited on (its
+//                frame goes away when it returns).
+//
+struct LcTask {
+    struct promise_type {
+        LcTask get_return_object() noexcept { return {}; }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() noexcept {}
+        void unhandled_exception() noexcept { std::terminate(); }
+    };
+};
+
+//
+// The operations (the file and the data must outlast the co_await)
+
+inline auto co_open( LcReactor &reactor, const char *path ) {
+    return LcAwait(reactor, [path] { return LcFile::open(path); });
+}
+
+inline auto co_close( LcReactor &reactor, LcFile &file ) {
+    return LcAwait(reactor, [&file] { return file.close(); });
+}
+
+inline auto co_seek( LcReactor &reactor, LcFile &file, std::size_t off ) {
+    return LcAwait(reactor, [&file, off] { return file.seek(off); });
+}
+
+inline auto co_read( LcReactor &reactor, LcFile &file, std::span<std::byte> out ) {
+    return LcAwait(reactor, [&file, out] { return file.read(out); });
+}
+
+inline auto co_write( LcReactor &reactor, LcFile &file, std::span<const std::byte> in ) {
+    return LcAwait(reactor, [&file, in] { return file.write(in); });
+}
+
+inline auto co_pread( LcReactor &reactor, LcFile &file, std::span<std::byte> out, std::size_t off ) {
+    return LcAwait(reactor, [&file, out, off] { return file.pread(out, off); });
+}
+
+inline auto co_pwrite( LcReactor &reactor, LcFile &file, std::span<const std::byte> in, std::size_t off ) {
+    return LcAwait(reactor, [&file, in, off] { return file.pwrite(in, off); });
+}
+
+} // namespace lcloud
+
+#endif
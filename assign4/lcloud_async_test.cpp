@@ -0,0 +1,131 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_async_test.cpp
+//  Description    : This is the test of the coroutine interface to the Lion
+//                   Cloud filesystem (lcloud_async.hpp).  Many coroutines
+//                   write, read back and close a file each, all waiting on
+//                   one reactor at the same time, and a reactor that goes
+//                   away with coroutines still waiting on it must finish
+//                   them (none left suspended, no frame leaked).  It talks
+//                   to a running lcloud_server, like lcloud_client:
+//
+//                     ./lcloud_server workload/cmpsc311-assign4e-manifest.txt &
+//                     make lcloud_async_test && ./lcloud_async_test 4
+//
+//                   (make clean first and add SANITIZE=-fsanitize=thread to
+//                   the make to run it under ThreadSanitizer)
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+extern "C" {
+#include <cmpsc311_log.h>
+}
+#include <lcloud_async.hpp>
+
+using namespace lcloud;
+
+// Defines
+#define TEST_COROUTINES 300     // Waiting on the reactor at once
+#define TEST_LEFT_WAITING 40    // Still waiting when their reactor goes away
+#define TEST_FILE_SIZE 700      // Bytes in each file (blocks and a part)
+
+// What the coroutines did.
+std::atomic<int> Test_Failures{0};
+std::atomic<int> Test_Finished{0};
+std::atomic<int> Test_Frames{0};    // Coroutine frames alive
+
+// Counts the frame it lives in (see Test_Frames).
+struct Frame_Count {
+    Frame_Count() { Test_Frames++; }
+    ~Frame_Count() { Test_Frames--; }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_file
+// Description  : One coroutine: write a file, read it back whole and in
+//                part, then close it.
+//
+// Inputs       : reactor - the reactor, id - which file
+// Outputs      : none (the counters above)
+LcTask test_file( LcReactor &reactor, int id ) {
+    Frame_Count live;
+    std::string name = "async" + std::to_string(id);
+    std::byte data[TEST_FILE_SIZE], back[TEST_FILE_SIZE];
+
+    for (int i = 0; i < TEST_FILE_SIZE; i++) {
+        data[i] = std::byte((i * id + 3) & 0xff);
+    }
+    LcFile file = co_await co_open(reactor, name.c_str());
+    if (!file) {
+        Test_Failures++;
+        co_return;
+    }
+    if (co_await co_write(reactor, file, data) != TEST_FILE_SIZE) {
+        Test_Failures++;
+    }
+    if (co_await co_pread(reactor, file, back, 0) != TEST_FILE_SIZE || memcmp(data, back, TEST_FILE_SIZE) != 0) {
+        Test_Failures++;
+    }
+    co_await co_seek(reactor, file, 100);
+    if (co_await co_read(reactor, file, std::span(back, 50)) != 50 || memcmp(back, data + 100, 50) != 0) {
+        Test_Failures++;
+    }
+    if (co_await co_close(reactor, file) != 0) {
+        Test_Failures++;
+    }
+    Test_Finished++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : Run the coroutines and check what they did.
+//
+// Inputs       : argc - the count of arguments, argv - the number of I/O
+//                threads (1 if not given)
+// Outputs      : 0 if every check passed, -1 if not
+int main( int argc, char *argv[] ) {
+    int threads = (argc > 1) ? atoi(argv[1]) : 1;
+    int waiting;
+
+    initializeLogWithFilename("lcloud_async_test.log");
+
+    // All of them waiting on one reactor, resumed by run() on this thread.
+    {
+        LcReactor reactor(threads);
+        for (int id = 0; id < TEST_COROUTINES; id++) {
+            test_file(reactor, id);
+        }
+        waiting = reactor.outstanding();
+        reactor.run();
+    }
+    printf("%i coroutines (%i waiting at once, %i I/O threads): %i finished\n",
+        TEST_COROUTINES, waiting, threads, Test_Finished.load());
+
+    // These are never run here, the reactor's destructor has to finish them.
+    {
+        LcReactor reactor(threads);
+        for (int id = 0; id < TEST_LEFT_WAITING; id++) {
+            test_file(reactor, TEST_COROUTINES + id);
+        }
+    }
+    printf("%i left waiting on a reactor that went away: %i finished, %i frames still alive\n",
+        TEST_LEFT_WAITING, Test_Finished.load() - TEST_COROUTINES, Test_Frames.load());
+
+    lcshutdown();
+    if (Test_Failures != 0 || Test_Finished != TEST_COROUTINES + TEST_LEFT_WAITING || Test_Frames != 0) {
+        printf("lcloud_async_test failed (%i bad results)\n", Test_Failures.load());
+        return( -1 );
+    }
+    printf("lcloud_async_test passed\n");
+    return( 0 );
+}
@@ -0,0 +1,105 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_blocks_test.c
+//  Description    : This is the test of the whole-block calls and the handle
+//                   checks of the Lion Cloud filesystem, on the fake bus
+//                   (lcloud_fakebus.c).  lcpread_blocks must stop at the end
+//                   of the file, lcpwrite_blocks must read nothing back and
+//                   (write-through) send its blocks in one round trip,
+//                   neither may move the head, and every call must refuse a
+//                   handle that is not a file:
+//
+//                     make lcloud_blocks_test && ./lcloud_blocks_test
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdio.h>
+#include <string.h>
+
+// Project include files
+#include <cmpsc311_log.h>
+#include <lcloud_filesys.h>
+#include <lcloud_fakebus.h>
+
+// Defines
+#define TEST_SIZE 10000         // Bytes in the test file (39 blocks and a part)
+
+// The filesystem's switches (see lcloud_filesys.c)
+extern int Write_Buffer_Blocks;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_check
+// Description  : Report one check.
+//
+// Inputs       : name - what it checks, ok - did it hold
+// Outputs      : 0 if it held, 1 if not
+static int test_check( const char *name, int ok ) {
+    printf("%s: %s\n", name, ok ? "passed" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : Run the whole-block tests.
+//
+// Inputs       : none
+// Outputs      : 0 if every test passed, 1 if not
+int main( void ) {
+    static char data[TEST_SIZE + 256], got[TEST_SIZE + 256];
+    LcFakeBusStats before, after;
+    int failures = 0, n;
+
+    initializeLogWithFilename("lcloud_blocks_test.log");
+    setvbuf(stdout, NULL, _IONBF, 0);
+    lcloud_fakebus_wipe();
+    Write_Buffer_Blocks = 0;
+    for (int at = 0; at < TEST_SIZE; at++) {
+        data[at] = (char)('a' + at * 7 % 26);
+    }
+    LcFHandle fh = lcopen("blocks");
+    if (fh < 0 || lcwrite(fh, data, TEST_SIZE) != TEST_SIZE || lcseek(fh, 17) != 17) {
+        printf("blocks: FAILED (the file could not be made)\n");
+        return 1;
+    }
+
+    // Reads, inside the file, over its end, and past it.
+    failures += test_check("read blocks", lcpread_blocks(fh, got, 2, 10) == 10 * 256 && memcmp(got, data + 2 * 256, 10 * 256) == 0);
+    n = TEST_SIZE - 36 * 256;
+    failures += test_check("read blocks over the end", lcpread_blocks(fh, got, 36, 4) == n && memcmp(got, data + 36 * 256, n) == 0);
+    failures += test_check("read blocks past the end", lcpread_blocks(fh, got, 50, 4) == 0);
+
+    // Whole blocks replaced: nothing read back, one round trip.
+    memset(data + 3 * 256, 'Z', 5 * 256);
+    lcloud_fakebus_stats(&before);
+    n = lcpwrite_blocks(fh, data + 3 * 256, 3, 5);
+    lcloud_fakebus_stats(&after);
+    failures += test_check("write blocks", n == 5 * 256);
+    failures += test_check("write blocks reads nothing back", after.reads == before.reads);
+    failures += test_check("write blocks in one round trip", after.round_trips - before.round_trips == 1);
+
+    // Blocks may extend the file, but not leave a hole.
+    memcpy(data + 39 * 256, data, 256);
+    failures += test_check("write blocks at the end", lcpwrite_blocks(fh, data, 39, 1) == 256);
+    failures += test_check("write blocks past the end", lcpwrite_blocks(fh, data, 45, 1) == -1);
+
+    // The head did not move, and the file holds it all.
+    failures += test_check("the head stays", lcread(fh, got, 10) == 10 && memcmp(got, data + 17, 10) == 0);
+    lcseek(fh, 0);
+    failures += test_check("the file after", lcread(fh, got, 40 * 256) == 40 * 256 && memcmp(got, data, 40 * 256) == 0);
+
+    // Handles that are not files.
+    failures += test_check("bad handles", lcread(0, got, 1) == -1 && lcread(5000, got, 1) == -1 &&
+                           lcwrite(-3, got, 1) == -1 && lcseek(77, 0) == -1 && lcclose(77) == -1 &&
+                           lcclose(2001) == -1 && lcpread_blocks(77, got, 0, 1) == -1 &&
+                           lcpwrite_blocks(-1, got, 0, 1) == -1);
+
+    lcclose(fh);
+    lcshutdown();
+    lcloud_fakebus_wipe();
+    return (failures == 0) ? 0 : 1;
+}
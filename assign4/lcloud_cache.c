@@ -8,44 +8,254 @@
 //   Last Modified : Thu 19 Mar 2020 09:27:55 AM EDT
 //
 
-// Includes 
+// Includes
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
 #include <cmpsc311_log.h>
 #include <lcloud_cache.h>
+#include <lcloud_admit.h>
+#include <lcloud_l2.h>
+#include <lcloud_crc32c.h>
 
 // Information
 //
-// 64 blocks of cache, defined as LC_CACHE_MAXBLOCKS
-// 
+// 64 blocks of cache, defined as LC_CACHE_MAXBLOCKS (the size given to
+// lcloud_initcache, which lcloud_resizecache can change)
+//
+// The cache is kept as a structure of arrays: a lookup only scans the
+// packed block addresses (8 bytes a slot), and the 256 byte blocks sit
+// apart in one 64-byte aligned slab, so they are only touched on a hit.
+//
+// If the local tier is open (lcloud_l2_open), every block that leaves the
+// cache goes there, and a miss looks there before the caller goes over the
+// bus.  A block is in one or the other, never both.
+//
+
+int Cache_Admission_Enabled = 0;  //<-- SET TO 1 TO ONLY LET IN BLOCKS USED MORE LATELY THAN THE ONE THEY PUSH OUT
+int Cache_Huge_Pages = 0;  //<-- SET TO 1 TO BACK THE CACHE'S BLOCKS WITH 2 MB HUGE PAGES (FALLS BACK TO 4 KB PAGES)
+int Cache_Numa_Interleave = 0;  //<-- SET TO 1 TO SPREAD THE CACHE'S BLOCKS OVER ALL THE NUMA NODES (NOT JUST THE FIRST TOUCH'S)
+
+// The part of the cache new blocks go into first (W-TinyLFU's window).
+#define LC_CACHE_WINDOW_PERCENT 20
+
+// The layout of the slab.
+#define LC_CACHE_ALIGN 64                   // Slots start on a CPU cache line
+#define LC_CACHE_HUGE_PAGE (2 * 1024 * 1024)
+#define LC_CACHE_MAX_NODES 64               // NUMA nodes in the interleave mask
+
+// Pack a block's address into one number.
+#define LC_CACHE_KEY(did, sec, blk) (((uint64_t)(did) << 32) | ((uint64_t)(sec) << 16) | (uint64_t)(blk))
+
+// Add one to a counter, for the block's device and for the whole cache.
+#define LC_CACHE_COUNT(did, field) do { \
+    Cache_Stats.total.field++; \
+    if ((did) < LC_CACHE_MAX_DEVICES) { \
+        Cache_Stats.device[(did)].field++; \
+    } \
+} while (0)
 
 struct Cache{
-    // Placement of where the block is from.
-    int Device;
-    int Sector;
-    int Block;
+    // Placement of where each block is from (LC_CACHE_KEY).
+    uint64_t *Key;
 
-    // The time at which the data was put in
-    int Time;
+    // The time at which each block was last used (0 if the slot is empty)
+    int *Time;
 
-    // array for all the blocks of cache
-    char cache[255]; // there is 256 charicters in each block of cache
+    // If the block is in the admission window (see Cache_Admission_Enabled)
+    uint8_t *Window;
 
-}* LcCachePtr; // There are 64 blocks of cache
+    // If the block was prefetched and no lookup has found it yet
+    uint8_t *Prefetched;
+
+    // The blocks, LC_CACHE_BLOCK_SIZE bytes each (64-byte aligned)
+    char *Data;
+    size_t Mapped;  // The bytes mmap'ed for Data (0 if it came from posix_memalign)
+
+    // The number of slots
+    int Size;
+
+}LcCache; // There are 64 blocks of cache
 
 // To hold the number of cach acceses.
 int Number_Of_Accesses = 1;
 
+// What has happened to the cache (see lcloud_cachestats).
+LcCacheStats Cache_Stats;
+
+// The last block looked for and not found (its fill is not a second use).
+uint64_t Missed_Key = UINT64_MAX;
+
+static int cache_insert( LcDeviceId did, uint16_t sec, uint16_t blk, char * block, int prefetch );
+
 //
 // Functions
 //
 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_numa_nodes
+// Description  : Read the online NUMA nodes from sysfs (a list such as
+//                "0-1" or "0,2-3").
+//
+// Inputs       : none
+// Outputs      : a mask with a bit per online node, 0 if it can not be read
+static unsigned long cache_numa_nodes( void ) {
+    char List[256];
+    unsigned long Mask = 0;
+    FILE *Online = fopen("/sys/devices/system/node/online", "r");
+
+    if (Online == NULL) {
+        return( 0 );
+    }
+    if (fgets(List, sizeof(List), Online) != NULL) {
+        for (char *Range = strtok(List, ",\n"); Range != NULL; Range = strtok(NULL, ",\n")) {
+            int First, Last;
+            int Found = sscanf(Range, "%d-%d", &First, &Last);
+            if (Found == 1) {
+                Last = First;
+            }
+            for (int node = First; Found >= 1 && node <= Last && node < LC_CACHE_MAX_NODES; node++) {
+                Mask |= 1ul << node;
+            }
+        }
+    }
+    fclose(Online);
+    return( Mask );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_numa_interleave
+// Description  : Spread mapped memory page by page over the online NUMA
+//                nodes (mbind, called directly so libnuma is not needed).
+//                With one node there is nothing to spread.
+//
+// Inputs       : memory, size - the mapping (not yet touched)
+// Outputs      : none
+static void cache_numa_interleave( void *memory, size_t size ) {
+    unsigned long Nodes = cache_numa_nodes();
+
+    if ((Nodes & (Nodes - 1)) == 0) {
+        logMessage(LOG_INFO_LEVEL, "          ### One NUMA node, the cache is not interleaved.");
+        return;
+    }
+    if (syscall(SYS_mbind, memory, size, MPOL_INTERLEAVE, &Nodes, LC_CACHE_MAX_NODES + 1, 0) != 0) {
+        logMessage(LOG_ERROR_LEVEL, "          ### Could not interleave the cache over the NUMA nodes.");
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_data_alloc
+// Description  : Get the memory for the blocks, from huge pages if asked for
+//                (reserved ones, or else transparent ones), or else aligned
+//                to a CPU cache line.  Memory to be interleaved over the
+//                NUMA nodes is always mapped, so its policy can be set
+//                before the first touch places it.
+//
+// Inputs       : bytes - the size wanted
+//                mapped - set to the bytes mmap'ed (0 if not mmap'ed)
+// Outputs      : the memory, NULL if failure
+static char * cache_data_alloc( size_t bytes, size_t *mapped ) {
+    void *Memory = NULL;
+
+    *mapped = 0;
+    if (Cache_Huge_Pages == 1 || Cache_Numa_Interleave == 1) {
+        size_t Page = (Cache_Huge_Pages == 1) ? LC_CACHE_HUGE_PAGE : (size_t)sysconf(_SC_PAGESIZE);
+        size_t Size = (bytes + Page - 1) & ~(Page - 1);
+
+        Memory = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (Cache_Huge_Pages == 1) {
+            Memory = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if (Memory == MAP_FAILED) {
+            Memory = mmap(NULL, Size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+#ifdef MADV_HUGEPAGE
+            if (Memory != MAP_FAILED && Cache_Huge_Pages == 1) {
+                madvise(Memory, Size, MADV_HUGEPAGE);
+            }
+#endif
+        }
+        if (Memory != MAP_FAILED) {
+            if (Cache_Numa_Interleave == 1) {
+                cache_numa_interleave(Memory, Size);
+            }
+            *mapped = Size;
+            return( Memory );
+        }
+        logMessage(LOG_ERROR_LEVEL, "          ### Could not map the cache's memory, using the heap.");
+    }
+    if (posix_memalign(&Memory, LC_CACHE_ALIGN, bytes) != 0) {
+        return( NULL );
+    }
+    return( Memory );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_free
+// Description  : Release the arrays of a cache.
+//
+// Inputs       : cache - the cache
+// Outputs      : none
+static void cache_free( struct Cache *cache ) {
+    free(cache->Key);
+    free(cache->Time);
+    free(cache->Window);
+    free(cache->Prefetched);
+    if (cache->Mapped != 0) {
+        munmap(cache->Data, cache->Mapped);
+    }
+    else {
+        free(cache->Data);
+    }
+    memset(cache, 0, sizeof(*cache));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_alloc
+// Description  : Create the (empty) arrays of a cache.
+//
+// Inputs       : cache - the cache, maxblocks - the number of slots
+// Outputs      : 0 if successful, -1 if failure
+static int cache_alloc( struct Cache *cache, int maxblocks ) {
+    memset(cache, 0, sizeof(*cache));
+    cache->Key = calloc(maxblocks, sizeof(uint64_t));
+    cache->Time = calloc(maxblocks, sizeof(int));
+    cache->Window = calloc(maxblocks, sizeof(uint8_t));
+    cache->Prefetched = calloc(maxblocks, sizeof(uint8_t));
+    cache->Data = cache_data_alloc((size_t)maxblocks * LC_CACHE_BLOCK_SIZE, &cache->Mapped);
+    if (cache->Key == NULL || cache->Time == NULL || cache->Window == NULL || cache->Prefetched == NULL || cache->Data == NULL) {
+        cache_free(cache);
+        return( -1 );
+    }
+    cache->Size = maxblocks;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_device
+// Description  : The device of the block in a slot.
+//
+// Inputs       : index - the slot
+// Outputs      : the device id
+static LcDeviceId cache_device( int index ) {
+    return( (LcDeviceId)(LcCache.Key[index] >> 32) );
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : lcloud_getcache
-// Description  : Search the cache for a block 
+// Description  : Search the cache for a block
 //
 // Inputs       : did - device number of block to find
 //                sec - sector number of block to find
@@ -53,81 +263,289 @@ int Number_Of_Accesses = 1;
 // Outputs      : cache block if found (pointer), NULL if not or failure
 char * lcloud_getcache( LcDeviceId did, uint16_t sec, uint16_t blk ) {
     logMessage(LOG_OUTPUT_LEVEL, "          ### Checking cache for data.");
+    lcloud_admit_record(did, sec, blk);
+    uint64_t Key = LC_CACHE_KEY(did, sec, blk);
 
     // Find the block within the cache.
-    for(int index = 0; index < LC_CACHE_MAXBLOCKS; index++) {
-        
+    for(int index = 0; index < LcCache.Size; index++) {
 
-        // LcCachePtr[index].Time != 0  // make sure the block is inisilized before checking values that may not exsist
-        if (LcCachePtr[index].Time != 0 && LcCachePtr[index].Device == did && LcCachePtr[index].Sector == sec && LcCachePtr[index].Block == blk) 
+        // LcCache.Time[index] != 0  // make sure the block is inisilized before checking values that may not exsist
+        if (LcCache.Key[index] == Key && LcCache.Time[index] != 0)
         {
             // Update timmer
-            LcCachePtr[index].Time = Number_Of_Accesses;
+            LcCache.Time[index] = Number_Of_Accesses;
             // Increase the access ammount.
             Number_Of_Accesses++;
-            
-            if (LcCachePtr[index].cache == NULL) {
-                return(NULL);
+            LC_CACHE_COUNT(did, hits);
+            if (LcCache.Prefetched[index] == 1) {
+                LcCache.Prefetched[index] = 0;
+                LC_CACHE_COUNT(did, prefetch_hits);
             }
-            return(LcCachePtr[index].cache);
+
+            return(LcCache.Data + (size_t)index * LC_CACHE_BLOCK_SIZE);
         }
-    } 
+    }
+    LC_CACHE_COUNT(did, misses);
+    Missed_Key = Key;
+
+    // Move the block back from the local tier if it is there.
+    char Block[LC_CACHE_BLOCK_SIZE];
+    if (lcloud_l2_get(did, sec, blk, Block) == 0) {
+        return(LcCache.Data + (size_t)cache_insert(did, sec, blk, Block, 0) * LC_CACHE_BLOCK_SIZE);
+    }
+
     /* Return not found */
-    return(NULL);  
+    return(NULL);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : lcloud_putcache
-// Description  : Put a value in the cache 
+// Function     : lcloud_incache
+// Description  : Check if a block is in the cache, without it counting as a
+//                use (nothing is counted, and the local tier is not asked).
+//
+// Inputs       : did - device number of block to find
+//                sec - sector number of block to find
+//                blk - block number of block to find
+// Outputs      : 1 if the block is cached, 0 if not
+int lcloud_incache( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    return( lcloud_peekcache(did, sec, blk) != NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_peekcache
+// Description  : Look at a cached block without it counting as a use (no
+//                hit or miss, no admission count, it does not move in the
+//                LRU order, and the local tier is not asked).
+//
+// Inputs       : did - device number of block to find
+//                sec - sector number of block to find
+//                blk - block number of block to find
+// Outputs      : cache block pointer or NULL if not found
+char * lcloud_peekcache( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    uint64_t Key = LC_CACHE_KEY(did, sec, blk);
+
+    for(int index = 0; index < LcCache.Size; index++) {
+        if (LcCache.Key[index] == Key && LcCache.Time[index] != 0) {
+            return( LcCache.Data + (size_t)index * LC_CACHE_BLOCK_SIZE );
+        }
+    }
+    return( NULL );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_window_place
+// Description  : Find the place for a new block with the admission filter
+//                (W-TinyLFU).  New blocks always go into a small LRU window.
+//                The oldest block leaving the window only joins the rest of
+//                the cache if it is used more than the block it would push
+//                out there; if it is not, it is the one dropped.
+//
+// Inputs       : none
+// Outputs      : the index for the new block (its old contents counted)
+static int cache_window_place( void ) {
+    int Empty = -1, Window_Oldest = -1, Main_Oldest = -1, Window_Count = 0;
+    int Window_Max = LcCache.Size * LC_CACHE_WINDOW_PERCENT / 100;
+    int Placement;
+
+    if (Window_Max < 1) {
+        Window_Max = 1;
+    }
+    for (int index = 0; index < LcCache.Size; index++) {
+        if (LcCache.Time[index] == 0) {
+            if (Empty < 0) {
+                Empty = index;
+            }
+        }
+        else if (LcCache.Window[index] == 1) {
+            Window_Count++;
+            if (Window_Oldest < 0 || LcCache.Time[index] < LcCache.Time[Window_Oldest]) {
+                Window_Oldest = index;
+            }
+        }
+        else if (Main_Oldest < 0 || LcCache.Time[index] < LcCache.Time[Main_Oldest]) {
+            Main_Oldest = index;
+        }
+    }
+
+    if (Window_Count < Window_Max || Window_Oldest < 0) {
+
+        // The window has room, take a free block or else the oldest one.
+        Placement = (Empty >= 0) ? Empty : (Main_Oldest >= 0) ? Main_Oldest : Window_Oldest;
+    }
+    else if (Empty >= 0) {
+
+        // The window is full but the rest is not, its oldest just moves over.
+        LcCache.Window[Window_Oldest] = 0;
+        Placement = Empty;
+    }
+    else if (Main_Oldest >= 0 && lcloud_admit(cache_device(Window_Oldest), (uint16_t)(LcCache.Key[Window_Oldest] >> 16), (uint16_t)LcCache.Key[Window_Oldest],
+                                              cache_device(Main_Oldest), (uint16_t)(LcCache.Key[Main_Oldest] >> 16), (uint16_t)LcCache.Key[Main_Oldest])) {
+
+        // The window's oldest is used more, it replaces the oldest of the rest.
+        LcCache.Window[Window_Oldest] = 0;
+        Placement = Main_Oldest;
+    }
+    else {
+
+        // The filter keeps the window's oldest out.
+        LC_CACHE_COUNT(cache_device(Window_Oldest), rejections);
+        Placement = Window_Oldest;
+    }
+
+    if (LcCache.Time[Placement] != 0) {
+        LC_CACHE_COUNT(cache_device(Placement), evictions);
+    }
+    else {
+        Cache_Stats.resident++;
+    }
+    return Placement;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_spill
+// Description  : Hand the block in a slot to the local tier (it is leaving
+//                the cache).
+//
+// Inputs       : index - the slot
+// Outputs      : none
+static void cache_spill( int index ) {
+    if (LcCache.Time[index] != 0) {
+        lcloud_l2_put(cache_device(index), (uint16_t)(LcCache.Key[index] >> 16), (uint16_t)LcCache.Key[index],
+                      LcCache.Data + (size_t)index * LC_CACHE_BLOCK_SIZE);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_insert
+// Description  : Put a value in the cache (see lcloud_putcache).
 //
 // Inputs       : did - device number of block to insert
 //                sec - sector number of block to insert
 //                blk - block number of block to insert
-// Outputs      : 0 if succesfully inserted, -1 if failure
-int lcloud_putcache( LcDeviceId did, uint16_t sec, uint16_t blk, char * block ) {
-    logMessage(LOG_OUTPUT_LEVEL, "          ### Writting Data to Cache.");
-
-    int Lowest_Time = LcCachePtr[0].Time;
+//                prefetch - 1 if no one has asked for the block yet
+// Outputs      : the slot the block is in
+static int cache_insert( LcDeviceId did, uint16_t sec, uint16_t blk, char * block, int prefetch ) {
+    uint64_t Key = LC_CACHE_KEY(did, sec, blk);
+    int Lowest_Time = LcCache.Time[0];
     int Block_Placement = (int)0;
+    int Updated = 0;
+
+    // Count the use, unless it is the fill after a miss (allready counted).
+    if (Key == Missed_Key) {
+        Missed_Key = UINT64_MAX;
+    }
+    else {
+        lcloud_admit_record(did, sec, blk);
+    }
 
     // Find the lowest time to put the data.
-    for(int index = 1; index < LC_CACHE_MAXBLOCKS; index++) {
-        if (LcCachePtr[index].Time < Lowest_Time) {
-            
+    for(int index = 1; index < LcCache.Size; index++) {
+        if (LcCache.Time[index] < Lowest_Time) {
+
             // Chose the oldest/empty block
-            Lowest_Time = LcCachePtr[index].Time;
+            Lowest_Time = LcCache.Time[index];
             Block_Placement = index;
-        } 
-    }   
+        }
+    }
 
     //// CHECK IF A PREVOUS VERSION OF THE DATA ALLREADY EXISITS
     // Find the block within the cache.
-    for(int index = 0; index < LC_CACHE_MAXBLOCKS; index++) {
-        // LcCachePtr[index].Time != 0  // make sure the block is inisilized before checking values that may not exsist
-        if (LcCachePtr[index].Time != 0 && LcCachePtr[index].Device == did && LcCachePtr[index].Sector == sec && LcCachePtr[index].Block == blk) 
+    for(int index = 0; index < LcCache.Size; index++) {
+        // LcCache.Time[index] != 0  // make sure the block is inisilized before checking values that may not exsist
+        if (LcCache.Key[index] == Key && LcCache.Time[index] != 0)
         {
-            Lowest_Time = LcCachePtr[index].Time;
+            Lowest_Time = LcCache.Time[index];
             Block_Placement = index;
+            Updated = 1;
+        }
+    }
+
+    // Count what the placement does to the cache.
+    if (Updated == 1) {
+        LC_CACHE_COUNT(did, updates);
+    }
+    else if (Cache_Admission_Enabled == 1) {
+        LC_CACHE_COUNT(did, inserts);
+        Block_Placement = cache_window_place();
+        LcCache.Window[Block_Placement] = 1;
+    }
+    else {
+        LC_CACHE_COUNT(did, inserts);
+        if (LcCache.Time[Block_Placement] != 0) {
+            LC_CACHE_COUNT(cache_device(Block_Placement), evictions);
+        }
+        else {
+            Cache_Stats.resident++;
+        }
+    }
+
+    // A prefetched block that goes (or is written over) unread was wasted.
+    if (Updated == 0 || prefetch == 0) {
+        if (LcCache.Time[Block_Placement] != 0 && LcCache.Prefetched[Block_Placement] == 1) {
+            LC_CACHE_COUNT(cache_device(Block_Placement), prefetch_wasted);
         }
+        LcCache.Prefetched[Block_Placement] = (uint8_t)(prefetch == 1);
+    }
+
+    // The block pushed out goes to the local tier, and any old copy of the
+    // new one there is out of date.
+    if (Updated == 0) {
+        cache_spill(Block_Placement);
+        lcloud_l2_forget(did, sec, blk);
     }
 
     // Save the placement for the block
-    LcCachePtr[Block_Placement].Device = did;
-    LcCachePtr[Block_Placement].Sector = sec;
-    LcCachePtr[Block_Placement].Block = blk;
-    LcCachePtr[Block_Placement].Time = Number_Of_Accesses;
+    LcCache.Key[Block_Placement] = Key;
+    LcCache.Time[Block_Placement] = Number_Of_Accesses;
 
     // Increase the access ammount.
     Number_Of_Accesses++;
 
     // Copy the block
-    memcpy(LcCachePtr[Block_Placement].cache, block, 256);
+    memcpy(LcCache.Data + (size_t)Block_Placement * LC_CACHE_BLOCK_SIZE, block, LC_CACHE_BLOCK_SIZE);
+    return( Block_Placement );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_putcache
+// Description  : Put a value in the cache
+//
+// Inputs       : did - device number of block to insert
+//                sec - sector number of block to insert
+//                blk - block number of block to insert
+// Outputs      : 0 if succesfully inserted, -1 if failure
+int lcloud_putcache( LcDeviceId did, uint16_t sec, uint16_t blk, char * block ) {
+    logMessage(LOG_OUTPUT_LEVEL, "          ### Writting Data to Cache.");
+    cache_insert(did, sec, blk, block, 0);
 
     /* Return successfully */
     return( 0 );
-    //}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_prefetchcache
+// Description  : Put a block in the cache before anyone has asked for it.
+//                The first lookup that finds it counts a prefetch hit; if it
+//                is pushed out or written over first, the prefetch was
+//                wasted.  A block that is allready cached stays as it is.
+//
+// Inputs       : did - device number of block to insert
+//                sec - sector number of block to insert
+//                blk - block number of block to insert
+// Outputs      : 0 if succesfully inserted, -1 if failure
+int lcloud_prefetchcache( LcDeviceId did, uint16_t sec, uint16_t blk, char * block ) {
+    logMessage(LOG_OUTPUT_LEVEL, "          ### Prefetching Data to Cache.");
+    cache_insert(did, sec, blk, block, 1);
 
+    /* Return successfully */
+    return( 0 );
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -135,20 +553,92 @@ int lcloud_putcache( LcDeviceId did, uint16_t sec, uint16_t blk, char * block )
 // Function     : lcloud_initcache
 // Description  : Initialze the cache by setting up metadata a cache elements.
 //
-// Inputs       : maxblocks - the max number number of blocks 
+// Inputs       : maxblocks - the max number number of blocks
 // Outputs      : 0 if successful, -1 if failure
 int lcloud_initcache( int maxblocks ) {
 
-    LcCachePtr = (struct Cache *) malloc(maxblocks * sizeof(struct Cache));
+    // The slots start empty (time 0).
+    if (cache_alloc(&LcCache, maxblocks) != 0) {
+        logMessage(LOG_ERROR_LEVEL, "          ### Could not allocate %i blocks of cache.", maxblocks);
+        return( -1 );
+    }
 
-    // INILIZE THE TIME: 
-    for(int index = 0; index < maxblocks; index++) {
-        LcCachePtr[index].Time = 0;
+    // Start the statistics over.
+    memset(&Cache_Stats, 0, sizeof(Cache_Stats));
+    if (Cache_Admission_Enabled == 1 && lcloud_admit_init(maxblocks) != 0) {
+        Cache_Admission_Enabled = 0;
     }
 
     /* Return successfully */
     return( 0 );
 }
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : cache_newer
+// Description  : Order slots most recently used first (for qsort).
+//
+// Inputs       : a, b - pointers to the slot numbers
+// Outputs      : the order
+static int cache_newer( const void *a, const void *b ) {
+    return LcCache.Time[*(const int *)b] - LcCache.Time[*(const int *)a];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_resizecache
+// Description  : Change the number of blocks the cache holds, keeping the
+//                most recently used blocks that still fit.
+//
+// Inputs       : maxblocks - the new number of blocks
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_resizecache( int maxblocks ) {
+    struct Cache Resized;
+    int *Order;
+
+    if (maxblocks <= 0) {
+        return( -1 );
+    }
+    Order = malloc(LcCache.Size * sizeof(int));
+    if (Order == NULL || cache_alloc(&Resized, maxblocks) != 0) {
+        free(Order);
+        return( -1 );
+    }
+
+    // The empty slots (time 0) sort last.
+    for (int index = 0; index < LcCache.Size; index++) {
+        Order[index] = index;
+    }
+    qsort(Order, LcCache.Size, sizeof(int), cache_newer);
+    Cache_Stats.resident = 0;
+    for (int index = 0; index < LcCache.Size && index < maxblocks; index++) {
+        int From = Order[index];
+        Resized.Key[index] = LcCache.Key[From];
+        Resized.Time[index] = LcCache.Time[From];
+        Resized.Window[index] = LcCache.Window[From];
+        Resized.Prefetched[index] = LcCache.Prefetched[From];
+        memcpy(Resized.Data + (size_t)index * LC_CACHE_BLOCK_SIZE, LcCache.Data + (size_t)From * LC_CACHE_BLOCK_SIZE, LC_CACHE_BLOCK_SIZE);
+        if (Resized.Time[index] != 0) {
+            Cache_Stats.resident++;
+        }
+    }
+    for (int index = maxblocks; index < LcCache.Size; index++) {
+        if (LcCache.Time[Order[index]] != 0 && LcCache.Prefetched[Order[index]] == 1) {
+            LC_CACHE_COUNT(cache_device(Order[index]), prefetch_wasted);
+        }
+        cache_spill(Order[index]);
+    }
+
+    free(Order);
+    cache_free(&LcCache);
+    LcCache = Resized;
+    if (Cache_Admission_Enabled == 1 && lcloud_admit_resize(maxblocks) != 0) {
+        Cache_Admission_Enabled = 0;
+    }
+    logMessage(LOG_INFO_LEVEL, "          ### The cache now holds %i blocks.", maxblocks);
+    return( 0 );
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : lcloud_closecache
@@ -159,11 +649,127 @@ int lcloud_initcache( int maxblocks ) {
 
 int lcloud_closecache( void ) {
 
+    // Keep the blocks in the local tier for the next run.
+    for (int index = 0; index < LcCache.Size; index++) {
+        cache_spill(index);
+    }
+
     // Return the data back to the void.
-    free(LcCachePtr);
+    cache_free(&LcCache);
+    lcloud_admit_close();
 
     logMessage(LOG_OUTPUT_LEVEL, "          ### The cache is free.");
 
     /* Return successfully */
     return( 0 );
-}
\ No newline at end of file
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_cachestats
+// Description  : Copy the statistics gathered since the cache was initialized
+//
+// Inputs       : stats - the snapshot to fill
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_cachestats( LcCacheStats *stats ) {
+    if (stats == NULL) {
+        return( -1 );
+    }
+    *stats = Cache_Stats;
+    stats->maxblocks = LcCache.Size;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_cache_save
+// Description  : Save the addresses of the blocks in the cache, most
+//                recently used first, so the next power on can load them
+//                again.  The list is written beside the file and renamed
+//                over it, so a crash leaves the old list or the new one.
+//
+// Inputs       : path - the file
+//                identity - the devices' identity (see lcloud_cache_load)
+// Outputs      : the number of addresses saved, -1 if failure
+int lcloud_cache_save( const char *path, uint32_t identity ) {
+    uint32_t Header[4] = { LC_CACHE_SNAPSHOT_MAGIC, LC_CACHE_SNAPSHOT_VERSION, identity, 0 };
+    char Temp[1024];
+    uint64_t *Keys;
+    int *Order;
+    uint32_t Crc;
+    FILE *Out;
+
+    if (LcCache.Size == 0 || snprintf(Temp, sizeof(Temp), "%s.tmp", path) >= (int)sizeof(Temp)) {
+        return( -1 );
+    }
+    Keys = malloc(LcCache.Size * sizeof(uint64_t));
+    Order = malloc(LcCache.Size * sizeof(int));
+    if (Keys == NULL || Order == NULL) {
+        free(Keys);
+        free(Order);
+        return( -1 );
+    }
+
+    // Newest first (the empty slots sort last).
+    for (int index = 0; index < LcCache.Size; index++) {
+        Order[index] = index;
+    }
+    qsort(Order, LcCache.Size, sizeof(int), cache_newer);
+    while (Header[3] < (uint32_t)LcCache.Size && LcCache.Time[Order[Header[3]]] != 0) {
+        Keys[Header[3]] = LcCache.Key[Order[Header[3]]];
+        Header[3]++;
+    }
+    free(Order);
+
+    Crc = lcloud_crc32c(lcloud_crc32c(0, Header, sizeof(Header)), Keys, Header[3] * sizeof(uint64_t));
+    Out = fopen(Temp, "wb");
+    if (Out == NULL) {
+        free(Keys);
+        return( -1 );
+    }
+    if (fwrite(Header, sizeof(Header), 1, Out) != 1 || fwrite(Keys, sizeof(uint64_t), Header[3], Out) != Header[3] ||
+        fwrite(&Crc, sizeof(Crc), 1, Out) != 1 || fclose(Out) != 0 || rename(Temp, path) != 0) {
+        logMessage(LOG_ERROR_LEVEL, "          ### Could not save the cache's blocks to '%s'.", path);
+        remove(Temp);
+        free(Keys);
+        return( -1 );
+    }
+    free(Keys);
+    return( (int)Header[3] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_cache_load
+// Description  : Read a list saved by lcloud_cache_save.  It is only used if
+//                it is whole and was saved for the same devices.
+//
+// Inputs       : path - the file
+//                identity - the devices' identity (0 never matches)
+//                blocks - where to put the addresses (most recent first)
+//                max - the most addresses to take
+// Outputs      : the number of addresses, 0 if there is no usable list
+int lcloud_cache_load( const char *path, uint32_t identity, LcCacheAddress *blocks, int max ) {
+    uint32_t Header[4], Crc;
+    uint64_t *Keys = NULL;
+    int Count = 0;
+    FILE *In = fopen(path, "rb");
+
+    if (In == NULL) {
+        return( 0 );
+    }
+    if (fread(Header, sizeof(Header), 1, In) == 1 && Header[0] == LC_CACHE_SNAPSHOT_MAGIC &&
+        Header[1] == LC_CACHE_SNAPSHOT_VERSION && identity != 0 && Header[2] == identity &&
+        Header[3] <= LC_CACHE_MAXBLOCKS * 1024 && (Keys = malloc((Header[3] + 1) * sizeof(uint64_t))) != NULL &&
+        fread(Keys, sizeof(uint64_t), Header[3], In) == Header[3] && fread(&Crc, sizeof(Crc), 1, In) == 1 &&
+        Crc == lcloud_crc32c(lcloud_crc32c(0, Header, sizeof(Header)), Keys, Header[3] * sizeof(uint64_t))) {
+        for (Count = 0; Count < (int)Header[3] && Count < max; Count++) {
+            blocks[Count].did = (LcDeviceId)(Keys[Count] >> 32);
+            blocks[Count].sec = (uint16_t)(Keys[Count] >> 16);
+            blocks[Count].blk = (uint16_t)Keys[Count];
+        }
+    }
+    free(Keys);
+    fclose(In);
+    return( Count );
+}
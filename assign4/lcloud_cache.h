@@ -17,6 +17,38 @@
 
 // Defines 
 #define LC_CACHE_MAXBLOCKS 64
+#define LC_CACHE_MINBLOCKS 16
+#define LC_CACHE_BLOCK_SIZE 256
+#define LC_CACHE_MAX_DEVICES 16
+#define LC_CACHE_SNAPSHOT_MAGIC 0x4c434b53  // "LCKS", marks a saved list of cached blocks
+#define LC_CACHE_SNAPSHOT_VERSION 1
+
+// What happened to the blocks of one device (or the whole cache)
+typedef struct {
+    uint64_t hits;      // Lookups that found the block
+    uint64_t misses;    // Lookups that did not
+    uint64_t inserts;   // Blocks put in a new place
+    uint64_t updates;   // Blocks put over an older copy of themselves
+    uint64_t evictions; // Blocks pushed out to make room
+    uint64_t rejections; // Blocks the admission filter dropped from the window
+    uint64_t prefetch_hits;   // Prefetched blocks later found by a lookup
+    uint64_t prefetch_wasted; // Prefetched blocks that left (or were written over) before one
+} LcCacheCounters;
+
+// A snapshot of the cache statistics
+typedef struct {
+    int maxblocks;      // The size of the cache
+    int resident;       // Blocks in it now
+    LcCacheCounters total;
+    LcCacheCounters device[LC_CACHE_MAX_DEVICES];
+} LcCacheStats;
+
+// The address of a cached block
+typedef struct {
+    LcDeviceId did;
+    uint16_t sec;
+    uint16_t blk;
+} LcCacheAddress;
 
 //
 // Functional Prototypes
@@ -24,13 +56,34 @@
 char * lcloud_getcache( LcDeviceId did, uint16_t sec, uint16_t blk );
     // Search the cache for a block 
 
+int lcloud_incache( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Check if a block is cached (not counted as a use)
+
+char * lcloud_peekcache( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Look at a cached block (not counted as a use)
+
 int lcloud_putcache( LcDeviceId did, uint16_t sec, uint16_t blk, char *block );
     // Put a value in the cache 
 
+int lcloud_prefetchcache( LcDeviceId did, uint16_t sec, uint16_t blk, char *block );
+    // Put a block no one has asked for yet in the cache (counted as a prefetch)
+
 int lcloud_initcache( int maxblocks );
     // Initialze the cache by setting up metadata a cache elements.
 
+int lcloud_resizecache( int maxblocks );
+    // Change the number of blocks in the cache (keeping the most recent)
+
 int lcloud_closecache( void );
     // Clean up the cache when program is closing.
 
+int lcloud_cachestats( LcCacheStats *stats );
+    // Copy the statistics gathered since the cache was initialized
+
+int lcloud_cache_save( const char *path, uint32_t identity );
+    // Save the addresses of the cached blocks, most recently used first
+
+int lcloud_cache_load( const char *path, uint32_t identity, LcCacheAddress *blocks, int max );
+    // Read back a saved list of addresses (if saved for the same devices)
+
 #endif
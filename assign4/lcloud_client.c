@@ -10,9 +10,12 @@
 
 // Include Files
 #include <signal.h>
+#include <stdlib.h>
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <errno.h>
 #include <string.h>
 #include <unistd.h>
@@ -24,6 +27,9 @@
 #include <cmpsc311_log.h>
 #include <cmpsc311_util.h>
 
+// Defines
+#define LC_CLIENT_BATCH_BYTES (16 * (sizeof(LCloudRegisterFrame) + LC_DEVICE_BLOCK_SIZE)) // Sent at once by a batch (a longer run goes in pieces)
+
 //
 // Global verables
 struct Buss2{
@@ -70,22 +76,13 @@ void extract_lcloud_c2_c0_registers(LCloudRegisterFrame resp, struct Buss2 *BUSS
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : client_lcloud_bus_request
-// Description  : This the client regstateeration that sends a request to the 
-//                lion client server.   It will:
+// Function     : client_lcloud_connect
+// Description  : Connect to the lion cloud server, unless the connection is
+//                already open.
 //
-//                1) if INIT make a connection to the server
-//                2) send any request to the server, returning results
-//                3) if CLOSE, will close the connection
-//
-// Inputs       : reg - the request reqisters for the command
-//                buf - the block to be read/written from (READ/WRITE)
-// Outputs      : the response structure encoded as needed
-LCloudRegisterFrame client_lcloud_bus_request( LCloudRegisterFrame reg, void *buf ) {
-
-    // LCLOUD_MAX_BACKLOG = 5
-    // LCLOUD_NET_HEADER_SIZE = sizeof(LCloudRegisterFrame)
-    logMessage(LOG_INFO_LEVEL, "[lcloud_client.c] #### Talking to Device. ####");
+// Inputs       : none
+// Outputs      : 0 if connected, -1 if failure
+int client_lcloud_connect( void ) {
 
     // If there isn't an open connection already created
     // Use a global variable 'socket_extract_lcloud_c2_c0_registershandle', set initially equal to '-1'.
@@ -161,6 +158,32 @@ LCloudRegisterFrame client_lcloud_bus_request( LCloudRegisterFrame reg, void *bu
     else {
         logMessage(LOG_INFO_LEVEL, "[lcloud_client.c] There 'IS' an Open Connection.");
     }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : client_lcloud_bus_request
+// Description  : This the client regstateeration that sends a request to the 
+//                lion client server.   It will:
+//
+//                1) if INIT make a connection to the server
+//                2) send any request to the server, returning results
+//                3) if CLOSE, will close the connection
+//
+// Inputs       : reg - the request reqisters for the command
+//                buf - the block to be read/written from (READ/WRITE)
+// Outputs      : the response structure encoded as needed
+LCloudRegisterFrame client_lcloud_bus_request( LCloudRegisterFrame reg, void *buf ) {
+
+    // LCLOUD_MAX_BACKLOG = 5
+    // LCLOUD_NET_HEADER_SIZE = sizeof(LCloudRegisterFrame)
+    logMessage(LOG_INFO_LEVEL, "[lcloud_client.c] #### Talking to Device. ####");
+
+    // If there isn't an open connection already created, make one.
+    if (client_lcloud_connect() != 0) {
+        return -1;
+    }
     
     // Use the helper function you created in assignment #2 to extract the
     // opcode from the provided register 'reg'
@@ -287,3 +310,144 @@ LCloudRegisterFrame client_lcloud_bus_request( LCloudRegisterFrame reg, void *bu
     return reg;
 }
 
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : client_write_all
+// Description  : Write all of a buffer to the server (a large write may be
+//                taken a piece at a time).
+//
+// Inputs       : buf - the bytes, len - how many
+// Outputs      : 0 if successful, -1 if failure
+static int client_write_all( const char *buf, size_t len ) {
+    for (size_t Done = 0; Done < len; ) {
+        ssize_t Sent = write(File_Socket.socket_handle, buf + Done, len - Done);
+        if (Sent <= 0) {
+            logMessage(LOG_ERROR_LEVEL, "[lcloud_client.c] Batch write error.");
+            return -1;
+        }
+        Done += Sent;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : client_read_all
+// Description  : Read exactly len bytes from the server.
+//
+// Inputs       : buf - where they go, len - how many
+// Outputs      : 0 if successful, -1 if failure
+static int client_read_all( char *buf, size_t len ) {
+    for (size_t Done = 0; Done < len; ) {
+#ifdef TCP_QUICKACK
+        // Answer each piece at once, the server holds its next answer
+        // until the last one is acknowledged.
+        int One = 1;
+        setsockopt(File_Socket.socket_handle, IPPROTO_TCP, TCP_QUICKACK, &One, sizeof(One));
+#endif
+        ssize_t Got = read(File_Socket.socket_handle, buf + Done, len - Done);
+        if (Got <= 0) {
+            logMessage(LOG_ERROR_LEVEL, "[lcloud_client.c] Batch read error.");
+            return -1;
+        }
+        Done += Got;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : client_lcloud_bus_batch
+// Description  : Send a run of requests that move no data (such as
+//                LC_DEVINIT) in one write, then read all of the responses.
+//                The server answers in order, so the run costs one round
+//                trip instead of one each.
+//
+// Inputs       : regs - the request registers, replaced by the responses
+//                count - the number of requests
+// Outputs      : 0 if successful, -1 if failure
+int client_lcloud_bus_batch( LCloudRegisterFrame *regs, int count ) {
+    struct Buss2 BUSS_ADDRESS;
+
+    for (int i = 0; i < count; i++) {
+        extract_lcloud_c2_c0_registers(regs[i], &BUSS_ADDRESS);
+        if (BUSS_ADDRESS.c0 == LC_BLOCK_XFER) {
+            return -1;
+        }
+    }
+    return client_lcloud_bus_xfer_batch(regs, NULL, count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : client_lcloud_bus_xfer_batch
+// Description  : Send a run of requests, block transfers included, in one
+//                write (each write request followed by its block), then
+//                read the responses in order (each read response followed
+//                by its block).  Nothing waits on the round trip of the
+//                request before it.
+//
+// Inputs       : regs - the request registers, replaced by the responses
+//                bufs - the block of each transfer (may be NULL if the run
+//                       has no transfers)
+//                count - the number of requests
+// Outputs      : 0 if successful, -1 if failure
+int client_lcloud_bus_xfer_batch( LCloudRegisterFrame *regs, char **bufs, int count ) {
+    struct Buss2 BUSS_ADDRESS;
+    char Out[LC_CLIENT_BATCH_BYTES], *Next;
+    int Ret;
+
+    if (count <= 0) {
+        return -1;
+    }
+    for (int i = 0; i < count; i++) {
+        extract_lcloud_c2_c0_registers(regs[i], &BUSS_ADDRESS);
+        if (BUSS_ADDRESS.c0 == LC_POWER_OFF ||
+            (BUSS_ADDRESS.c0 == LC_BLOCK_XFER && (bufs == NULL || bufs[i] == NULL))) {
+            return -1;
+        }
+    }
+    if (client_lcloud_connect() != 0) {
+        return -1;
+    }
+    logMessage(LOG_INFO_LEVEL, "[lcloud_client.c] Sending '%i' requests at once.", count);
+
+    // Lay the run out and send it, a buffer full at a time.
+    Next = Out;
+    Ret = 0;
+    for (int i = 0; i < count && Ret == 0; i++) {
+        LCloudRegisterFrame Net = htonll64(regs[i]);
+
+        extract_lcloud_c2_c0_registers(regs[i], &BUSS_ADDRESS);
+        memcpy(Next, &Net, sizeof(Net));
+        Next += sizeof(Net);
+        if (BUSS_ADDRESS.c0 == LC_BLOCK_XFER && BUSS_ADDRESS.c2 == LC_XFER_WRITE) {
+            memcpy(Next, bufs[i], LC_DEVICE_BLOCK_SIZE);
+            Next += LC_DEVICE_BLOCK_SIZE;
+        }
+        if (i == count - 1 || Next + sizeof(Net) + LC_DEVICE_BLOCK_SIZE > Out + sizeof(Out)) {
+            Ret = client_write_all(Out, Next - Out);
+            Next = Out;
+        }
+    }
+
+    // Then collect the answers.
+    for (int i = 0; i < count && Ret == 0; i++) {
+        extract_lcloud_c2_c0_registers(regs[i], &BUSS_ADDRESS);
+        Ret = client_read_all((char *)&regs[i], sizeof(regs[i]));
+        regs[i] = ntohll64(regs[i]);
+        if (Ret == 0 && BUSS_ADDRESS.c0 == LC_BLOCK_XFER && BUSS_ADDRESS.c2 == LC_XFER_READ) {
+            Ret = client_read_all(bufs[i], LC_DEVICE_BLOCK_SIZE);
+        }
+    }
+
+    // Answers to the rest of the run may still be on their way, so drop the
+    // connection rather than hand them to the next request.
+    if (Ret != 0) {
+        logMessage(LOG_ERROR_LEVEL, "[lcloud_client.c] Batch failed, closing the connection.");
+        close(File_Socket.socket_handle);
+        File_Socket.socket_handle = -1;
+    }
+    return Ret;
+}
@@ -0,0 +1,245 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_compress.c
+//  Description    : This is the implementation of the block compression for
+//                   the Lion Cloud filesystem.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <string.h>
+
+// Project include files
+#include <lcloud_compress.h>
+
+// Information
+//
+// The compressed form is a list of sequences, each one:
+//
+//   [token] [extra literal length] [literals] [offset (2)] [extra match length]
+//
+// The high nibble of the token is the literal count and the low nibble the
+// match length less LC_COMPRESS_MIN_MATCH; a nibble of 15 is followed by
+// bytes that are added on until one is not 255.  The last sequence has only
+// literals, the end of the input tells the decoder to stop.  Matches may
+// overlap the bytes they produce, which is how runs (zero padding) shrink.
+//
+
+// Defines
+#define LC_COMPRESS_HASH_BITS 8
+#define LC_COMPRESS_HASH(seq) (((seq) * 2654435761u) >> (32 - LC_COMPRESS_HASH_BITS))
+#define LC_COMPRESS_SAMPLE_STEP 4   // The sampler looks at every 4th position
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : compress_read32
+// Description  : Read the 4 byte sequence at a position (any alignment).
+//
+// Inputs       : p - the bytes
+// Outputs      : the sequence
+static uint32_t compress_read32( const uint8_t *p ) {
+    uint32_t seq;
+    memcpy(&seq, p, 4);
+    return seq;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : compress_length
+// Description  : Write the extra bytes of a length that did not fit in its
+//                nibble.
+//
+// Inputs       : out, op - the output and its position, max - the limit
+//                len - what is left of the length after the nibble
+// Outputs      : 0 if it fit, -1 if the output is full
+static int compress_length( uint8_t *out, int *op, int max, int len ) {
+    for (; len >= 255; len -= 255) {
+        if (*op >= max) {
+            return -1;
+        }
+        out[(*op)++] = 255;
+    }
+    if (*op >= max) {
+        return -1;
+    }
+    out[(*op)++] = (uint8_t)len;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : compress_sequence
+// Description  : Write one sequence (the last one has no match, mlen 0).
+//
+// Inputs       : out, op, max - the output, its position and limit
+//                lit, litlen - the literals
+//                offset, mlen - the match
+// Outputs      : 0 if it fit, -1 if the output is full
+static int compress_sequence( uint8_t *out, int *op, int max, const uint8_t *lit, int litlen, int offset, int mlen ) {
+    int mcode = (mlen > 0) ? mlen - LC_COMPRESS_MIN_MATCH : 0;
+
+    if (*op >= max) {
+        return -1;
+    }
+    out[(*op)++] = (uint8_t)(((litlen < 15) ? litlen : 15) << 4 | ((mcode < 15) ? mcode : 15));
+    if (litlen >= 15 && compress_length(out, op, max, litlen - 15) != 0) {
+        return -1;
+    }
+    if (*op + litlen > max) {
+        return -1;
+    }
+    memcpy(out + *op, lit, litlen);
+    *op += litlen;
+
+    if (mlen == 0) {
+        return 0;
+    }
+    if (*op + 2 > max) {
+        return -1;
+    }
+    out[(*op)++] = offset & 0xff;
+    out[(*op)++] = offset >> 8;
+    if (mcode >= 15 && compress_length(out, op, max, mcode - 15) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_compress_worth
+// Description  : Sample the block for repeated sequences.  Blocks with none
+//                (random or allready compressed data) are skipped without
+//                running the compressor.
+//
+// Inputs       : src - the block, len - its length
+// Outputs      : 1 if the block should be compressed, 0 if not
+int lcloud_compress_worth( const char *src, int len ) {
+    const uint8_t *in = (const uint8_t *)src;
+    int16_t seen[1 << LC_COMPRESS_HASH_BITS];
+    int repeats = 0;
+
+    memset(seen, 0xff, sizeof(seen));
+    for (int ip = 0; ip + LC_COMPRESS_MIN_MATCH <= len; ip += LC_COMPRESS_SAMPLE_STEP) {
+        uint32_t seq = compress_read32(in + ip);
+        int h = LC_COMPRESS_HASH(seq);
+
+        if (seen[h] >= 0 && compress_read32(in + seen[h]) == seq && ++repeats >= LC_COMPRESS_MIN_REPEATS) {
+            return 1;
+        }
+        seen[h] = ip;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_compress
+// Description  : Compress a block with a greedy hash-table match finder.
+//
+// Inputs       : src - the block, len - its length
+//                dst - the output, max - the most bytes to use
+// Outputs      : the compressed length, -1 if it would not fit in max
+int lcloud_compress( const char *src, int len, char *dst, int max ) {
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *out = (uint8_t *)dst;
+    int16_t table[1 << LC_COMPRESS_HASH_BITS];
+    int ip = 0, op = 0, anchor = 0;
+
+    memset(table, 0xff, sizeof(table));
+    while (ip + LC_COMPRESS_MIN_MATCH <= len) {
+        uint32_t seq = compress_read32(in + ip);
+        int h = LC_COMPRESS_HASH(seq);
+        int ref = table[h];
+
+        table[h] = ip;
+        if (ref < 0 || compress_read32(in + ref) != seq) {
+            ip++;
+            continue;
+        }
+
+        // Extend the match as far as it goes
+        int mlen = LC_COMPRESS_MIN_MATCH;
+        while (ip + mlen < len && in[ref + mlen] == in[ip + mlen]) {
+            mlen++;
+        }
+        if (compress_sequence(out, &op, max, in + anchor, ip - anchor, ip - ref, mlen) != 0) {
+            return -1;
+        }
+        ip += mlen;
+        anchor = ip;
+    }
+
+    // What is left goes out as literals
+    if (compress_sequence(out, &op, max, in + anchor, len - anchor, 0, 0) != 0) {
+        return -1;
+    }
+    return op;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_decompress
+// Description  : Expand a compressed block, checking every length against
+//                both buffers so a damaged block can not overrun them.
+//
+// Inputs       : src - the compressed bytes, clen - their count
+//                dst - the output, len - the expected length
+// Outputs      : len if successful, -1 if the data is damaged
+int lcloud_decompress( const char *src, int clen, char *dst, int len ) {
+    const uint8_t *in = (const uint8_t *)src;
+    uint8_t *out = (uint8_t *)dst;
+    int ip = 0, op = 0;
+
+    while (ip < clen) {
+        int token = in[ip++];
+        int litlen = token >> 4, mlen = token & 15, b;
+
+        if (litlen == 15) {
+            do {
+                if (ip >= clen) {
+                    return -1;
+                }
+                b = in[ip++];
+                litlen += b;
+            } while (b == 255);
+        }
+        if (ip + litlen > clen || op + litlen > len) {
+            return -1;
+        }
+        memcpy(out + op, in + ip, litlen);
+        ip += litlen;
+        op += litlen;
+
+        // The last sequence ends with its literals
+        if (ip >= clen) {
+            break;
+        }
+        if (ip + 2 > clen) {
+            return -1;
+        }
+        int offset = in[ip] | (in[ip + 1] << 8);
+        ip += 2;
+        if (mlen == 15) {
+            do {
+                if (ip >= clen) {
+                    return -1;
+                }
+                b = in[ip++];
+                mlen += b;
+            } while (b == 255);
+        }
+        mlen += LC_COMPRESS_MIN_MATCH;
+        if (offset == 0 || offset > op || op + mlen > len) {
+            return -1;
+        }
+
+        // Byte by byte, the match may overlap what it is writing
+        for (int i = 0; i < mlen; i++, op++) {
+            out[op] = out[op - offset];
+        }
+    }
+    return (op == len) ? op : -1;
+}
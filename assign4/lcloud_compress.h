@@ -0,0 +1,39 @@
+#ifndef LCLOUD_COMPRESS_INCLUDED
+#define LCLOUD_COMPRESS_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_compress.h
+//  Description    : This is the block compression API for the Lion Cloud
+//                   filesystem.  A small LZ77 codec (LZ4 style sequences)
+//                   used to pack compressible blocks into slots of a shared
+//                   device block.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+#include <lcloud_controller.h>
+
+// Defines
+#define LC_COMPRESS_SLOT_SIZE 32        // Bytes in one slot of a packed block
+#define LC_COMPRESS_SLOTS (LC_DEVICE_BLOCK_SIZE / LC_COMPRESS_SLOT_SIZE) // Slots in a packed block (one bit each)
+#define LC_COMPRESS_MAX_PACKED (LC_DEVICE_BLOCK_SIZE - LC_COMPRESS_SLOT_SIZE) // Must save at least one slot
+#define LC_COMPRESS_MIN_MATCH 4         // Shortest match worth a sequence
+#define LC_COMPRESS_MIN_REPEATS 2       // Repeats the sampler must see before trying
+
+//
+// Functional Prototypes
+
+int lcloud_compress_worth( const char *src, int len );
+    // Quickly guess if a block is worth compressing
+
+int lcloud_compress( const char *src, int len, char *dst, int max );
+    // Compress a block, giving up once the output passes max bytes
+
+int lcloud_decompress( const char *src, int clen, char *dst, int len );
+    // Expand a compressed block back to len bytes
+
+#endif
@@ -0,0 +1,140 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_crc32c.c
+//  Description    : This is the implementation of the CRC32C checksum for
+//                   the Lion Cloud filesystem.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <string.h>
+
+// Project include files
+#include <lcloud_crc32c.h>
+
+// Information
+//
+// On x86 with SSE4.2 the CRC32 instruction does 8 bytes per instruction; it
+// is chosen at run time (the rest of the program is built for any x86), so
+// only crc32c_hardware is compiled for SSE4.2.  Anything else uses a
+// slicing-by-8 table, which also handles 8 bytes per step.
+//
+
+// Defines
+#define LC_CRC32C_POLY 0x82f63b78u  // Castagnoli polynomial (reflected)
+
+static uint32_t Crc_Table[8][256];  // The slicing-by-8 tables
+static int Crc_Ready = 0;           // If the tables and the choice are made
+static int Crc_Hardware = 0;        // If the CRC32 instruction is used
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : crc32c_init
+// Description  : Build the tables and pick the implementation.
+//
+// Inputs       : none
+// Outputs      : none
+static void crc32c_init( void ) {
+    for (int i = 0; i < 256; i++) {
+        uint32_t crc = i;
+        for (int k = 0; k < 8; k++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? LC_CRC32C_POLY : 0);
+        }
+        Crc_Table[0][i] = crc;
+    }
+    for (int i = 0; i < 256; i++) {
+        for (int t = 1; t < 8; t++) {
+            Crc_Table[t][i] = (Crc_Table[t - 1][i] >> 8) ^ Crc_Table[0][Crc_Table[t - 1][i] & 0xff];
+        }
+    }
+#if defined(__x86_64__) && defined(__GNUC__)
+    __builtin_cpu_init();
+    Crc_Hardware = __builtin_cpu_supports("sse4.2") != 0;
+#endif
+    Crc_Ready = 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : crc32c_software
+// Description  : CRC32C with the slicing-by-8 tables.
+//
+// Inputs       : crc - the running CRC (inverted), p - the bytes, len - count
+// Outputs      : the updated running CRC (inverted)
+static uint32_t crc32c_software( uint32_t crc, const uint8_t *p, size_t len ) {
+    for (; len >= 8; len -= 8, p += 8) {
+        uint32_t lo, hi;
+        memcpy(&lo, p, 4);
+        memcpy(&hi, p + 4, 4);
+        lo ^= crc;
+        crc = Crc_Table[7][lo & 0xff] ^ Crc_Table[6][(lo >> 8) & 0xff] ^
+              Crc_Table[5][(lo >> 16) & 0xff] ^ Crc_Table[4][lo >> 24] ^
+              Crc_Table[3][hi & 0xff] ^ Crc_Table[2][(hi >> 8) & 0xff] ^
+              Crc_Table[1][(hi >> 16) & 0xff] ^ Crc_Table[0][hi >> 24];
+    }
+    for (; len > 0; len--, p++) {
+        crc = (crc >> 8) ^ Crc_Table[0][(crc ^ *p) & 0xff];
+    }
+    return crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : crc32c_hardware
+// Description  : CRC32C with the SSE4.2 CRC32 instruction.
+//
+// Inputs       : crc - the running CRC (inverted), p - the bytes, len - count
+// Outputs      : the updated running CRC (inverted)
+__attribute__((target("sse4.2")))
+static uint32_t crc32c_hardware( uint32_t crc, const uint8_t *p, size_t len ) {
+    uint64_t crc64 = crc;
+
+    for (; len >= 8; len -= 8, p += 8) {
+        uint64_t word;
+        memcpy(&word, p, 8);
+        crc64 = __builtin_ia32_crc32di(crc64, word);
+    }
+    crc = (uint32_t)crc64;
+    for (; len > 0; len--, p++) {
+        crc = __builtin_ia32_crc32qi(crc, *p);
+    }
+    return crc;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_crc32c
+// Description  : Add bytes to a running CRC32C.
+//
+// Inputs       : crc - the CRC so far (0 to start), buf - the bytes,
+//                len - the number of bytes
+// Outputs      : the new CRC
+uint32_t lcloud_crc32c( uint32_t crc, const void *buf, size_t len ) {
+    if (!Crc_Ready) {
+        crc32c_init();
+    }
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (Crc_Hardware) {
+        return ~crc32c_hardware(~crc, buf, len);
+    }
+#endif
+    return ~crc32c_software(~crc, buf, len);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_crc32c_hardware
+// Description  : Check which implementation is in use.
+//
+// Inputs       : none
+// Outputs      : 1 if the CRC32 instruction is used, 0 if the tables are
+int lcloud_crc32c_hardware( void ) {
+    if (!Crc_Ready) {
+        crc32c_init();
+    }
+    return Crc_Hardware;
+}
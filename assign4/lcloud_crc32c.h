@@ -0,0 +1,27 @@
+#ifndef LCLOUD_CRC32C_INCLUDED
+#define LCLOUD_CRC32C_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_crc32c.h
+//  Description    : This is the CRC32C (Castagnoli) checksum used by the Lion
+//                   Cloud filesystem to verify the blocks it reads back.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stddef.h>
+#include <stdint.h>
+
+//
+// Functional Prototypes
+
+uint32_t lcloud_crc32c( uint32_t crc, const void *buf, size_t len );
+    // Add len bytes to a running CRC32C (start with 0)
+
+int lcloud_crc32c_hardware( void );
+    // Check if the CPU's CRC32 instruction is being used
+
+#endif
@@ -0,0 +1,270 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_dedup.c
+//  Description    : This is the implementation of the block deduplication
+//                   index for the Lion Cloud filesystem.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project include files
+#include <lcloud_dedup.h>
+
+// Information
+//
+// The index is an open addressing table (linear probing) keyed by the
+// fingerprint.  Each device also has a reverse array from a physical block
+// to its entry, so a block that is freed or overwritten in place can be
+// dropped without knowing what it used to hold.  Deletes shift the following
+// entries back instead of leaving tombstones, so lookups never slow down.
+//
+// The reference counts are not kept here, they live with the rest of the
+// free space accounting in the filesystem's device table.
+//
+
+// Defines
+#define LC_DEDUP_PRIME1 0x9e3779b185ebca87ull
+#define LC_DEDUP_PRIME2 0xc2b2ae3d27d4eb4full
+#define LC_DEDUP_PRIME3 0x165667b19e3779f9ull
+
+// One entry of the index
+typedef struct {
+    LcFingerprint fp;   // The content
+    uint8_t used;       // If the entry holds a block
+    uint8_t did;        // Where the content is stored
+    uint16_t sec;
+    uint16_t blk;
+} LcDedupEntry;
+
+static LcDedupEntry *Dedup_Table = NULL;               // The index
+static int Dedup_Mask = 0;                             // Table size - 1 (a power of 2)
+static int Dedup_Count = 0;                            // Entries in use
+static int32_t *Dedup_Slot[LC_DEDUP_MAX_DEVICES];      // Entry of each physical block (-1 if none)
+static uint16_t Dedup_Blocks[LC_DEDUP_MAX_DEVICES];    // Blocks per sector of each device
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : dedup_mix
+// Description  : Finish a hash lane so every input bit reaches every output
+//                bit.
+//
+// Inputs       : h - the lane
+// Outputs      : the mixed lane
+static uint64_t dedup_mix( uint64_t h ) {
+    h ^= h >> 33;
+    h *= LC_DEDUP_PRIME2;
+    h ^= h >> 29;
+    h *= LC_DEDUP_PRIME3;
+    h ^= h >> 32;
+    return h;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : dedup_slot_ref
+// Description  : The reverse array entry for a physical block.
+//
+// Inputs       : did, sec, blk - the physical block
+// Outputs      : pointer to the entry number, NULL if the device is unknown
+static int32_t * dedup_slot_ref( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    if (did >= LC_DEDUP_MAX_DEVICES || Dedup_Slot[did] == NULL) {
+        return NULL;
+    }
+    return &Dedup_Slot[did][sec * Dedup_Blocks[did] + blk];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : dedup_remove
+// Description  : Empty an entry, shifting back the entries after it that
+//                would no longer be found.
+//
+// Inputs       : i - the entry
+// Outputs      : none
+static void dedup_remove( int i ) {
+    int j = i;
+
+    for (;;) {
+        j = (j + 1) & Dedup_Mask;
+        if (!Dedup_Table[j].used) {
+            break;
+        }
+
+        // An entry that still sits between its home and the hole stays put
+        int home = Dedup_Table[j].fp.lo & Dedup_Mask;
+        if ((i <= j) ? (i < home && home <= j) : (i < home || home <= j)) {
+            continue;
+        }
+        Dedup_Table[i] = Dedup_Table[j];
+        *dedup_slot_ref(Dedup_Table[i].did, Dedup_Table[i].sec, Dedup_Table[i].blk) = i;
+        i = j;
+    }
+    Dedup_Table[i].used = 0;
+    Dedup_Count--;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_dedup_init
+// Description  : Create an empty index, sized to stay at most half full.
+//
+// Inputs       : capacity - the most blocks that can be stored
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_dedup_init( int capacity ) {
+    int size = 16;
+
+    lcloud_dedup_close();
+    while (size < capacity * 2) {
+        size *= 2;
+    }
+    Dedup_Table = calloc(size, sizeof(LcDedupEntry));
+    if (Dedup_Table == NULL) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Dedup: out of memory for %i entries", size);
+        return -1;
+    }
+    Dedup_Mask = size - 1;
+    Dedup_Count = 0;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_dedup_add_device
+// Description  : Create the reverse array for a device.
+//
+// Inputs       : did - the device, sectors, blocks - its geometry
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_dedup_add_device( LcDeviceId did, uint16_t sectors, uint16_t blocks ) {
+    if (Dedup_Table == NULL || did >= LC_DEDUP_MAX_DEVICES) {
+        return -1;
+    }
+    free(Dedup_Slot[did]);
+    Dedup_Slot[did] = malloc(sectors * blocks * sizeof(int32_t));
+    if (Dedup_Slot[did] == NULL) {
+        return -1;
+    }
+    memset(Dedup_Slot[did], 0xff, sectors * blocks * sizeof(int32_t));
+    Dedup_Blocks[did] = blocks;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_dedup_fingerprint
+// Description  : Hash a block 8 bytes at a time into two independent 64-bit
+//                lanes (multiply, rotate and mix, in the style of xxHash).
+//
+// Inputs       : buf - the 256 byte block, fp - the fingerprint to fill
+// Outputs      : none
+void lcloud_dedup_fingerprint( const char *buf, LcFingerprint *fp ) {
+    uint64_t a = LC_DEDUP_PRIME1, b = LC_DEDUP_PRIME3;
+
+    for (int i = 0; i < LC_DEVICE_BLOCK_SIZE; i += 8) {
+        uint64_t w;
+        memcpy(&w, buf + i, 8);
+        a = (a ^ (w * LC_DEDUP_PRIME2)) * LC_DEDUP_PRIME1;
+        a = (a << 31) | (a >> 33);
+        b = (b + w) * LC_DEDUP_PRIME3;
+        b = (b << 27) | (b >> 37);
+    }
+    fp->lo = dedup_mix(a ^ (b >> 1));
+    fp->hi = dedup_mix(b + a);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_dedup_lookup
+// Description  : Find a physical block that holds the content.
+//
+// Inputs       : fp - the fingerprint
+//                did, sec, blk - set to the physical block if found
+// Outputs      : 0 if found, -1 if not
+int lcloud_dedup_lookup( const LcFingerprint *fp, int *did, int *sec, int *blk ) {
+    if (Dedup_Table == NULL) {
+        return -1;
+    }
+    for (int i = fp->lo & Dedup_Mask; Dedup_Table[i].used; i = (i + 1) & Dedup_Mask) {
+        if (Dedup_Table[i].fp.lo == fp->lo && Dedup_Table[i].fp.hi == fp->hi) {
+            *did = Dedup_Table[i].did;
+            *sec = Dedup_Table[i].sec;
+            *blk = Dedup_Table[i].blk;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_dedup_insert
+// Description  : Record what a physical block now holds.  If the content is
+//                allready indexed at another block that one is kept.
+//
+// Inputs       : fp - the fingerprint, did, sec, blk - the physical block
+// Outputs      : 0 if successful, -1 if the index is full
+int lcloud_dedup_insert( const LcFingerprint *fp, LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    int32_t *slot = dedup_slot_ref(did, sec, blk);
+    int i;
+
+    if (Dedup_Table == NULL || slot == NULL) {
+        return -1;
+    }
+    lcloud_dedup_forget(did, sec, blk);
+
+    for (i = fp->lo & Dedup_Mask; Dedup_Table[i].used; i = (i + 1) & Dedup_Mask) {
+        if (Dedup_Table[i].fp.lo == fp->lo && Dedup_Table[i].fp.hi == fp->hi) {
+            return 0;
+        }
+    }
+    if (Dedup_Count >= Dedup_Mask) {
+        return -1;
+    }
+    Dedup_Table[i].fp = *fp;
+    Dedup_Table[i].used = 1;
+    Dedup_Table[i].did = did;
+    Dedup_Table[i].sec = sec;
+    Dedup_Table[i].blk = blk;
+    Dedup_Count++;
+    *slot = i;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_dedup_forget
+// Description  : Drop a physical block from the index.
+//
+// Inputs       : did, sec, blk - the physical block
+// Outputs      : none
+void lcloud_dedup_forget( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    int32_t *slot = dedup_slot_ref(did, sec, blk);
+
+    if (Dedup_Table == NULL || slot == NULL || *slot < 0) {
+        return;
+    }
+    dedup_remove(*slot);
+    *slot = -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_dedup_close
+// Description  : Release the index.
+//
+// Inputs       : none
+// Outputs      : none
+void lcloud_dedup_close( void ) {
+    free(Dedup_Table);
+    Dedup_Table = NULL;
+    Dedup_Count = 0;
+    for (int d = 0; d < LC_DEDUP_MAX_DEVICES; d++) {
+        free(Dedup_Slot[d]);
+        Dedup_Slot[d] = NULL;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef LCLOUD_DEDUP_INCLUDED
+#define LCLOUD_DEDUP_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_dedup.h
+//  Description    : This is the block deduplication index for the Lion Cloud
+//                   filesystem.  Blocks are fingerprinted by their content so
+//                   a write of data that is allready stored can share the
+//                   existing physical block.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+#include <lcloud_controller.h>
+
+// Defines
+#define LC_DEDUP_MAX_DEVICES 15
+
+// The 128-bit fingerprint of a block's content
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} LcFingerprint;
+
+//
+// Functional Prototypes
+
+int lcloud_dedup_init( int capacity );
+    // Create an empty index for up to capacity blocks
+
+int lcloud_dedup_add_device( LcDeviceId did, uint16_t sectors, uint16_t blocks );
+    // Let the index hold blocks of a device
+
+void lcloud_dedup_fingerprint( const char *buf, LcFingerprint *fp );
+    // Fingerprint a 256 byte block
+
+int lcloud_dedup_lookup( const LcFingerprint *fp, int *did, int *sec, int *blk );
+    // Find a physical block holding the content
+
+int lcloud_dedup_insert( const LcFingerprint *fp, LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Record the content of a physical block (replacing what it held before)
+
+void lcloud_dedup_forget( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Drop a physical block from the index (freed or changed)
+
+void lcloud_dedup_close( void );
+    // Release the index
+
+#endif
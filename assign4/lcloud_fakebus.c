@@ -0,0 +1,273 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_fakebus.c
+//  Description    : This is the in-memory Lion Cloud bus the tests link in
+//                   place of lcloud_client.o.  It answers the same requests
+//                   as lcloud_server for three small devices.  Unlike the
+//                   server it keeps the devices over a power off (in a
+//                   file), so the tests can remount, and it can keep them
+//                   without one (lcloud_fakebus_crash).
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// Project include files
+#include <lcloud_fakebus.h>
+#include <lcloud_network.h>
+
+// The devices: id, sectors, blocks per sector.
+static const int Fake_Geometry[][3] = { {3, 10, 64}, {5, 20, 20}, {9, 30, 40} };
+#define FAKE_DEVICES ((int)(sizeof(Fake_Geometry) / sizeof(Fake_Geometry[0])))
+
+// The devices' blocks (by device id), where each next block follows on
+// from (the last one moved plus one), and the counts since power on.
+static char *Fake_Blocks[16];
+static size_t Fake_Next[16];
+static LcFakeBusStats Fake_Stats;
+
+// The register fields (see lcloud_controller.h).
+#define FAKE_C0(r) ((int)(((r) >> 48) & 0xff))
+#define FAKE_C1(r) ((int)(((r) >> 40) & 0xff))
+#define FAKE_C2(r) ((int)(((r) >> 32) & 0xff))
+#define FAKE_D0(r) ((int)(((r) >> 16) & 0xffff))
+#define FAKE_D1(r) ((int)((r) & 0xffff))
+#define FAKE_OK (((LCloudRegisterFrame)1 << 60) | ((LCloudRegisterFrame)1 << 56))
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : fake_path
+// Description  : The file the devices are kept in.
+//
+// Inputs       : none
+// Outputs      : the path
+static const char * fake_path( void ) {
+    const char *path = getenv("LC_FAKEBUS_PATH");
+    return (path != NULL) ? path : LC_FAKEBUS_DEFAULT_PATH;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : fake_size
+// Description  : The blocks on a device.
+//
+// Inputs       : i - which device (index into Fake_Geometry)
+// Outputs      : the number of blocks
+static size_t fake_size( int i ) {
+    return (size_t)Fake_Geometry[i][1] * Fake_Geometry[i][2];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : fake_power_on
+// Description  : Bring the devices up, as they were kept (empty if not).
+//
+// Inputs       : none
+// Outputs      : none
+static void fake_power_on( void ) {
+    FILE *f = fopen(fake_path(), "rb");
+
+    for (int i = 0; i < FAKE_DEVICES; i++) {
+        int did = Fake_Geometry[i][0];
+        if (Fake_Blocks[did] == NULL) {
+            Fake_Blocks[did] = malloc(fake_size(i) * LC_DEVICE_BLOCK_SIZE);
+        }
+        memset(Fake_Blocks[did], 0, fake_size(i) * LC_DEVICE_BLOCK_SIZE);
+        if (f != NULL && fread(Fake_Blocks[did], LC_DEVICE_BLOCK_SIZE, fake_size(i), f) != fake_size(i)) {
+            memset(Fake_Blocks[did], 0, fake_size(i) * LC_DEVICE_BLOCK_SIZE);
+        }
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+    memset(Fake_Next, 0, sizeof(Fake_Next));
+    memset(&Fake_Stats, 0, sizeof(Fake_Stats));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_fakebus_crash
+// Description  : Keep the devices as they are now (a power off does the
+//                same).  A test then exits without lcshutdown.
+//
+// Inputs       : none
+// Outputs      : none
+void lcloud_fakebus_crash( void ) {
+    FILE *f = fopen(fake_path(), "wb");
+
+    if (f == NULL) {
+        return;
+    }
+    for (int i = 0; i < FAKE_DEVICES; i++) {
+        if (Fake_Blocks[Fake_Geometry[i][0]] != NULL) {
+            fwrite(Fake_Blocks[Fake_Geometry[i][0]], LC_DEVICE_BLOCK_SIZE, fake_size(i), f);
+        }
+    }
+    fclose(f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_fakebus_wipe
+// Description  : Forget the kept devices.
+//
+// Inputs       : none
+// Outputs      : none
+void lcloud_fakebus_wipe( void ) {
+    unlink(fake_path());
+    for (int i = 0; i < FAKE_DEVICES; i++) {
+        free(Fake_Blocks[Fake_Geometry[i][0]]);
+        Fake_Blocks[Fake_Geometry[i][0]] = NULL;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_fakebus_stats
+// Description  : Get what went over the bus since power on.
+//
+// Inputs       : stats - place to put the counts
+// Outputs      : none
+void lcloud_fakebus_stats( LcFakeBusStats *stats ) {
+    *stats = Fake_Stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_fakebus_corrupt
+// Description  : Damage the stored copy of blocks (the filesystem's cache
+//                still holds the good one): every block that starts with
+//                16 bytes of marker has one bit flipped.
+//
+// Inputs       : marker - the byte the damaged blocks start with
+// Outputs      : the blocks damaged
+int lcloud_fakebus_corrupt( char marker ) {
+    int damaged = 0;
+
+    for (int i = 0; i < FAKE_DEVICES; i++) {
+        char *blocks = Fake_Blocks[Fake_Geometry[i][0]];
+        for (size_t k = 0; blocks != NULL && k < fake_size(i); k++) {
+            char *block = blocks + k * LC_DEVICE_BLOCK_SIZE;
+            int j = 0;
+            while (j < 16 && block[j] == marker) {
+                j++;
+            }
+            if (j == 16) {
+                block[100] ^= 1;
+                damaged++;
+            }
+        }
+    }
+    return damaged;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : client_lcloud_bus_request
+// Description  : Answer one request, as lcloud_server would.
+//
+// Inputs       : reg - the request, buf - the block for a transfer
+// Outputs      : the response (b1 is 0 if the request failed)
+LCloudRegisterFrame client_lcloud_bus_request( LCloudRegisterFrame reg, void *buf ) {
+    int did = FAKE_C1(reg), sec = FAKE_D0(reg), blk = FAKE_D1(reg);
+    LCloudRegisterFrame mask = 0;
+
+    Fake_Stats.requests++;
+    Fake_Stats.round_trips++;
+    switch (FAKE_C0(reg)) {
+    case LC_POWER_ON:
+        fake_power_on();
+        return FAKE_OK;
+
+    case LC_DEVPROBE:
+        for (int i = 0; i < FAKE_DEVICES; i++) {
+            mask |= (LCloudRegisterFrame)1 << Fake_Geometry[i][0];
+        }
+        return FAKE_OK | ((LCloudRegisterFrame)LC_DEVPROBE << 48) | (mask << 16);
+
+    case LC_DEVINIT:
+        for (int i = 0; i < FAKE_DEVICES; i++) {
+            if (Fake_Geometry[i][0] == did) {
+                return FAKE_OK | ((LCloudRegisterFrame)LC_DEVINIT << 48) | ((LCloudRegisterFrame)did << 40) |
+                       ((LCloudRegisterFrame)Fake_Geometry[i][1] << 16) | (LCloudRegisterFrame)Fake_Geometry[i][2];
+            }
+        }
+        return (LCloudRegisterFrame)1 << 60;
+
+    case LC_BLOCK_XFER:
+        for (int i = 0; i < FAKE_DEVICES; i++) {
+            if (Fake_Geometry[i][0] != did || Fake_Blocks[did] == NULL || buf == NULL) {
+                continue;
+            }
+            if (sec >= Fake_Geometry[i][1] || blk >= Fake_Geometry[i][2]) {
+                break;
+            }
+            size_t at = (size_t)sec * Fake_Geometry[i][2] + blk;
+            char *block = Fake_Blocks[did] + at * LC_DEVICE_BLOCK_SIZE;
+            Fake_Stats.jumps += (at != Fake_Next[did]);
+            Fake_Next[did] = at + 1;
+            if (FAKE_C2(reg) == LC_XFER_READ) {
+                memcpy(buf, block, LC_DEVICE_BLOCK_SIZE);
+                Fake_Stats.reads++;
+            }
+            else {
+                memcpy(block, buf, LC_DEVICE_BLOCK_SIZE);
+                Fake_Stats.writes++;
+            }
+            return FAKE_OK | (reg & 0x00ffffffffffffffULL);
+        }
+        return (LCloudRegisterFrame)1 << 60;
+
+    case LC_POWER_OFF:
+        lcloud_fakebus_crash();
+        return FAKE_OK | ((LCloudRegisterFrame)LC_POWER_OFF << 48);
+    }
+    return (LCloudRegisterFrame)1 << 60;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : client_lcloud_connect
+// Description  : There is nothing to connect to.
+//
+// Inputs       : none
+// Outputs      : 0
+int client_lcloud_connect( void ) {
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : client_lcloud_bus_batch
+// Description  : Answer a run of requests that move no data (one round trip).
+//
+// Inputs       : regs - the requests, replaced by the responses
+//                count - how many
+// Outputs      : 0
+int client_lcloud_bus_batch( LCloudRegisterFrame *regs, int count ) {
+    return client_lcloud_bus_xfer_batch(regs, NULL, count);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : client_lcloud_bus_xfer_batch
+// Description  : Answer a run of requests (one round trip).
+//
+// Inputs       : regs - the requests, replaced by the responses
+//                bufs - the block for each (NULL if none move data)
+//                count - how many
+// Outputs      : 0
+int client_lcloud_bus_xfer_batch( LCloudRegisterFrame *regs, char **bufs, int count ) {
+    for (int i = 0; i < count; i++) {
+        regs[i] = client_lcloud_bus_request(regs[i], (bufs != NULL) ? bufs[i] : NULL);
+        Fake_Stats.round_trips--;
+    }
+    Fake_Stats.round_trips += (count > 0);
+    return 0;
+}
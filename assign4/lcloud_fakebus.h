@@ -0,0 +1,50 @@
+#ifndef LCLOUD_FAKEBUS_INCLUDED
+#define LCLOUD_FAKEBUS_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_fakebus.h
+//  Description    : This is the interface of the in-memory Lion Cloud bus
+//                   used by the tests in place of lcloud_client.o.  The
+//                   devices are kept in a file between power cycles, so a
+//                   test can "crash" (keep the devices, skip lcshutdown)
+//                   and mount them again.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdint.h>
+
+// Project include files
+#include <lcloud_controller.h>
+
+// Defines
+#define LC_FAKEBUS_DEFAULT_PATH "/tmp/lcloud_fakebus.bin" // Where the devices are kept (LC_FAKEBUS_PATH overrides)
+
+// What went over the bus since power on
+typedef struct {
+    uint64_t requests;      // Every request (batched or not)
+    uint64_t round_trips;   // A single request or a whole batch
+    uint64_t reads;         // Blocks read
+    uint64_t writes;        // Blocks written
+    uint64_t jumps;         // Blocks moved that do not follow the last one moved on their device
+} LcFakeBusStats;
+
+//
+// Functional Prototypes
+
+void lcloud_fakebus_wipe( void );
+    // Forget the kept devices (the next power on finds them empty)
+
+void lcloud_fakebus_crash( void );
+    // Keep the devices as they are now, as if the power was cut
+
+void lcloud_fakebus_stats( LcFakeBusStats *stats );
+    // Get the counts since power on
+
+int lcloud_fakebus_corrupt( char marker );
+    // Flip a bit in every stored block that starts with 16 of marker
+
+#endif
@@ -0,0 +1,208 @@
+#ifndef LCLOUD_FILE_INCLUDED
+#define LCLOUD_FILE_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_file.hpp
+//  Description    : This is the C++ (C++20) interface to the Lion Cloud
+//                   filesystem.  LcFile owns a file handle and closes it
+//                   when it goes away (it can be moved, never copied), the
+//                   I/O takes std::span so data goes straight to and from
+//                   the caller's storage, and LcBuffer holds whole blocks
+//                   of aligned memory from the buffer pool.  Everything is
+//                   inline over the C calls in lcloud_filesys.h.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <utility>
+#include <lcloud_filesys.h>
+#include <lcloud_pool.h>
+#include <lcloud_controller.h>
+
+namespace lcloud {
+
+inline constexpr std::size_t LcBlockSize = LC_DEVICE_BLOCK_SIZE;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Class        : LcBuffer
+// Description  : Aligned memory from the buffer pool (given back to it, not
+//                freed, when the buffer goes away).  The size is what was
+//                asked for, the capacity that rounded up to whole blocks.
+//
+class LcBuffer {
+public:
+    LcBuffer() noexcept = default;
+
+    explicit LcBuffer( std::size_t size ) noexcept {
+        data_ = static_cast<std::byte *>(lcloud_pool_get(size, &capacity_));
+        size_ = (data_ != nullptr) ? size : 0;
+    }
+
+    LcBuffer( LcBuffer &&other ) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {}
+
+    LcBuffer & operator=( LcBuffer &&other ) noexcept {
+        if (this != &other) {
+            lcloud_pool_put(data_, capacity_);
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+            capacity_ = std::exchange(other.capacity_, 0);
+        }
+        return *this;
+    }
+
+    LcBuffer( const LcBuffer & ) = delete;
+    LcBuffer & operator=( const LcBuffer & ) = delete;
+
+    ~LcBuffer() {
+        lcloud_pool_put(data_, capacity_);
+    }
+
+    std::byte * data() noexcept { return data_; }
+    const std::byte * data() const noexcept { return data_; }
+    std::size_t size() const noexcept { return size_; }
+    std::size_t capacity() const noexcept { return capacity_; }
+    explicit operator bool() const noexcept { return data_ != nullptr; }
+
+    std::span<std::byte> span() noexcept { return {data_, size_}; }
+    std::span<const std::byte> span() const noexcept { return {data_, size_}; }
+
+    // Change the size within the capacity (false if it does not fit)
+    bool resize( std::size_t size ) noexcept {
+        if (data_ == nullptr || size > capacity_) {
+            return false;
+        }
+        size_ = size;
+        return true;
+    }
+
+private:
+    std::byte *data_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t capacity_ = 0;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Class        : LcFile
+// Description  : An open file.  The calls return what the C calls return
+//                (bytes moved, or -1 if failure), nothing is thrown.
+//
+class LcFile {
+public:
+    static constexpr LcFHandle None = -1;
+
+    LcFile() noexcept = default;
+
+    // Take ownership of a handle from lcopen
+    explicit LcFile( LcFHandle fh ) noexcept : fh_(fh) {}
+
+    static LcFile open( const char *path ) noexcept {
+        return LcFile(lcopen(path));
+    }
+
+    LcFile( LcFile &&other ) noexcept : fh_(std::exchange(other.fh_, None)) {}
+
+    LcFile & operator=( LcFile &&other ) noexcept {
+        if (this != &other) {
+            close();
+            fh_ = std::exchange(other.fh_, None);
+        }
+        return *this;
+    }
+
+    LcFile( const LcFile & ) = delete;
+    LcFile & operator=( const LcFile & ) = delete;
+
+    ~LcFile() {
+        close();
+    }
+
+    bool is_open() const noexcept { return fh_ != None; }
+    explicit operator bool() const noexcept { return is_open(); }
+    LcFHandle handle() const noexcept { return fh_; }
+
+    // Give up the handle without closing it
+    LcFHandle release() noexcept {
+        return std::exchange(fh_, None);
+    }
+
+    int close() noexcept {
+        return is_open() ? lcclose(std::exchange(fh_, None)) : 0;
+    }
+
+    int seek( std::size_t off ) noexcept {
+        return is_open() ? lcseek(fh_, off) : -1;
+    }
+
+    // LC_PRIO_FOREGROUND or LC_PRIO_BACKGROUND, and a share (see lcpriority)
+    int priority( int prio, int weight = 1 ) noexcept {
+        return lcpriority(fh_, prio, weight);
+    }
+
+    // Read at the read/write head (exactly out.size() bytes, less at the end)
+    int read( std::span<std::byte> out ) noexcept {
+        LcIoVec seg = { reinterpret_cast<char *>(out.data()), out.size(), LC_IOV_HEAD };
+        return lcreadv(fh_, &seg, 1);
+    }
+
+    // Write at the read/write head
+    int write( std::span<const std::byte> in ) noexcept {
+        if (!is_open()) {
+            return -1;
+        }
+        return in.empty() ? 0 : lcwrite(fh_, const_cast<char *>(reinterpret_cast<const char *>(in.data())), in.size());
+    }
+
+    // Read and write at a place in the file (the read/write head does not move)
+    int pread( std::span<std::byte> out, std::size_t off ) noexcept {
+        return lcpread(fh_, reinterpret_cast<char *>(out.data()), out.size(), off);
+    }
+
+    int pwrite( std::span<const std::byte> in, std::size_t off ) noexcept {
+        return lcpwrite(fh_, const_cast<char *>(reinterpret_cast<const char *>(in.data())), in.size(), off);
+    }
+
+    // Many segments at once (see lcreadv and lcwritev)
+    int readv( std::span<const LcIoVec> segs ) noexcept {
+        return lcreadv(fh_, segs.data(), static_cast<int>(segs.size()));
+    }
+
+    int writev( std::span<const LcIoVec> segs ) noexcept {
+        return lcwritev(fh_, segs.data(), static_cast<int>(segs.size()));
+    }
+
+    // Whole blocks at a block of the file, the size checked when compiled.
+    // The blocks are fetched together and read straight into out, and a
+    // write replaces each block without reading it back (see
+    // lcpread_blocks and lcpwrite_blocks).
+    template <std::size_t N>
+        requires (N != std::dynamic_extent && N > 0 && N % LcBlockSize == 0)
+    int read_blocks( std::size_t block, std::span<std::byte, N> out ) noexcept {
+        return lcpread_blocks(fh_, reinterpret_cast<char *>(out.data()), block, static_cast<int>(N / LcBlockSize));
+    }
+
+    template <std::size_t N>
+        requires (N != std::dynamic_extent && N > 0 && N % LcBlockSize == 0)
+    int write_blocks( std::size_t block, std::span<const std::byte, N> in ) noexcept {
+        return lcpwrite_blocks(fh_, const_cast<char *>(reinterpret_cast<const char *>(in.data())), block, static_cast<int>(N / LcBlockSize));
+    }
+
+private:
+    LcFHandle fh_ = None;
+};
+
+static_assert(sizeof(LcFile) == sizeof(LcFHandle), "LcFile is only its handle");
+
+} // namespace lcloud
+
+#endif
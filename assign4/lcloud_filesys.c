@@ -10,21 +10,55 @@
 
 // Include files
 #include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
 #include <string.h>
+#include <time.h>
 #include <cmpsc311_log.h>
 #include <assert.h>
+#include <pthread.h>
 
 // Project include files
 #include <lcloud_cache.h>
 #include <lcloud_filesys.h>
 #include <lcloud_controller.h>
 #include <lcloud_network.h>
+#include <lcloud_journal.h>
+#include <lcloud_logfs.h>
+#include <lcloud_compress.h>
+#include <lcloud_dedup.h>
+#include <lcloud_crc32c.h>
+#include <lcloud_xfer.h>
+#include <lcloud_mrc.h>
+#include <lcloud_arena.h>
+#include <lcloud_l2.h>
+#include <lcloud_sched.h>
 
 //
 // File system interface implementation
 
 // Define 
 int Cache_Enabled = 1;  //<-- SET TO 1 TO ENABE THE CACHE 
+int Journal_Enabled = 1;  //<-- SET TO 1 TO KEEP THE FILE MAPS IN THE ON-DEVICE JOURNAL
+int Log_Structured_Enabled = 0;  //<-- SET TO 1 TO APPEND EVERY WRITE TO A LOG (LOG-STRUCTURED LAYOUT)
+int Compress_Enabled = 0;  //<-- SET TO 1 TO PACK COMPRESSIBLE BLOCKS INTO SLOTS OF SHARED BLOCKS (NOT WITH THE LOG)
+int Dedup_Enabled = 0;  //<-- SET TO 1 TO SHARE ONE PHYSICAL BLOCK BETWEEN BLOCKS WITH THE SAME DATA (NOT WITH THE LOG)
+int Tail_Pack_Enabled = 1;  //<-- SET TO 1 TO PACK THE PARTIAL LAST BLOCK OF EACH FILE INTO SLOTS OF A SHARED BLOCK (NOT WITH THE LOG, COMPRESSION OR DEDUP)
+int Checksum_Enabled = 1;  //<-- SET TO 1 TO KEEP A CRC32C OF EVERY BLOCK AND CHECK IT ON EVERY READ
+int Write_Buffer_Blocks = 8;  //<-- BLOCKS OF WRITES HELD PER FILE BEFORE THEY GO TO THE DEVICES (0 TO WRITE THROUGH)
+int Cache_Stats_Interval = 0;  //<-- SET TO N TO DUMP THE CACHE STATISTICS EVERY N SECONDS (AND AT SHUTDOWN)
+const char *Cache_Stats_Path = NULL;  //<-- SET TO A FILE NAME TO APPEND THE DUMPS THERE INSTEAD OF THE LOG
+int MRC_Enabled = 1;  //<-- SET TO 1 TO ESTIMATE THE CACHE'S MISS RATIO CURVE WHILE RUNNING (SAMPLED, CHEAP)
+int Cache_Target_Hit_Percent = 0;  //<-- SET TO N TO RESIZE THE CACHE TOWARDS THE SIZE PREDICTED TO HIT N PERCENT
+int Cache_L2_Enabled = 0;  //<-- SET TO 1 TO KEEP BLOCKS PUSHED OUT OF THE CACHE IN A LOCAL FILE (KEPT WARM BETWEEN RUNS)
+const char *Cache_L2_Path = "lcloud_cache.l2";  //<-- THE FILE FOR THE LOCAL CACHE TIER
+int Cache_Warm_Enabled = 0;  //<-- SET TO 1 TO SAVE WHICH BLOCKS ARE CACHED AT SHUTDOWN AND LOAD THEM AGAIN AT POWER ON
+const char *Cache_Warm_Path = "lcloud_cache.keys";  //<-- THE FILE FOR THE LIST OF CACHED BLOCKS
+int Topology_Cache_Enabled = 0;  //<-- SET TO 1 TO REUSE THE SAVED DEVICE SIZES WHEN THE PROBE FINDS THE SAME DEVICES
+const char *Topology_Path = "lcloud_topology";  //<-- THE FILE FOR THE SAVED DEVICE SIZES
+int Sched_Queue_Depth = 16;  //<-- TRANSFERS SENT PER ROUND TRIP (1 TO 16), IN ELEVATOR ORDER ON EACH DEVICE WITH REPEATS MERGED
+int Delayed_Allocation_Blocks = 16;  //<-- SET TO N TO PLACE A FILE'S NEW BLOCKS WHEN THEY ARE FLUSHED, IN RUNS OF N FREE BLOCKS PUT ASIDE FOR IT (0 FOR ANY FREE BLOCK)
+int Io_Priority_Enabled = 1;  //<-- SET TO 1 TO LET READS IN FIRST, THEN WRITES, THEN BACKGROUND FILES (FAIR BETWEEN FILES BY WEIGHT)
 
 // Create the layout for the 64-bit buss address (the shifting does not work when they are diffrent sizes)
 struct Buss{
@@ -43,6 +77,16 @@ struct Block{
     int sector;
     int block;
     int allocated;
+
+    // The compressed extent (only if Compress_Enabled packed the block)
+    int slot;   // First slot used in the packed block
+    int slots;  // Slots used, 0 if the block is stored whole
+    int clen;   // Compressed length in bytes
+
+    // The CRC32C of the block's data (see Checksum_Enabled)
+    uint32_t crc;
+    uint8_t crc_valid;  // The crc is known
+    uint8_t crc_dirty;  // The crc changed since it was last journaled
 };
 
 // Create the format/frame for all file handles. (one for every file.)
@@ -54,6 +98,36 @@ struct Files{
     int16_t Number; 
     int16_t Device_Id;
     char Path;
+    char File_Name[LC_JOURNAL_MAX_NAME]; // The full path (used to find the file again after a restart)
+    int Length_Journaled;   // The length the journal has
+    int Placed_End;     // The end of the last block whose place the journal has (the journaled length never runs past it)
+
+    // The last block written, so the next write into it does not read it back.
+    char Last_Data[256];
+    int Last_Block;     // The file block held in Last_Data
+    int Last_Valid;     // If Last_Data is current
+
+    // The write buffer, a run of blocks not yet on the devices (see Write_Buffer_Blocks).
+    char *Buffer;
+    int Buffer_First;   // The file block of the first one
+    int Buffer_Count;   // How many are held
+
+    // How the file's reads did in the cache.
+    int Cache_Hits;
+    int Cache_Misses;
+
+    // Its calls are background work (see lcpriority).
+    int8_t Background;
+    // Its share of its class at the gate (0 is 1, see lcpriority).
+    int8_t Weight;
+
+    // Free blocks put aside for its new blocks (see Delayed_Allocation_Blocks).
+    int Run_Device;
+    int Run_Sector;
+    int Run_Block;      // The next one to use
+    int Run_Count;      // How many are left
+    int Run_Valid;      // Run_Device/Sector/Block is just after its last new block
+    int Run_Size;       // The size of its next run (doubles as the file grows)
 
     //(hold the data positions.)
     struct Block block[2000]; // <-- May have to have this dynamic.
@@ -65,6 +139,14 @@ struct Files FILE_HANDLE[2000]; // <-- May have to have this dynamic.
 // Bus is on?
 int buss_on = 0;
 
+// Only one thread at a time is inside the filesystem (the cache, the bus and
+// the allocation are shared), and each file's map is held steady while it is
+// read (shared) or changed (exclusive).  Take the file's lock first.  The
+// calls waiting to get in are let in by priority (see Fs_Enter).
+pthread_mutex_t Fs_Lock = PTHREAD_MUTEX_INITIALIZER;
+pthread_rwlock_t File_Lock[2000];
+pthread_once_t File_Lock_Once = PTHREAD_ONCE_INIT;
+
 //int FILE_HANDLE[15];
 int Number_Of_Devices_On;
 
@@ -77,9 +159,14 @@ struct Devices{
     int Number_Of_Blocks;   // Store the number of blocks; for this current device.
 
     // 2-D array for the data structure that is used for the divice (what is ued)
+    // 0 if free, else the number of file blocks using it (more than 1 when deduplicated)
     int Used_Blocks [200][200]; // <-- May have to have this dynamic.
 
+    // The slots in use of each packed block (one bit per slot)
+    uint8_t Used_Slots [200][200];
+
     int Device_Full;
+    int Free_Hint;  // Every block before this one (sector * blocks + block) is in use
 }device[15];
 
 // Create a globle verabel, to make sure no two file_handles are given the same number.
@@ -95,6 +182,96 @@ struct Cache{
     int misses; 
 }Stats;
 
+struct Compress{
+
+    // What happened to the blocks written with Compress_Enabled.
+    int packed;     // Stored in slots
+    int skipped;    // Skipped by the sampler (no repeats)
+    int whole;      // Tried but did not save a slot
+}Compress_Stats;
+
+struct Tail{
+
+    // What happened to the partial last blocks with Tail_Pack_Enabled.
+    int packed;     // Stored in slots of a shared block
+    int whole;      // Did not save a slot, or filled up and moved out to a whole block
+}Tail_Stats;
+
+struct Dedup{
+
+    // What happened to the blocks written with Dedup_Enabled.
+    int shared;     // Pointed at an existing copy (no transfer)
+    int stored;     // New content, written out
+    int collisions; // Fingerprint matched but the data did not
+}Dedup_Stats;
+
+struct Checksum{
+
+    // What the CRC32C checks found on reads.
+    int verified;   // Blocks checked
+    int failures;   // Blocks that did not match
+    int repaired;   // Bad copies in the cache fixed from the device
+}Checksum_Stats;
+
+struct Write{
+
+    // How lcwrite got the old contents of the blocks it changed.
+    int covered;    // Whole block (or up to the end of the file) replaced, nothing read
+    int merged;     // Taken from the last block written to the file
+    int read;       // Read back from the cache or the device
+
+    // What the write buffers saved.
+    int absorbed;   // Writes into a block that was allready buffered
+    int flushes;    // Times a buffer was sent out
+    int flushed;    // Blocks sent out from the buffers
+}Write_Stats;
+
+// Device writes held back to go out together (see Write_Batch_Begin).
+struct Batch{
+    int Open;       // Writes are being held
+    int Count;      // Blocks held
+    LcXferBlock Xfer[LC_XFER_BATCH_MAX];
+    char Data[LC_XFER_BATCH_MAX][256];
+
+    // New blocks to journal once their data is on the devices.
+    int Maps;
+    LcFHandle Map_File[LC_XFER_BATCH_MAX];
+    int Map_Block[LC_XFER_BATCH_MAX];
+
+    // What the batches saved.
+    int batches;    // Batches sent
+    int batched;    // Blocks sent in them
+    int prefetched; // Blocks read in batches ahead of a vectored read or write
+}Write_Batch;
+
+// The runs of free blocks put aside for files (see Run_Take).
+struct Runs{
+    int Wanted;     // New blocks the flush going out still has to place (0 if none is)
+
+    // What the runs did.
+    int runs;       // Runs put aside
+    int carried;    // Of them, runs that carried on from the last one
+    int placed;     // New blocks placed in them
+    int returned;   // Blocks left over and freed again
+}Run_Stats;
+
+// The packed block new slots are taken from (allocated is 0 if none).
+struct Block Pack_Open;
+
+// Where the write buffers come from (given back at shutdown).
+LcArena Buffer_Arena;
+
+// Where a vectored call's plan and blocks come from.  It is reset at the
+// end of each call (under Fs_Lock) and keeps its first chunk, so only a
+// call of more than about two hundred blocks goes to malloc.
+LcArena Iov_Arena;
+
+// When the cache statistics are next dumped (see Cache_Stats_Interval).
+time_t Cache_Stats_Next = 0;
+
+// Accesses since the cache size was last checked against the curve.
+int Mrc_Accesses = 0;
+
 ////////////////////////////////////////////////////////////////////////////////
 //
 // Function     : create_lcloud_registers
@@ -263,230 +440,2012 @@ void Lc_Device_Setup (int8_t device_Id) {
     // d1 - holds the number of blocks in the device.
     device[device_Id].Number_Of_Blocks = BUSS_ADDRESS.d1;
 
-    logMessage(LOG_OUTPUT_LEVEL, "          ### Number of Sectors: '%i' Number of Blocks: '%i' ###", BUSS_ADDRESS.d0, device[device_Id].Number_Of_Blocks);  
+    logMessage(LOG_OUTPUT_LEVEL, "          ### Number of Sectors: '%i' Number of Blocks: '%i' ###", BUSS_ADDRESS.d0, device[device_Id].Number_Of_Blocks);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : lcopen
-// Description  : Open the file for for reading and writing
+// Function     : Topology_Load
+// Description  : Take the device sizes from the topology file, if it was
+//                saved for the same probe mask.  The file is text: a
+//                "lcloud-topology 1 <mask>" line, then "<device> <sectors>
+//                <blocks>" for each device in the mask.
 //
-// Inputs       : path - the path/filename of the file to be read
-// Outputs      : file handle if successful test, -1 if failure
-LcFHandle lcopen(const char *path ) {
-    // Log the input peramiters. 
-    logMessage(LOG_OUTPUT_LEVEL, "          ### TASK: < OPEN FILE > ");
-    logMessage(LOG_OUTPUT_LEVEL, "          ### Path handed to the lopen function '%s' ###", path);  
-    
-    struct Buss BUSS_ADDRESS;  // Create a object of the structre 
-
-    File_Counter++;
-
-    // Check if device is powered on.
-    if (buss_on == 0) {
-        logMessage(LOG_OUTPUT_LEVEL, "          ### Powering on the buss ###");
-        Power_On(&BUSS_ADDRESS);
-
-        // Allocate the cache
-        lcloud_initcache(LC_CACHE_MAXBLOCKS);
-        Stats.hits = 0;
-        Stats.misses = 0;
-        
-        // Check if file already open (fail if already open) from a list 
-        Lc_Probe_Buss (&BUSS_ADDRESS);
-
-        // Get the device ID.
-        for (int i = 0; i < 15; i++) {
-            
-            // Shift to the righ counting up then return when ever there is a 1
-            if (((BUSS_ADDRESS.d0 >> i) & (int)1) == (int)1) {
-                logMessage(LOG_OUTPUT_LEVEL, "          ### Device #%i is on the Bus ###", i);
-
-                // assigne the value of the device to the array.
-                Number_Of_Devices_On = Device_Counter;
-                Device_Counter ++;
-
-                // Create a struct for the device.
-                device[i].Power = 1;
-                device[i].Number = i;
-
-                // find the ammount of blocks and sectors on that device.
-                Lc_Device_Setup(i);
-            }
-
+// Inputs       : mask - the devices the probe found
+// Outputs      : 0 - if every device's size was found. Else; -1
+int Topology_Load (uint16_t mask) {
+    unsigned int version, saved;
+    int found = 0, id, sectors, blocks;
+    FILE *in = fopen(Topology_Path, "r");
+
+    if (in == NULL) {
+        return -1;
+    }
+    if (fscanf(in, "lcloud-topology %u %u", &version, &saved) != 2 || version != 1 || saved != mask) {
+        fclose(in);
+        return -1;
+    }
+    while (fscanf(in, "%i %i %i", &id, &sectors, &blocks) == 3) {
+        if (id < 0 || id >= 15 || ((mask >> id) & 1) == 0 || sectors <= 0 || blocks <= 0) {
+            fclose(in);
+            return -1;
         }
-        
+        device[id].Number_Of_Sectors = sectors;
+        device[id].Number_Of_Blocks = blocks;
+        found++;
     }
-    logMessage(LOG_OUTPUT_LEVEL, "          ### Lc Handle number'%i'", File_Counter);
-
-    // If file does not exist, set length to 0
-    FILE_HANDLE[File_Counter].Path = *path;
-    FILE_HANDLE[File_Counter].length = 0;
-
-    // Return file handle 
-    return(File_Counter); 
-    
-    // if doesn't exsit 
-    //return("-1"); // Likely wrong
-} 
+    fclose(in);
+    return (found == __builtin_popcount(mask & 0x7fff)) ? 0 : -1;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : Check_Return_Values
-// Description  : Check if the device and retrun address was sucessfull.
+// Function     : Topology_Save
+// Description  : Save the device sizes for the next power on (written beside
+//                the file and renamed over it, so it is never half written).
 //
-// Inputs       : The LCloudRegisterFrame 64-bit register and a pointer to the buss adress struct.
-// Outputs      : 0 - For compleating successfully.
-int Check_Return_Values (LCloudRegisterFrame Packed_Registers, struct Buss *BUSS_ADDRESS) {
-
-    // Unpack the registor
-    extract_lcloud_registers(Packed_Registers, BUSS_ADDRESS);    
-
-    // Check if the retrun values are correct
-    if (BUSS_ADDRESS->b1 == 1) {
-        return 0; // Task compleated sucessfully.
+// Inputs       : mask - the devices the probe found
+// Outputs      : none
+void Topology_Save (uint16_t mask) {
+    char temp[1024];
+    FILE *out;
+
+    snprintf(temp, sizeof(temp), "%s.tmp", Topology_Path);
+    out = fopen(temp, "w");
+    if (out == NULL) {
+        return;
     }
-    else {
-        
-        return -1; // The task was un-sucsessfull.
+    fprintf(out, "lcloud-topology 1 %u\n", mask);
+    for (int i = 0; i < 15; i++) {
+        if ((mask >> i) & 1) {
+            fprintf(out, "%i %i %i\n", i, device[i].Number_Of_Sectors, device[i].Number_Of_Blocks);
+        }
+    }
+    if (fclose(out) != 0 || rename(temp, Topology_Path) != 0) {
+        remove(temp);
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : Write_block
-// Description  : This takes one block (exactly 256), and sends it to the client_lcloud_bus_request. 
+// Function     : Lc_Device_Discover
+// Description  : Find the sectors and blocks of every device the probe found.
+//                The LC_DEVINIT requests all go out in one batch, so the
+//                whole bus costs one round trip, and none go out at all if
+//                the topology file was saved for the same probe mask (see
+//                Topology_Cache_Enabled).
 //
-// Inputs       : The device id, sector and block position to send the block too. Then the buf pointer that holds the data to be written
-// Outputs      : the retrun registers.
-int Write_block (int Device_ID, int Sector, int Block, char *buf) {
-
-    char buf_Pointer[255];
-
-    memcpy(buf_Pointer, buf, 256);
-
-    // Write to the cache: 
-    lcloud_putcache(Device_ID, Sector, Block, buf_Pointer);
-
-    // Create a buss address object for packing.
+// Inputs       : mask - the devices the probe found
+// Outputs      : none
+void Lc_Device_Discover (uint16_t mask) {
+    LCloudRegisterFrame Requests[15];
+    int Ids[15], Count = 0;
     struct Buss BUSS_ADDRESS;
 
-    //c2 - LC_XFER_WRITE for write
-    BUSS_ADDRESS.b0 = 0;
-    BUSS_ADDRESS.b1 = 0;
-    BUSS_ADDRESS.c0 = LC_BLOCK_XFER;  // ALWAYS the op code. 
-    BUSS_ADDRESS.c1 = Device_ID;
-    BUSS_ADDRESS.c2 = LC_XFER_WRITE;
-    BUSS_ADDRESS.d0 = Sector;
-    BUSS_ADDRESS.d1 = Block;
-    
-    // Pack the registers.
-    uint64_t Packed_Registers = create_lcloud_registers(&BUSS_ADDRESS);
-
-    logMessage(LOG_INFO_LEVEL, "data exsists at: '%x'", buf);
+    if (Topology_Cache_Enabled == 1 && Topology_Load(mask) == 0) {
+        logMessage(LOG_OUTPUT_LEVEL, "          ### Device sizes taken from '%s' ###", Topology_Path);
+        return;
+    }
 
-    // Sends the data along with the packed registers to the io buss
-    Packed_Registers = client_lcloud_bus_request(Packed_Registers, buf);
+    for (int i = 0; i < 15; i++) {
+        if ((mask >> i) & 1) {
+            BUSS_ADDRESS.b0 = 0;
+            BUSS_ADDRESS.b1 = 0;
+            BUSS_ADDRESS.c0 = LC_DEVINIT;
+            BUSS_ADDRESS.c1 = i;
+            BUSS_ADDRESS.c2 = 0;
+            BUSS_ADDRESS.d0 = 0;
+            BUSS_ADDRESS.d1 = 0;
+            Requests[Count] = create_lcloud_registers(&BUSS_ADDRESS);
+            Ids[Count++] = i;
+        }
+    }
 
-    // Check to make sure the retruned register is correct.
-    return Check_Return_Values(Packed_Registers, &BUSS_ADDRESS); 
+    // Fall back to one device at a time if the batch did not go through.
+    if (client_lcloud_bus_batch(Requests, Count) != 0) {
+        for (int k = 0; k < Count; k++) {
+            Lc_Device_Setup(Ids[k]);
+        }
+    }
+    else {
+        for (int k = 0; k < Count; k++) {
+            extract_lcloud_registers(Requests[k], &BUSS_ADDRESS);
+            device[Ids[k]].Number_Of_Sectors = BUSS_ADDRESS.d0;
+            device[Ids[k]].Number_Of_Blocks = BUSS_ADDRESS.d1;
+            logMessage(LOG_OUTPUT_LEVEL, "          ### Device '%i': Number of Sectors: '%i' Number of Blocks: '%i' ###",
+                Ids[k], device[Ids[k]].Number_Of_Sectors, device[Ids[k]].Number_Of_Blocks);
+        }
+    }
+    if (Topology_Cache_Enabled == 1) {
+        Topology_Save(mask);
+    }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : Read_Block
-// Description  : Takes 1; 256 - bit block from the device 
+// Function     : Free_Hint_Lower
+// Description  : Note that a block is free again, so the search for free
+//                blocks on its device starts no later than it.
 //
-// Inputs       : the device ID, sector, and block of where the data is.
-// Outputs      : Then outputs the data into the buf pointer.
-void Read_Block (int Device_ID, int Sector, int Block, char *buf) {
+// Inputs       : The device, sector and block.
+// Outputs      : none
+void Free_Hint_Lower (int Device_Number, int Sector_Number, int Block_Number) {
+    int At = Sector_Number * device[Device_Number].Number_Of_Blocks + Block_Number;
 
-    if (device[Device_ID].Number_Of_Sectors == 0) {
-        logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: Refenceing Data that does not exsist");
+    if (At < device[Device_Number].Free_Hint) {
+        device[Device_Number].Free_Hint = At;
     }
-    /////////////////////////
-    // Check the cache for the data first
-    // Create a buff - pointer to find if the data is there/ NULL if not.
-    char * buf_pointer = lcloud_getcache( Device_ID, Sector, Block );
+}
 
-    // Check if the cache came back positive
-    if (buf_pointer != NULL && Cache_Enabled == 1) {
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Allocate_Run
+// Description  : Find free blocks that follow one another (block after
+//                block, then on to the next sector) on one device: the first
+//                run of Count of them, starting with the highest powered
+//                device and moving down, or the longest run if no device has
+//                one that long.  Each device is searched from its first free
+//                block, and one marked full once it has none.
+//
+// Inputs       : Count - the blocks wanted
+//                Pointers to hold the device, sector and block the run starts at.
+// Outputs      : the blocks in the run (each marked taken), 0 if every device is full
+//                (the blocks put aside for files not counting, see Run_Return_All)
+int Allocate_Run (int Count, int *Device_Number, int *Sector_Number, int *Block_Number) {
+    int Best = 0, Best_Device = -1, Best_Start = 0;
+
+    for (int i = 14; i >= 0 && Best < Count; i--) {
+
+        // Skip devices that are off or allready full.
+        if (device[i].Power != 1 || device[i].Device_Full == 1) {
+            continue;
+        }
 
-        // Calculate the statistics of the data
-        Stats.hits += 1;
-        
-        // Copy the cache data and exit the function.
-        memcpy(buf, buf_pointer, 256);
-        return;  //<--> UNCOMMMET THIS to use the cache
+        int Blocks = device[i].Number_Of_Blocks;
+        int Total = device[i].Number_Of_Sectors * Blocks;
+        int Run = 0, Found = 0;
+        for (int j = device[i].Free_Hint; j < Total && Run < Count; j++) {
+            if (device[i].Used_Blocks[j / Blocks][j % Blocks] != 0) {
+                Run = 0;
+                if (Found == 0) {
+                    device[i].Free_Hint = j + 1;
+                }
+                continue;
+            }
+            Found = 1;
+            if (++Run > Best) {
+                Best = Run;
+                Best_Device = i;
+                Best_Start = j - Run + 1;
+            }
+        }
+        if (Found == 0) {
+            logMessage(LOG_OUTPUT_LEVEL, "          ### Device: '%i' is full", i);
+            device[i].Device_Full = 1;
+        }
+    }
+    if (Best == 0) {
+        return 0;
     }
 
-    // Create a buss address object for packing.
-    struct Buss BUSS_ADDRESS;
+    // Mark the blocks as taken.
+    for (int j = Best_Start; j < Best_Start + Best; j++) {
+        device[Best_Device].Used_Blocks[j / device[Best_Device].Number_Of_Blocks][j % device[Best_Device].Number_Of_Blocks] = 1;
+    }
+    *Device_Number = Best_Device;
+    *Sector_Number = Best_Start / device[Best_Device].Number_Of_Blocks;
+    *Block_Number = Best_Start % device[Best_Device].Number_Of_Blocks;
+    return Best;
+}
 
-    //c2 - LC_XFER_WRITE for write
-    BUSS_ADDRESS.b0 = 0;
-    BUSS_ADDRESS.b1 = 0;
-    BUSS_ADDRESS.c0 = LC_BLOCK_XFER;  // ALWAYS the op code. 
-    BUSS_ADDRESS.c1 = Device_ID;
-    BUSS_ADDRESS.c2 = LC_XFER_READ;
-    BUSS_ADDRESS.d0 = Sector; //Sector
-    BUSS_ADDRESS.d1 = Block; //Block
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Slot_Mask
+// Description  : The bits for a range of slots in a packed block.
+//
+// Inputs       : The first slot and the number of slots.
+// Outputs      : The mask (one bit per slot).
+uint8_t Slot_Mask (int slot, int slots) {
+    return (uint8_t)(((1u << slots) - 1) << slot);
+}
 
-    // Pack the registers.
-    uint64_t Packed_Registers = create_lcloud_registers(&BUSS_ADDRESS);
-    
-    // Sends the data along with the packed registers to the io buss
-    Packed_Registers = client_lcloud_bus_request(Packed_Registers, buf);  
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Release_Block
+// Description  : Drop one reference to a physical block, freeing it once
+//                nothing uses it.
+//
+// Inputs       : The device, sector and block.
+// Outputs      : none
+void Release_Block (int Device_Number, int Sector_Number, int Block_Number) {
+
+    // The journal's region is never handed back to the allocator.
+    if (lcloud_journal_reserved(Device_Number, Sector_Number, Block_Number)) {
+        logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: Block [%i/%i/%i] belongs to the journal, not freed", Device_Number, Sector_Number, Block_Number);
+        return;
+    }
 
-    // Check to make sure the retruned register is correct.
-    Check_Return_Values (Packed_Registers, &BUSS_ADDRESS); 
+    // Still shared with another file block.
+    if (device[Device_Number].Used_Blocks[Sector_Number][Block_Number] > 1) {
+        device[Device_Number].Used_Blocks[Sector_Number][Block_Number] -= 1;
+        return;
+    }
+    device[Device_Number].Used_Blocks[Sector_Number][Block_Number] = 0;
+    device[Device_Number].Device_Full = 0;
+    Free_Hint_Lower(Device_Number, Sector_Number, Block_Number);
+    if (Dedup_Enabled == 1) {
+        lcloud_dedup_forget(Device_Number, Sector_Number, Block_Number);
+    }
+}
 
-    // if data is not in cache then fill it
-    if (buf_pointer == NULL) {
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Run_Open
+// Description  : Start placing the new blocks of a flush (the data waited in
+//                the write buffer, so only now are they given blocks).
+//
+// Inputs       : Wanted - how many new blocks the flush places
+// Outputs      : none
+void Run_Open (int Wanted) {
+    Run_Stats.Wanted = Wanted;
+}
 
-        // Update hits
-        Stats.misses += 1;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Run_Close
+// Description  : End the flush (the file keeps what is left of its run).
+//
+// Inputs       : none
+// Outputs      : none
+void Run_Close (void) {
+    Run_Stats.Wanted = 0;
+}
 
-        // Write to the cache: 
-        lcloud_putcache(Device_ID, Sector, Block, buf);
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Run_Return
+// Description  : Free the blocks still put aside for a file.
+//
+// Inputs       : The file handle
+// Outputs      : none
+void Run_Return (LcFHandle fh) {
+    struct Files *f = &FILE_HANDLE[fh];
+    int Sector = f->Run_Sector, Block = f->Run_Block;
+
+    for (; f->Run_Count > 0; f->Run_Count--) {
+        Release_Block(f->Run_Device, Sector, Block);
+        Run_Stats.returned += 1;
+        if (++Block == device[f->Run_Device].Number_Of_Blocks) {
+            Block = 0;
+            Sector += 1;
+        }
     }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : lcread
-// Description  : Read data from the file 
+// Function     : Run_Return_All
+// Description  : Free the blocks put aside for every file (the devices are
+//                short of space).
 //
-// Inputs       : fh - file handle for the file to read from
-//                buf - place to put the data
-//                len - the length of the read
-// Outputs      : number of bytes read, -1 if failure
-int lcread( LcFHandle fh, char *buf, size_t len ) {
-    logMessage(LOG_OUTPUT_LEVEL, "          ### length handed to the lcread function %i", len);
-    logMessage(LOG_OUTPUT_LEVEL, "          ### The read write head's current position is %i", FILE_HANDLE[fh].position);
-    
-    //memcpy(buf, buf_pointer, 255); // fill the buffer with 0, to make sure that no outside data is getting in
+// Inputs       : none
+// Outputs      : the blocks freed
+int Run_Return_All (void) {
+    int Before = Run_Stats.returned;
 
-    // Specal case to pretect agest derefrencing
-    if (len <= 0) { 
+    for (int fh = 1; fh <= File_Counter; fh++) {
+        Run_Return(fh);
+    }
+    return Run_Stats.returned - Before;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Allocate_Block
+// Description  : Find a free block, starting with the highest powered device
+//                and moving down once a device is full.  The blocks put aside
+//                for files are freed before giving up.
+//
+// Inputs       : Pointers to hold the device, sector and block that was found.
+// Outputs      : 0 - if a block was found. Else; -1 (every device is full)
+int Allocate_Block (int *Device_Number, int *Sector_Number, int *Block_Number) {
+    if (Allocate_Run(1, Device_Number, Sector_Number, Block_Number) == 1 ||
+        (Run_Return_All() > 0 && Allocate_Run(1, Device_Number, Sector_Number, Block_Number) == 1)) {
         return 0;
     }
+    logMessage(LOG_ERROR_LEVEL, "          ### ERROR ###: Every device is full");
+    return -1;
+}
 
-    // Block of data (size 256) sends it to the device. 
-    // The device will hold the block in the device. 
-    // Check length to see if it is valid
-    int Position = FILE_HANDLE[fh].position % 256;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Run_Carry_On
+// Description  : Take the free blocks just after a file's last new block, so
+//                its next run carries on from the last one.
+//
+// Inputs       : The file and how many blocks are wanted.
+// Outputs      : the blocks taken (0 if the next one is not free)
+int Run_Carry_On (struct Files *f, int Want) {
+    struct Devices *d = &device[f->Run_Device];
+    int n = 0;
 
-    // Check if file handle valid (is associated with open file)
-    if (FILE_HANDLE[fh].Path != 0) {
-        logMessage(LOG_OUTPUT_LEVEL, "          ### Device for data: %i'", FILE_HANDLE[fh].block[Position].device);
+    if (f->Run_Valid != 1 || d->Power != 1) {
+        return 0;
     }
-    else {
-        logMessage(LOG_ERROR_LEVEL, "          ### ERROR-404: File hande NON-EXESTANCE");
-        return (-1);
+    for (int j = f->Run_Sector * d->Number_Of_Blocks + f->Run_Block;
+         n < Want && j < d->Number_Of_Sectors * d->Number_Of_Blocks &&
+         d->Used_Blocks[j / d->Number_Of_Blocks][j % d->Number_Of_Blocks] == 0; j++) {
+        d->Used_Blocks[j / d->Number_Of_Blocks][j % d->Number_Of_Blocks] = 1;
+        n++;
     }
+    return n;
+}
 
-    // Figure out what device/sector/block for the data.
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Run_Take
+// Description  : Place a new block of a file.  Each file has a run of free
+//                blocks put aside (Delayed_Allocation_Blocks of them, or
+//                what the flush needs if more), so the blocks of files
+//                written at the same time do not end up interleaved, and the
+//                free blocks are only searched once a run.  A file that keeps
+//                growing gets runs twice as long each time (up to 8 times
+//                the first), and a new run starts just after the last one if
+//                those blocks are free.  When the devices run short, the
+//                runs of the other files are freed first.
+//
+// Inputs       : The file handle
+//                Pointers to hold the device, sector and block.
+// Outputs      : 0 - if a block was found. Else; -1 (every device is full)
+int Run_Take (LcFHandle fh, int *Device_Number, int *Sector_Number, int *Block_Number) {
+    struct Files *f = &FILE_HANDLE[fh];
+
+    if (Delayed_Allocation_Blocks <= 0) {
+        return Allocate_Block(Device_Number, Sector_Number, Block_Number);
+    }
+    if (f->Run_Count == 0) {
+        if (f->Run_Size < Delayed_Allocation_Blocks) {
+            f->Run_Size = Delayed_Allocation_Blocks;
+        }
+        int Want = (Run_Stats.Wanted > f->Run_Size) ? Run_Stats.Wanted : f->Run_Size;
+        f->Run_Count = Run_Carry_On(f, Want);
+        if (f->Run_Count > 0) {
+            Run_Stats.carried += 1;
+        }
+        else {
+            f->Run_Count = Allocate_Run(Want, &f->Run_Device, &f->Run_Sector, &f->Run_Block);
+        }
+        if (f->Run_Count == 0 && Run_Return_All() > 0) {
+            f->Run_Count = Allocate_Run(Want, &f->Run_Device, &f->Run_Sector, &f->Run_Block);
+        }
+        if (f->Run_Count == 0) {
+            logMessage(LOG_ERROR_LEVEL, "          ### ERROR ###: Every device is full");
+            return -1;
+        }
+        f->Run_Valid = 1;
+        if (f->Run_Size < 8 * Delayed_Allocation_Blocks) {
+            f->Run_Size *= 2;
+        }
+        Run_Stats.runs += 1;
+    }
+    *Device_Number = f->Run_Device;
+    *Sector_Number = f->Run_Sector;
+    *Block_Number = f->Run_Block;
+    if (++f->Run_Block == device[f->Run_Device].Number_Of_Blocks) {
+        f->Run_Block = 0;
+        f->Run_Sector += 1;
+    }
+    f->Run_Count -= 1;
+    Run_Stats.placed += 1;
+    if (Run_Stats.Wanted > 0) {
+        Run_Stats.Wanted -= 1;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Pack_Release
+// Description  : Give back the space a file block uses.  A packed block is
+//                only freed once none of its slots are in use.
+//
+// Inputs       : The file block.
+// Outputs      : none
+void Pack_Release (struct Block *b) {
+
+    if (b->allocated != 1) {
+        return;
+    }
+    if (b->slots > 0) {
+        device[b->device].Used_Slots[b->sector][b->block] &= ~Slot_Mask(b->slot, b->slots);
+        b->slots = 0;
+
+        // Something else still lives in the block.
+        if (device[b->device].Used_Slots[b->sector][b->block] != 0) {
+            return;
+        }
+        if (Pack_Open.allocated == 1 && Pack_Open.device == b->device &&
+            Pack_Open.sector == b->sector && Pack_Open.block == b->block) {
+            Pack_Open.allocated = 0;
+        }
+    }
+    Release_Block(b->device, b->sector, b->block);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Pack_Place
+// Description  : Find free slots for a compressed block, first in the open
+//                packed block and then in a newly allocated one.
+//
+// Inputs       : The number of slots and pointers to hold the device,
+//                sector, block and first slot that were found.
+// Outputs      : 0 - if the slots were found. Else; -1 (every device is full)
+int Pack_Place (int slots, int *Device_Number, int *Sector_Number, int *Block_Number, int *Slot) {
+
+    // First fit in the open packed block.
+    if (Pack_Open.allocated == 1) {
+        uint8_t *used = &device[Pack_Open.device].Used_Slots[Pack_Open.sector][Pack_Open.block];
+        for (int i = 0; i + slots <= LC_COMPRESS_SLOTS; i++) {
+            if ((*used & Slot_Mask(i, slots)) == 0) {
+                *used |= Slot_Mask(i, slots);
+                *Device_Number = Pack_Open.device;
+                *Sector_Number = Pack_Open.sector;
+                *Block_Number = Pack_Open.block;
+                *Slot = i;
+                return 0;
+            }
+        }
+    }
+
+    // Start a new packed block.
+    if (Allocate_Block(Device_Number, Sector_Number, Block_Number) != 0) {
+        return -1;
+    }
+    Pack_Open.device = *Device_Number;
+    Pack_Open.sector = *Sector_Number;
+    Pack_Open.block = *Block_Number;
+    Pack_Open.allocated = 1;
+    device[*Device_Number].Used_Slots[*Sector_Number][*Block_Number] = Slot_Mask(0, slots);
+    *Slot = 0;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Journal_Placed
+// Description  : Note that the journal has the places of a file's blocks up
+//                to a block.
+//
+// Inputs       : The file handle and the block after the last one placed.
+// Outputs      : none
+void Journal_Placed (LcFHandle fh, int End_Block) {
+    if (End_Block * 256 > FILE_HANDLE[fh].Placed_End) {
+        FILE_HANDLE[fh].Placed_End = End_Block * 256;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Journal_Apply
+// Description  : Put one replayed journal record back into the file handles
+//                and the device maps.
+//
+// Inputs       : The record read from the journal.
+// Outputs      : none
+void Journal_Apply (const LcJournalRecord *rec) {
+
+    // Ignore anything that does not fit in the tables.
+    if (rec->fh >= 2000 || rec->file_block >= 2000 || rec->device >= 15 ||
+        rec->sector >= 200 || rec->block >= 200) {
+        logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: Journal record out of range (type %i)", rec->type);
+        return;
+    }
+
+    switch (rec->type) {
+    case LC_JREC_FILE:
+        strncpy(FILE_HANDLE[rec->fh].File_Name, rec->name, LC_JOURNAL_MAX_NAME - 1);
+        FILE_HANDLE[rec->fh].Path = rec->name[0];
+
+        // New handles must be given out after the recovered ones.
+        if (rec->fh > File_Counter) {
+            File_Counter = rec->fh;
+        }
+        break;
+
+    case LC_JREC_MAP:
+
+        // Walk the run, the physical blocks follow each other sector by sector.
+        for (int i = 0, sec = rec->sector, blk = rec->block; i < rec->count && rec->file_block + i < 2000; i++) {
+            if (sec >= 200 || blk >= 200) {
+                break;
+            }
+
+            // The block moved (or was packed before), so its old place loses a reference.
+            struct Block *old = &FILE_HANDLE[rec->fh].block[rec->file_block + i];
+            if (old->allocated != 1 || old->slots > 0 || old->device != rec->device || old->sector != sec || old->block != blk) {
+                Pack_Release(old);
+                device[rec->device].Used_Blocks[sec][blk] += 1;
+                old->crc_valid = 0;     // New data, its checksum comes in a later record
+            }
+            old->slots = 0;
+            FILE_HANDLE[rec->fh].block[rec->file_block + i].device = rec->device;
+            FILE_HANDLE[rec->fh].block[rec->file_block + i].sector = sec;
+            FILE_HANDLE[rec->fh].block[rec->file_block + i].block = blk;
+            FILE_HANDLE[rec->fh].block[rec->file_block + i].allocated = 1;
+
+            if (++blk >= device[rec->device].Number_Of_Blocks) {
+                blk = 0;
+                sec++;
+            }
+            Journal_Placed(rec->fh, rec->file_block + i + 1);
+        }
+        break;
+
+    case LC_JREC_LENGTH:
+        FILE_HANDLE[rec->fh].length = rec->length;
+        FILE_HANDLE[rec->fh].Length_Journaled = rec->length;
+        Journal_Placed(rec->fh, (rec->length + 255) / 256);
+        break;
+
+    case LC_JREC_PACK: {
+        struct Block *b = &FILE_HANDLE[rec->fh].block[rec->file_block];
+        int slots = (rec->clen + LC_COMPRESS_SLOT_SIZE - 1) / LC_COMPRESS_SLOT_SIZE;
+
+        if (slots == 0 || rec->slot + slots > LC_COMPRESS_SLOTS) {
+            logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: Journal packed record has bad slots");
+            break;
+        }
+        Pack_Release(b);
+        b->crc_valid = 0;
+        b->device = rec->device;
+        b->sector = rec->sector;
+        b->block = rec->block;
+        b->allocated = 1;
+        b->slot = rec->slot;
+        b->slots = slots;
+        b->clen = rec->clen;
+        device[rec->device].Used_Blocks[rec->sector][rec->block] = 1;
+        device[rec->device].Used_Slots[rec->sector][rec->block] |= Slot_Mask(rec->slot, slots);
+        Journal_Placed(rec->fh, rec->file_block + 1);
+        break;
+    }
+
+    case LC_JREC_CRC:
+        for (int i = 0; i < rec->count && rec->file_block + i < 2000; i++) {
+            FILE_HANDLE[rec->fh].block[rec->file_block + i].crc = rec->crc[i];
+            FILE_HANDLE[rec->fh].block[rec->file_block + i].crc_valid = 1;
+        }
+        break;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Journal_Pack
+// Description  : Log where a packed file block lives (its compressed extent).
+//
+// Inputs       : The file handle and the block within the file.
+// Outputs      : 0 - if the record was logged. Else; -1
+int Journal_Pack (LcFHandle fh, int File_Block_Number) {
+    LcJournalRecord rec;
+    struct Block *b = &FILE_HANDLE[fh].block[File_Block_Number];
+
+    memset(&rec, 0, sizeof(rec));
+    rec.type = LC_JREC_PACK;
+    rec.fh = fh;
+    rec.file_block = File_Block_Number;
+    rec.device = b->device;
+    rec.sector = b->sector;
+    rec.block = b->block;
+    rec.slot = b->slot;
+    rec.clen = b->clen;
+    return lcloud_journal_append(&rec);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Journal_Checksums
+// Description  : Log the checksums of a file's blocks, as runs of blocks
+//                that follow each other in the file.
+//
+// Inputs       : The file handle and 1 to log every checksum (checkpoint) or
+//                0 for only the ones that changed.
+// Outputs      : 0 - if every record was logged. Else; -1
+int Journal_Checksums (LcFHandle fh, int all) {
+    LcJournalRecord rec;
+
+    memset(&rec, 0, sizeof(rec));
+    rec.type = LC_JREC_CRC;
+    rec.fh = fh;
+    for (int i = 0; i <= 2000; i++) {
+        struct Block *b = (i < 2000) ? &FILE_HANDLE[fh].block[i] : NULL;
+        int wanted = (b != NULL && b->allocated == 1 && b->crc_valid == 1 && (all == 1 || b->crc_dirty == 1));
+
+        // Close the run when it is full or broken
+        if (rec.count > 0 && (!wanted || rec.count == LC_JOURNAL_CRC_RUN)) {
+            if (lcloud_journal_append(&rec) != 0) {
+                return -1;
+            }
+            rec.count = 0;
+        }
+        if (wanted) {
+            if (rec.count == 0) {
+                rec.file_block = i;
+            }
+            rec.crc[rec.count++] = b->crc;
+            b->crc_dirty = 0;
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Journal_Snapshot
+// Description  : Log the complete state of every file (used for checkpoints).
+//
+// Inputs       : none
+// Outputs      : 0 - if every record was logged. Else; -1
+int Journal_Snapshot (void) {
+    LcJournalRecord rec;
+
+    for (int fh = 1; fh <= File_Counter; fh++) {
+        if (FILE_HANDLE[fh].File_Name[0] == 0) {
+            continue;
+        }
+
+        // The file and its length
+        memset(&rec, 0, sizeof(rec));
+        rec.type = LC_JREC_FILE;
+        rec.fh = fh;
+        strncpy(rec.name, FILE_HANDLE[fh].File_Name, LC_JOURNAL_MAX_NAME - 1);
+        if (lcloud_journal_append(&rec) != 0) {
+            return -1;
+        }
+        // (only as far as the blocks placed, the rest is still in memory)
+        for (int i = 0; i < 2000; i++) {
+            if (FILE_HANDLE[fh].block[i].allocated == 1 && (i + 1) * 256 > FILE_HANDLE[fh].Placed_End) {
+                FILE_HANDLE[fh].Placed_End = (i + 1) * 256;
+            }
+        }
+        rec.type = LC_JREC_LENGTH;
+        rec.length = (FILE_HANDLE[fh].length < FILE_HANDLE[fh].Placed_End) ? FILE_HANDLE[fh].length : FILE_HANDLE[fh].Placed_End;
+        if (lcloud_journal_append(&rec) != 0) {
+            return -1;
+        }
+        FILE_HANDLE[fh].Length_Journaled = rec.length;
+
+        // Then every block it owns, as runs that are consecutive on the device
+        rec.type = LC_JREC_MAP;
+        rec.count = 0;
+        for (int i = 0; i <= 2000; i++) {
+            struct Block *b = (i < 2000) ? &FILE_HANDLE[fh].block[i] : NULL;
+            int whole = (b != NULL && b->allocated == 1 && b->slots == 0);
+
+            // Packed blocks are logged one at a time, with their slots
+            if (b != NULL && b->allocated == 1 && b->slots > 0 && Journal_Pack(fh, i) != 0) {
+                return -1;
+            }
+
+            // Extend the run if this block is the next one on the same device
+            if (whole && rec.count > 0 && b->device == rec.device) {
+                int next_sec = rec.sector, next_blk = rec.block + rec.count;
+                next_sec += next_blk / device[rec.device].Number_Of_Blocks;
+                next_blk %= device[rec.device].Number_Of_Blocks;
+                if (b->sector == next_sec && b->block == next_blk && rec.count < 0xffff) {
+                    rec.count++;
+                    continue;
+                }
+            }
+
+            // Otherwise close the current run and start a new one
+            if (rec.count > 0 && lcloud_journal_append(&rec) != 0) {
+                return -1;
+            }
+            rec.count = 0;
+            if (whole) {
+                rec.file_block = i;
+                rec.count = 1;
+                rec.device = b->device;
+                rec.sector = b->sector;
+                rec.block = b->block;
+            }
+        }
+
+        // The checksums go after the maps, which clear them on replay
+        if (Journal_Checksums(fh, 1) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Journal_Barrier
+// Description  : Write the log's staged blocks before any journal block,
+//                so a map record never reaches the device ahead of the data
+//                it points at.
+//
+// Inputs       : none
+// Outputs      : 0 - if the data is on the devices. Else; -1
+int Journal_Barrier (void) {
+    if (Log_Structured_Enabled == 1) {
+        return lcloud_logfs_flush();
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Journal_Mount
+// Description  : Open the journal on the lowest device that can hold it and
+//                rebuild the file maps from it.
+//
+// Inputs       : none
+// Outputs      : 0 - if the journal is mounted. Else; -1
+int Journal_Mount (void) {
+    int Meta_Device = -1;
+
+    // Use the biggest device (the lowest one on a tie), so the choice is the same every power on.
+    for (int i = 0; i < 15; i++) {
+        if (device[i].Power == 1 && device[i].Number_Of_Sectors * device[i].Number_Of_Blocks >= LC_JOURNAL_REGION_BLOCKS &&
+            (Meta_Device == -1 || device[i].Number_Of_Sectors * device[i].Number_Of_Blocks >
+                                  device[Meta_Device].Number_Of_Sectors * device[Meta_Device].Number_Of_Blocks)) {
+            Meta_Device = i;
+        }
+    }
+    if (Meta_Device == -1) {
+        logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: No device can hold the journal");
+        return -1;
+    }
+
+    // Keep the allocator away from the metadata region (before replay, so a checkpoint can not land in it).
+    for (int j = 0; j < LC_JOURNAL_REGION_BLOCKS; j++) {
+        device[Meta_Device].Used_Blocks[j / device[Meta_Device].Number_Of_Blocks][j % device[Meta_Device].Number_Of_Blocks] = 1;
+    }
+
+    if (lcloud_journal_open(Meta_Device, device[Meta_Device].Number_Of_Sectors, device[Meta_Device].Number_Of_Blocks,
+                            Journal_Apply, Journal_Snapshot, Journal_Barrier) < 0) {
+        return -1;
+    }
+    logMessage(LOG_OUTPUT_LEVEL, "          ### Journal mounted on device %i, %i files known", Meta_Device, File_Counter);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Journal_Length
+// Description  : Log the length of a file if it changed since the last time.
+//                It is logged only as far as the blocks whose places are
+//                logged before it, so a crash never brings back a length
+//                whose last blocks were still in memory.
+//
+// Inputs       : The file handle
+// Outputs      : 0 - if the length was logged (or did not need to be). Else; -1
+int Journal_Length (LcFHandle fh) {
+    LcJournalRecord rec;
+    int Length = FILE_HANDLE[fh].length;
+
+    if (Length > FILE_HANDLE[fh].Placed_End) {
+        Length = FILE_HANDLE[fh].Placed_End;
+    }
+    if (Journal_Enabled == 1 && Length != FILE_HANDLE[fh].Length_Journaled) {
+        memset(&rec, 0, sizeof(rec));
+        rec.type = LC_JREC_LENGTH;
+        rec.fh = fh;
+        rec.length = Length;
+        if (lcloud_journal_append(&rec) != 0) {
+            return -1;
+        }
+        FILE_HANDLE[fh].Length_Journaled = Length;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Journal_Map
+// Description  : Log where a file block was placed (along with the length,
+//                so a crash loses at most this block).
+//
+// Inputs       : The file handle and the block within the file.
+// Outputs      : 0 - if the place was logged (or no journal is kept). Else; -1
+int Journal_Map (LcFHandle fh, int File_Block_Number) {
+    LcJournalRecord rec;
+
+    if (Journal_Enabled == 1 && FILE_HANDLE[fh].block[File_Block_Number].slots > 0) {
+        if (Journal_Pack(fh, File_Block_Number) != 0) {
+            return -1;
+        }
+        Journal_Placed(fh, File_Block_Number + 1);
+        return Journal_Length(fh);
+    }
+    else if (Journal_Enabled == 1) {
+        memset(&rec, 0, sizeof(rec));
+        rec.type = LC_JREC_MAP;
+        rec.fh = fh;
+        rec.file_block = File_Block_Number;
+        rec.count = 1;
+        rec.device = FILE_HANDLE[fh].block[File_Block_Number].device;
+        rec.sector = FILE_HANDLE[fh].block[File_Block_Number].sector;
+        rec.block = FILE_HANDLE[fh].block[File_Block_Number].block;
+        if (lcloud_journal_append(&rec) != 0) {
+            return -1;
+        }
+        Journal_Placed(fh, File_Block_Number + 1);
+        return Journal_Length(fh);
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Log_Relocate
+// Description  : Follow a block the log cleaner moved (the old place is
+//                allready released by the cleaner).
+//
+// Inputs       : The file block, where it went and its data.
+// Outputs      : none
+void Log_Relocate (uint16_t fh, uint16_t fblk, LcDeviceId did, uint16_t sec, uint16_t blk, char *data) {
+    struct Block *b = &FILE_HANDLE[fh].block[fblk];
+
+    device[b->device].Used_Blocks[b->sector][b->block] = 0;
+    Free_Hint_Lower(b->device, b->sector, b->block);
+    b->device = did;
+    b->sector = sec;
+    b->block = blk;
+    device[did].Used_Blocks[sec][blk] = 1;
+
+    // The cache may still hold whatever used to live at the new place.
+    lcloud_putcache(did, sec, blk, data);
+    Journal_Map(fh, fblk);
+
+    // Replaying the move forgets the checksum, so it is logged again.
+    b->crc_dirty = b->crc_valid;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Log_Mount
+// Description  : Start the log-structured layout over every device, with the
+//                blocks the files allready own counted as live.
+//
+// Inputs       : none
+// Outputs      : 0 - if the log is running. Else; -1
+int Log_Mount (void) {
+
+    lcloud_logfs_init(Log_Relocate);
+    for (int i = 0; i < 15; i++) {
+        if (device[i].Power == 1 && lcloud_logfs_add_device(i, device[i].Number_Of_Sectors, device[i].Number_Of_Blocks) != 0) {
+            return -1;
+        }
+    }
+
+    // Blocks owned by files (from the journal)
+    for (int fh = 1; fh <= File_Counter; fh++) {
+        for (int i = 0; i < 2000; i++) {
+            struct Block *b = &FILE_HANDLE[fh].block[i];
+            if (b->allocated == 1) {
+                lcloud_logfs_mark_live(b->device, b->sector, b->block, fh, i);
+            }
+        }
+    }
+
+    // Anything else in use (the journal region) stays out of the log.
+    for (int i = 0; i < 15; i++) {
+        for (int s = 0; device[i].Power == 1 && s < device[i].Number_Of_Sectors; s++) {
+            for (int b = 0; b < device[i].Number_Of_Blocks; b++) {
+                if (device[i].Used_Blocks[s][b] != 0) {
+                    lcloud_logfs_reserve(i, s, b);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Log_Write_Block
+// Description  : Append a new version of a file block to the log.
+//
+// Inputs       : The file block, its data and pointers to hold where it went.
+// Outputs      : 0 - if the block was placed. Else; -1
+int Log_Write_Block (LcFHandle fh, int File_Block_Number, char *buf, int *Device_Number, int *Sector_Number, int *Block_Number) {
+
+    if (lcloud_logfs_append(fh, File_Block_Number, buf, Device_Number, Sector_Number, Block_Number) != 0) {
+        return -1;
+    }
+    device[*Device_Number].Used_Blocks[*Sector_Number][*Block_Number] = 1;
+
+    // Keep the cache up to date, just like Write_block.
+    lcloud_putcache(*Device_Number, *Sector_Number, *Block_Number, buf);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Dedup_Mount
+// Description  : Start an empty deduplication index over every device.  The
+//                reference counts come back from the journal, the index
+//                fills up again as blocks are written.
+//
+// Inputs       : none
+// Outputs      : 0 - if the index is ready. Else; -1
+int Dedup_Mount (void) {
+    int capacity = 0;
+
+    for (int i = 0; i < 15; i++) {
+        if (device[i].Power == 1) {
+            capacity += device[i].Number_Of_Sectors * device[i].Number_Of_Blocks;
+        }
+    }
+    if (lcloud_dedup_init(capacity) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < 15; i++) {
+        if (device[i].Power == 1 && lcloud_dedup_add_device(i, device[i].Number_Of_Sectors, device[i].Number_Of_Blocks) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Cache_Identity
+// Description  : Name the state of the devices for the local cache tier, so
+//                its blocks are only kept for the devices they came from.
+//                Without the journal nothing carries over, so it is unknown.
+//
+// Inputs       : none
+// Outputs      : the journal's generation, 0 if unknown
+uint32_t Cache_Identity (void) {
+    if (Journal_Enabled == 1) {
+        return lcloud_journal_generation();
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Cache_Warm
+// Description  : Fill the cache with the blocks it held at the last
+//                shutdown (see Cache_Warm_Enabled).  Those the local cache
+//                tier does not have go to the scheduler together (which
+//                sends them in device order), then they are put in the cache
+//                oldest first so the order of use comes back too.
+//
+// Inputs       : none
+// Outputs      : the number of blocks loaded, -1 if failure
+int Cache_Warm (void) {
+    LcCacheStats snap;
+    LcCacheAddress *Blocks;
+    LcXferBlock *Xfer;
+    int *Which;
+    char *Data;
+    int Count, Fetch = 0, Loaded = 0, From_Tier = 0;
+
+    lcloud_cachestats(&snap);
+    Blocks = malloc(snap.maxblocks * sizeof(LcCacheAddress));
+    Xfer = malloc(snap.maxblocks * sizeof(LcXferBlock));
+    Which = malloc(snap.maxblocks * sizeof(int));
+    Data = malloc((size_t)snap.maxblocks * 256);
+    if (Blocks == NULL || Xfer == NULL || Which == NULL || Data == NULL) {
+        free(Blocks);
+        free(Xfer);
+        free(Which);
+        free(Data);
+        return -1;
+    }
+    Count = lcloud_cache_load(Cache_Warm_Path, Cache_Identity(), Blocks, snap.maxblocks);
+
+    // Drop any that are no longer on a device, and fetch the rest.
+    for (int i = 0; i < Count; i++) {
+        LcCacheAddress *b = &Blocks[i];
+        char *buf = Data + (size_t)i * 256;
+
+        if (b->did >= 15 || device[b->did].Power != 1 ||
+            b->sec >= device[b->did].Number_Of_Sectors || b->blk >= device[b->did].Number_Of_Blocks) {
+            b->did = UINT8_MAX;
+        }
+        else if (lcloud_l2_get(b->did, b->sec, b->blk, buf) == 0) {
+            From_Tier++;
+        }
+        else {
+            Xfer[Fetch] = (LcXferBlock){ b->did, b->sec, b->blk, LC_XFER_READ, buf, 0 };
+            Which[Fetch++] = i;
+        }
+    }
+    if (Fetch > 0) {
+        lcloud_sched_submit(Xfer, Fetch);
+    }
+    for (int i = 0; i < Fetch; i++) {
+        if (Xfer[i].status != 0) {
+            Blocks[Which[i]].did = UINT8_MAX;
+        }
+    }
+
+    // The least recently used goes in first.
+    for (int i = Count - 1; i >= 0; i--) {
+        if (Blocks[i].did != UINT8_MAX) {
+            lcloud_prefetchcache(Blocks[i].did, Blocks[i].sec, Blocks[i].blk, Data + (size_t)i * 256);
+            Loaded++;
+        }
+    }
+    logMessage(LOG_INFO_LEVEL, "           ### Cache ###: loaded '%i' of '%i' blocks from the last run ('%i' from the local tier)",
+        Loaded, Count, From_Tier);
+
+    free(Blocks);
+    free(Xfer);
+    free(Which);
+    free(Data);
+    return Loaded;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Fs_Reset
+// Description  : Forget the files and the devices before the bus is powered
+//                on, so only the journal brings them back (the devices may
+//                have been wiped while they were off).
+//
+// Inputs       : none
+// Outputs      : none
+void Fs_Reset (void) {
+
+    // Only the handles given out so far were ever touched.
+    memset(FILE_HANDLE, 0, (size_t)(File_Counter + 1) * sizeof(struct Files));
+    File_Counter = 0;
+
+    // The devices (and what is used on them) are found again at power on.
+    memset(device, 0, sizeof(device));
+    Device_Counter = 0;
+    Number_Of_Devices_On = 0;
+    Pack_Open.allocated = 0;
+    Run_Stats.Wanted = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Lc_Open
+// Description  : Open the file for for reading and writing
+//
+// Inputs       : path - the path/filename of the file to be read
+// Outputs      : file handle if successful test, -1 if failure
+LcFHandle Lc_Open (const char *path) {
+    // Log the input peramiters. 
+    logMessage(LOG_OUTPUT_LEVEL, "          ### TASK: < OPEN FILE > ");
+    logMessage(LOG_OUTPUT_LEVEL, "          ### Path handed to the lopen function '%s' ###", path);  
+    
+    struct Buss BUSS_ADDRESS;  // Create a object of the structre
+
+    // Check if device is powered on.
+    if (buss_on == 0) {
+        logMessage(LOG_OUTPUT_LEVEL, "          ### Powering on the buss ###");
+        Fs_Reset();
+        Power_On(&BUSS_ADDRESS);
+        lcloud_sched_init(Sched_Queue_Depth);
+
+        // Allocate the cache
+        lcloud_initcache(LC_CACHE_MAXBLOCKS);
+        if (MRC_Enabled == 1 && lcloud_mrc_init(LC_MRC_DEFAULT_RATE) != 0) {
+            MRC_Enabled = 0;
+        }
+        Stats.hits = 0;
+        Stats.misses = 0;
+        
+        // Check if file already open (fail if already open) from a list 
+        Lc_Probe_Buss (&BUSS_ADDRESS);
+
+        // Get the device ID.
+        for (int i = 0; i < 15; i++) {
+            
+            // Shift to the righ counting up then return when ever there is a 1
+            if (((BUSS_ADDRESS.d0 >> i) & (int)1) == (int)1) {
+                logMessage(LOG_OUTPUT_LEVEL, "          ### Device #%i is on the Bus ###", i);
+
+                // assigne the value of the device to the array.
+                Number_Of_Devices_On = Device_Counter;
+                Device_Counter ++;
+
+                // Create a struct for the device.
+                device[i].Power = 1;
+                device[i].Number = i;
+            }
+
+        }
+
+        // find the ammount of blocks and sectors on the devices.
+        Lc_Device_Discover(BUSS_ADDRESS.d0);
+
+        // Get the file maps back from the journal.
+        if (Journal_Enabled == 1 && Journal_Mount() != 0) {
+            Journal_Enabled = 0;
+        }
+
+        // Lay the devices out as a log.  If it will not start, nothing is
+        // mounted and the next lcopen powers on again.
+        if (Log_Structured_Enabled == 1 && Log_Mount() != 0) {
+            logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: Could not start the log-structured layout");
+            lcloud_closecache();
+            if (MRC_Enabled == 1) {
+                lcloud_mrc_close();
+            }
+            buss_on = 0;
+            return(-1);
+        }
+
+        // The log gives every write a new block, so it does not share them.
+        if (Dedup_Enabled == 1 && (Log_Structured_Enabled == 1 || Dedup_Mount() != 0)) {
+            Dedup_Enabled = 0;
+        }
+
+        // Open the local cache tier (warm if the devices are as it left them).
+        if (Cache_L2_Enabled == 1 && lcloud_l2_open(Cache_L2_Path, LC_L2_BLOCKS, Cache_Identity()) < 0) {
+            Cache_L2_Enabled = 0;
+        }
+
+        // Load the blocks the cache held at the last shutdown.
+        if (Cache_Warm_Enabled == 1 && Cache_Enabled == 1) {
+            Cache_Warm();
+        }
+    }
+
+    // If the file allready exists (from the journal), start at the front of it.
+    for (int fh = 1; fh <= File_Counter; fh++) {
+        if (strcmp(FILE_HANDLE[fh].File_Name, path) == 0) {
+            logMessage(LOG_OUTPUT_LEVEL, "          ### Lc Handle number'%i' (existing file)", fh);
+            FILE_HANDLE[fh].position = 0;
+            FILE_HANDLE[fh].Last_Valid = 0;
+            return(fh);
+        }
+    }
+
+    File_Counter++;
+    logMessage(LOG_OUTPUT_LEVEL, "          ### Lc Handle number'%i'", File_Counter);
+
+    // If file does not exist, set length to 0
+    FILE_HANDLE[File_Counter].Path = *path;
+    FILE_HANDLE[File_Counter].length = 0;
+    FILE_HANDLE[File_Counter].Last_Valid = 0;
+    strncpy(FILE_HANDLE[File_Counter].File_Name, path, LC_JOURNAL_MAX_NAME - 1);
+
+    // Log the new file.
+    if (Journal_Enabled == 1) {
+        LcJournalRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.type = LC_JREC_FILE;
+        rec.fh = File_Counter;
+        strncpy(rec.name, path, LC_JOURNAL_MAX_NAME - 1);
+        if (lcloud_journal_append(&rec) != 0) {
+            logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: The new file '%s' could not be journaled", path);
+            memset(&FILE_HANDLE[File_Counter], 0, sizeof(struct Files));
+            File_Counter--;
+            return(-1);
+        }
+    }
+
+    // Return file handle 
+    return(File_Counter); 
+    
+    // if doesn't exsit 
+    //return("-1"); // Likely wrong
+} 
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Check_Return_Values
+// Description  : Check if the device and retrun address was sucessfull.
+//
+// Inputs       : The LCloudRegisterFrame 64-bit register and a pointer to the buss adress struct.
+// Outputs      : 0 - For compleating successfully.
+int Check_Return_Values (LCloudRegisterFrame Packed_Registers, struct Buss *BUSS_ADDRESS) {
+
+    // Unpack the registor
+    extract_lcloud_registers(Packed_Registers, BUSS_ADDRESS);    
+
+    // Check if the retrun values are correct
+    if (BUSS_ADDRESS->b1 == 1) {
+        return 0; // Task compleated sucessfully.
+    }
+    else {
+        
+        return -1; // The task was un-sucsessfull.
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Cache_Resize_Check
+// Description  : Move the cache size to where the miss ratio curve says the
+//                target hit ratio is reached (or, if it never is, to where
+//                the curve levels off).  Small differences are left alone.
+//
+// Inputs       : none
+// Outputs      : none
+void Cache_Resize_Check (void) {
+    LcCacheStats snap;
+    int size;
+
+    if (lcloud_mrc_sampled() == 0 || lcloud_cachestats(&snap) != 0) {
+        return;
+    }
+    size = lcloud_mrc_size_for(Cache_Target_Hit_Percent / 100.0);
+    if (size < 0) {
+        size = lcloud_mrc_size_for(lcloud_mrc_hit_ratio(LC_MRC_MAX_BLOCKS));
+    }
+    if (size < LC_CACHE_MINBLOCKS) {
+        size = LC_CACHE_MINBLOCKS;
+    }
+    if (size * 4 > snap.maxblocks * 5 || size * 4 < snap.maxblocks * 3) {
+        lcloud_resizecache(size);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Mrc_Access
+// Description  : Feed a block access to the miss ratio curve, and now and
+//                then resize the cache if there is a target.
+//
+// Inputs       : The device id, sector and block accessed, and 1 if it was
+//                looked for in the cache (a read) or 0 if it was only put there.
+// Outputs      : none
+void Mrc_Access (int Device_ID, int Sector, int Block, int Lookup) {
+    if (MRC_Enabled == 0) {
+        return;
+    }
+    lcloud_mrc_access(Device_ID, Sector, Block, Lookup);
+    if (Cache_Target_Hit_Percent > 0 && ++Mrc_Accesses >= LC_MRC_RESIZE_PERIOD) {
+        Mrc_Accesses = 0;
+        Cache_Resize_Check();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Write_Batch_Begin
+// Description  : Hold the device writes that follow, to send them together
+//                with Write_Batch_End.  Only the plain layout holds them: the
+//                log, the packer and dedup read back blocks they have just
+//                written, which must be on the devices first.  (Packed tails
+//                are the exception, Pack_Store sends the batch first.)
+//
+// Inputs       : none
+// Outputs      : 1 if a batch was started (the caller ends it), else 0
+int Write_Batch_Begin (void) {
+    if (Write_Batch.Open == 1 || Log_Structured_Enabled == 1 || Compress_Enabled == 1 || Dedup_Enabled == 1) {
+        return 0;
+    }
+    Write_Batch.Open = 1;
+    Write_Batch.Count = 0;
+    Write_Batch.Maps = 0;
+    return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Write_Batch_Send
+// Description  : Send the writes held so far in one round trip, then journal
+//                the new blocks among them (the journal never points at a
+//                block before its data is written).
+//
+// Inputs       : none
+// Outputs      : 0 - if every block was written. Else; -1
+int Write_Batch_Send (void) {
+    int status = 0;
+
+    if (Write_Batch.Count > 0) {
+        status = lcloud_sched_submit(Write_Batch.Xfer, Write_Batch.Count);
+        Write_Batch.batches += 1;
+        Write_Batch.batched += Write_Batch.Count;
+    }
+    for (int i = 0; i < Write_Batch.Maps && status == 0; i++) {
+        status = Journal_Map(Write_Batch.Map_File[i], Write_Batch.Map_Block[i]);
+    }
+    Write_Batch.Count = 0;
+    Write_Batch.Maps = 0;
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Write_Batch_End
+// Description  : Send what is held and stop holding writes.
+//
+// Inputs       : none
+// Outputs      : 0 - if every block was written. Else; -1
+int Write_Batch_End (void) {
+    int status = Write_Batch_Send();
+
+    Write_Batch.Open = 0;
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Write_block
+// Description  : This takes one block (exactly 256), and sends it to the client_lcloud_bus_request. 
+//
+// Inputs       : The device id, sector and block position to send the block too. Then the buf pointer that holds the data to be written
+// Outputs      : the retrun registers.
+int Write_block (int Device_ID, int Sector, int Block, char *buf) {
+
+    // Write to the cache: 
+    Mrc_Access(Device_ID, Sector, Block, 0);
+    lcloud_putcache(Device_ID, Sector, Block, buf);
+
+    // Held for a batch (the batch is sent when it fills).
+    if (Write_Batch.Open == 1) {
+        if (Write_Batch.Count == LC_XFER_BATCH_MAX && Write_Batch_Send() != 0) {
+            return -1;
+        }
+        LcXferBlock *x = &Write_Batch.Xfer[Write_Batch.Count];
+        memcpy(Write_Batch.Data[Write_Batch.Count], buf, 256);
+        x->did = Device_ID;
+        x->sec = Sector;
+        x->blk = Block;
+        x->op = LC_XFER_WRITE;
+        x->buf = Write_Batch.Data[Write_Batch.Count];
+        Write_Batch.Count++;
+        return 0;
+    }
+
+    // Create a buss address object for packing.
+    struct Buss BUSS_ADDRESS;
+
+    //c2 - LC_XFER_WRITE for write
+    BUSS_ADDRESS.b0 = 0;
+    BUSS_ADDRESS.b1 = 0;
+    BUSS_ADDRESS.c0 = LC_BLOCK_XFER;  // ALWAYS the op code. 
+    BUSS_ADDRESS.c1 = Device_ID;
+    BUSS_ADDRESS.c2 = LC_XFER_WRITE;
+    BUSS_ADDRESS.d0 = Sector;
+    BUSS_ADDRESS.d1 = Block;
+    
+    // Pack the registers.
+    uint64_t Packed_Registers = create_lcloud_registers(&BUSS_ADDRESS);
+
+    logMessage(LOG_INFO_LEVEL, "data exsists at: '%x'", buf);
+
+    // Sends the data along with the packed registers to the io buss
+    Packed_Registers = client_lcloud_bus_request(Packed_Registers, buf);
+
+    // Check to make sure the retruned register is correct.
+    return Check_Return_Values(Packed_Registers, &BUSS_ADDRESS); 
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Read_Block
+// Description  : Takes 1; 256 - bit block from the device 
+//
+// Inputs       : the device ID, sector, and block of where the data is.
+// Outputs      : Then outputs the data into the buf pointer.
+void Read_Block (int Device_ID, int Sector, int Block, char *buf) {
+
+    if (device[Device_ID].Number_Of_Sectors == 0) {
+        logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: Refenceing Data that does not exsist");
+    }
+
+    // A block still waiting in the log's active segment is not on the device yet.
+    if (Log_Structured_Enabled == 1) {
+        char * staged = lcloud_logfs_staged(Device_ID, Sector, Block);
+        if (staged != NULL) {
+            memcpy(buf, staged, 256);
+            return;
+        }
+    }
+    /////////////////////////
+    // Check the cache for the data first
+    Mrc_Access(Device_ID, Sector, Block, 1);
+    // Create a buff - pointer to find if the data is there/ NULL if not.
+    char * buf_pointer = lcloud_getcache( Device_ID, Sector, Block );
+
+    // Check if the cache came back positive
+    if (buf_pointer != NULL && Cache_Enabled == 1) {
+
+        // Calculate the statistics of the data
+        Stats.hits += 1;
+        
+        // Copy the cache data and exit the function.
+        memcpy(buf, buf_pointer, 256);
+        return;  //<--> UNCOMMMET THIS to use the cache
+    }
+
+    // Create a buss address object for packing.
+    struct Buss BUSS_ADDRESS;
+
+    //c2 - LC_XFER_WRITE for write
+    BUSS_ADDRESS.b0 = 0;
+    BUSS_ADDRESS.b1 = 0;
+    BUSS_ADDRESS.c0 = LC_BLOCK_XFER;  // ALWAYS the op code. 
+    BUSS_ADDRESS.c1 = Device_ID;
+    BUSS_ADDRESS.c2 = LC_XFER_READ;
+    BUSS_ADDRESS.d0 = Sector; //Sector
+    BUSS_ADDRESS.d1 = Block; //Block
+
+    // Pack the registers.
+    uint64_t Packed_Registers = create_lcloud_registers(&BUSS_ADDRESS);
+    
+    // Sends the data along with the packed registers to the io buss
+    Packed_Registers = client_lcloud_bus_request(Packed_Registers, buf);  
+
+    // Check to make sure the retruned register is correct.
+    Check_Return_Values (Packed_Registers, &BUSS_ADDRESS); 
+
+    // if data is not in cache then fill it
+    if (buf_pointer == NULL) {
+
+        // Update hits
+        Stats.misses += 1;
+
+        // Write to the cache: 
+        lcloud_putcache(Device_ID, Sector, Block, buf);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Checksum_Block_Failed
+// Description  : A block did not match its checksum.  Count it and read the
+//                block again straight from the device, in case it was only
+//                the cached copy that went bad (the cache is then fixed).
+//
+// Inputs       : The file handle, the block within the file and the buf
+//                pointer holding the bad data (replaced if the device's copy is good).
+// Outputs      : 0 - if good data was found. Else; -1
+int Checksum_Block_Failed (LcFHandle fh, int File_Block_Number, char *buf) {
+    struct Block *b = &FILE_HANDLE[fh].block[File_Block_Number];
+    char image[LC_DEVICE_BLOCK_SIZE];
+    char data[LC_DEVICE_BLOCK_SIZE];
+
+    Checksum_Stats.failures += 1;
+    logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: Checksum mismatch in file %i block %i [%i/%i/%i]",
+        fh, File_Block_Number, b->device, b->sector, b->block);
+
+    // The log may still hold the block in memory, there is no other copy.
+    if (Log_Structured_Enabled == 1 && lcloud_logfs_staged(b->device, b->sector, b->block) != NULL) {
+        return -1;
+    }
+    if (lcloud_xfer_block(b->device, b->sector, b->block, LC_XFER_READ, image) != 0) {
+        return -1;
+    }
+    if (b->slots == 0) {
+        memcpy(data, image, 256);
+    }
+    else if (lcloud_decompress(image + b->slot * LC_COMPRESS_SLOT_SIZE, b->clen, data, 256) != 256) {
+        return -1;
+    }
+    if (lcloud_crc32c(0, data, 256) != b->crc) {
+        logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: The device copy is bad too");
+        return -1;
+    }
+
+    Checksum_Stats.repaired += 1;
+    lcloud_putcache(b->device, b->sector, b->block, image);
+    memcpy(buf, data, 256);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Write_Buffer_Block
+// Description  : Find a block in a file's write buffer.
+//
+// Inputs       : The file handle and the block within the file
+// Outputs      : pointer to the buffered 256 bytes, NULL if it is not buffered
+char * Write_Buffer_Block (LcFHandle fh, int File_Block_Number) {
+    int i = File_Block_Number - FILE_HANDLE[fh].Buffer_First;
+
+    if (i < 0 || i >= FILE_HANDLE[fh].Buffer_Count) {
+        return NULL;
+    }
+    return FILE_HANDLE[fh].Buffer + i * 256;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Read_File_Block
+// Description  : Read one block of a file, expanding it if it was packed.
+//                The whole packed block goes through the cache, so the other
+//                blocks packed with it are read for free.
+//
+// Inputs       : The file handle, the block within the file and the buf
+//                pointer to hold the 256 bytes.
+// Outputs      : 0 - if the block was read. Else (damaged and not repaired); -1
+int Read_File_Block (LcFHandle fh, int File_Block_Number, char *buf) {
+    struct Block *b = &FILE_HANDLE[fh].block[File_Block_Number];
+    char image[LC_DEVICE_BLOCK_SIZE];
+    int damaged = 0;
+
+    // The newest copy may still be in the file's write buffer.
+    char *Buffered = Write_Buffer_Block(fh, File_Block_Number);
+    if (Buffered != NULL) {
+        memcpy(buf, Buffered, 256);
+        return 0;
+    }
+
+    int hits = Stats.hits, misses = Stats.misses;
+    if (b->slots == 0) {
+        Read_Block(b->device, b->sector, b->block, buf);
+    }
+    else {
+        Read_Block(b->device, b->sector, b->block, image);
+        if (lcloud_decompress(image + b->slot * LC_COMPRESS_SLOT_SIZE, b->clen, buf, 256) != 256) {
+            logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: Packed block [%i/%i/%i] slot %i is damaged", b->device, b->sector, b->block, b->slot);
+            memset(buf, 0, 256);
+            damaged = 1;
+        }
+    }
+    FILE_HANDLE[fh].Cache_Hits += Stats.hits - hits;
+    FILE_HANDLE[fh].Cache_Misses += Stats.misses - misses;
+
+    ///////////////////////////
+    // Check the data against its checksum (whether it came from the cache or
+    // the device).  A damaged slot fails it too, and gets the same repair.
+    if (Checksum_Enabled == 1 && b->crc_valid == 1) {
+        Checksum_Stats.verified += 1;
+        if (lcloud_crc32c(0, buf, 256) != b->crc) {
+            return Checksum_Block_Failed(fh, File_Block_Number, buf);
+        }
+    }
+    return damaged ? -1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Read_Batch
+// Description  : Bring the blocks of a file that are not cached in over the
+//                bus together, in one round trip a batch, and put them in
+//                the cache for Read_File_Block to find (its lookup is the
+//                one counted as a hit or a miss).  Blocks in the write
+//                buffer or still in the log's memory are left alone, as is
+//                a physical block asked for twice (packed blocks share one).
+//
+// Inputs       : The file handle, the blocks within the file and how many.
+// Outputs      : none (a block that fails is just read again on its own)
+void Read_Batch (LcFHandle fh, const int *Blocks, int Count) {
+    LcXferBlock Xfer[LC_XFER_BATCH_MAX];
+    char Data[LC_XFER_BATCH_MAX][256];
+    int n = 0;
+
+    if (Cache_Enabled == 0) {
+        return;
+    }
+    for (int i = 0; i <= Count; i++) {
+
+        // Send a full batch, and what is left at the end.
+        if (n == LC_XFER_BATCH_MAX || (i == Count && n > 0)) {
+            lcloud_sched_submit(Xfer, n);
+            for (int j = 0; j < n; j++) {
+                if (Xfer[j].status == 0) {
+                    lcloud_prefetchcache(Xfer[j].did, Xfer[j].sec, Xfer[j].blk, Xfer[j].buf);
+                    Write_Batch.prefetched += 1;
+                }
+            }
+            n = 0;
+        }
+        if (i == Count) {
+            break;
+        }
+
+        struct Block *b = &FILE_HANDLE[fh].block[Blocks[i]];
+        int Twice = 0;
+        if (b->allocated != 1 || Write_Buffer_Block(fh, Blocks[i]) != NULL ||
+            (Log_Structured_Enabled == 1 && lcloud_logfs_staged(b->device, b->sector, b->block) != NULL)) {
+            continue;
+        }
+        for (int j = 0; j < n; j++) {
+            if (Xfer[j].did == b->device && Xfer[j].sec == b->sector && Xfer[j].blk == b->block) {
+                Twice = 1;
+            }
+        }
+        if (Twice == 1 || lcloud_incache(b->device, b->sector, b->block) == 1) {
+            continue;
+        }
+
+        // The local tier's copy goes back to the cache without the bus.
+        if (lcloud_l2_get(b->device, b->sector, b->block, Data[n]) == 0) {
+            lcloud_prefetchcache(b->device, b->sector, b->block, Data[n]);
+            continue;
+        }
+        Xfer[n].did = b->device;
+        Xfer[n].sec = b->sector;
+        Xfer[n].blk = b->block;
+        Xfer[n].op = LC_XFER_READ;
+        Xfer[n].buf = Data[n];
+        n++;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Pack_Store
+// Description  : Store the new contents of a file block, in slots of a
+//                shared block (if slots is more than 0) or whole.  A block
+//                stored whole before and now is written in place, and a
+//                packed one that still fits keeps its slots; otherwise the
+//                old space is given back and new space found.
+//
+// Inputs       : The file block, its data, the packed bytes and how many
+//                (and slots they take), pointers to hold where it went and
+//                a flag set if the map changed (so it gets journaled).
+// Outputs      : 0 - if the block was written. Else; -1
+int Pack_Store (LcFHandle fh, int File_Block_Number, char *buf, char *packed, int clen, int slots, int *Device_Number, int *Sector_Number, int *Block_Number, int *Moved) {
+    struct Block *b = &FILE_HANDLE[fh].block[File_Block_Number];
+    char image[LC_DEVICE_BLOCK_SIZE];
+    int slot = 0;
+
+    ///////////////////////////
+    // Stored whole before and now, overwrite it in place.
+    if (b->allocated == 1 && b->slots == 0 && slots == 0) {
+        *Device_Number = b->device;
+        *Sector_Number = b->sector;
+        *Block_Number = b->block;
+        return Write_block(b->device, b->sector, b->block, buf);
+    }
+
+    // Still fits in its slots, give back the ones it no longer needs.
+    if (b->allocated == 1 && slots > 0 && slots <= b->slots) {
+        device[b->device].Used_Slots[b->sector][b->block] &= ~Slot_Mask(b->slot + slots, b->slots - slots);
+        *Device_Number = b->device;
+        *Sector_Number = b->sector;
+        *Block_Number = b->block;
+        slot = b->slot;
+    }
+    else {
+        Pack_Release(b);
+        if (slots == 0 && Compress_Enabled == 1 && Allocate_Block(Device_Number, Sector_Number, Block_Number) != 0) {
+            return -1;
+        }
+        if (slots == 0 && Compress_Enabled == 0 && Run_Take(fh, Device_Number, Sector_Number, Block_Number) != 0) {
+            return -1;
+        }
+        if (slots > 0 && Pack_Place(slots, Device_Number, Sector_Number, Block_Number, &slot) != 0) {
+            return -1;
+        }
+    }
+    *Moved = 1;
+    b->slot = slot;
+    b->slots = slots;
+    b->clen = clen;
+
+    if (slots == 0) {
+        return Write_block(*Device_Number, *Sector_Number, *Block_Number, buf);
+    }
+
+    ///////////////////////////
+    // Fill in the slots, keeping whatever else is packed in the block.  Its
+    // last write may be held in the open batch (tails are packed while one
+    // is open), so that goes out before the block is read back.
+    if ((device[*Device_Number].Used_Slots[*Sector_Number][*Block_Number] & ~Slot_Mask(slot, slots)) != 0) {
+        if (Write_Batch.Open == 1 && Write_Batch_Send() != 0) {
+            return -1;
+        }
+        Read_Block(*Device_Number, *Sector_Number, *Block_Number, image);
+    }
+    else {
+        memset(image, 0, sizeof(image));
+    }
+    memset(image + slot * LC_COMPRESS_SLOT_SIZE, 0, slots * LC_COMPRESS_SLOT_SIZE);
+    memcpy(image + slot * LC_COMPRESS_SLOT_SIZE, packed, clen);
+    return Write_block(*Device_Number, *Sector_Number, *Block_Number, image);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Pack_Write_Block
+// Description  : Write one block of a file, packing it into slots of a shared
+//                block when it compresses by at least a slot.  Blocks with no
+//                repeats are stored whole without running the compressor.
+//
+// Inputs       : The file block, its data, pointers to hold where it went
+//                and a flag set if the map changed (so it gets journaled).
+// Outputs      : 0 - if the block was written. Else; -1
+int Pack_Write_Block (LcFHandle fh, int File_Block_Number, char *buf, int *Device_Number, int *Sector_Number, int *Block_Number, int *Moved) {
+    char packed[LC_DEVICE_BLOCK_SIZE];
+    int clen = 0, slots = 0;
+
+    if (lcloud_compress_worth(buf, 256) == 0) {
+        Compress_Stats.skipped += 1;
+    }
+    else if ((clen = lcloud_compress(buf, 256, packed, LC_COMPRESS_MAX_PACKED)) < 0) {
+        Compress_Stats.whole += 1;
+        clen = 0;
+    }
+    else {
+        Compress_Stats.packed += 1;
+        slots = (clen + LC_COMPRESS_SLOT_SIZE - 1) / LC_COMPRESS_SLOT_SIZE;
+    }
+
+    return Pack_Store(fh, File_Block_Number, buf, packed, clen, slots, Device_Number, Sector_Number, Block_Number, Moved);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Tail_Write_Block
+// Description  : Write the partial last block of a file (see
+//                Tail_Pack_Enabled).  The bytes past the end of the file are
+//                zeroed and the block compressed, which leaves little more
+//                than the bytes of the file, so the tails of many small
+//                files share one device block (and one transfer reads them
+//                all into the cache).  A tail that fills up moves out to a
+//                whole block.
+//
+// Inputs       : The file block, its data (zeroed past the end of the file),
+//                pointers to hold where it went and a flag set if the map
+//                changed (so it gets journaled).
+// Outputs      : 0 - if the block was written. Else; -1
+int Tail_Write_Block (LcFHandle fh, int File_Block_Number, char *buf, int *Device_Number, int *Sector_Number, int *Block_Number, int *Moved) {
+    char packed[LC_DEVICE_BLOCK_SIZE];
+    int Bytes = FILE_HANDLE[fh].length - File_Block_Number * 256;
+    int clen = -1, slots = 0;
+
+    if (Bytes < 256) {
+        memset(buf + Bytes, 0, 256 - Bytes);
+        clen = lcloud_compress(buf, 256, packed, LC_COMPRESS_MAX_PACKED);
+    }
+    if (clen > 0) {
+        Tail_Stats.packed += 1;
+        slots = (clen + LC_COMPRESS_SLOT_SIZE - 1) / LC_COMPRESS_SLOT_SIZE;
+    }
+    else {
+        Tail_Stats.whole += 1;
+        clen = 0;
+    }
+    return Pack_Store(fh, File_Block_Number, buf, packed, clen, slots, Device_Number, Sector_Number, Block_Number, Moved);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Dedup_Same
+// Description  : Check a fingerprint match against the data.  A block in the
+//                cache is compared byte for byte; one that is not is trusted
+//                on the 128-bit fingerprint alone (checking would cost the
+//                read the match is meant to save).
+//
+// Inputs       : The physical block that matched and the data being written.
+// Outputs      : 1 - if the block can be shared. Else; 0
+int Dedup_Same (int Device_Number, int Sector_Number, int Block_Number, char *buf) {
+
+    // Freed, or since packed (a packed block is never shared).
+    if (device[Device_Number].Used_Blocks[Sector_Number][Block_Number] == 0 ||
+        device[Device_Number].Used_Slots[Sector_Number][Block_Number] != 0) {
+        return 0;
+    }
+
+    // Only looked at, the check is not a use of the block.
+    char * cached = (Cache_Enabled == 1) ? lcloud_peekcache(Device_Number, Sector_Number, Block_Number) : NULL;
+    if (cached != NULL && memcmp(cached, buf, 256) != 0) {
+        Dedup_Stats.collisions += 1;
+        return 0;
+    }
+    return 1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Dedup_Write_Block
+// Description  : Write one block of a file, sharing an existing physical
+//                block if one allready holds the same data (nothing goes over
+//                the bus).  A shared block is never changed in place, the
+//                writer gets a copy of its own.
+//
+// Inputs       : The file block, its data, pointers to hold where it went
+//                and a flag set if the map changed (so it gets journaled).
+// Outputs      : 0 - if the block was written. Else; -1
+int Dedup_Write_Block (LcFHandle fh, int File_Block_Number, char *buf, int *Device_Number, int *Sector_Number, int *Block_Number, int *Moved) {
+    struct Block *b = &FILE_HANDLE[fh].block[File_Block_Number];
+    LcFingerprint fp;
+    int d, sec, blk;
+
+    lcloud_dedup_fingerprint(buf, &fp);
+
+    ///////////////////////////
+    // The data is allready stored, take a reference to it.
+    if (lcloud_dedup_lookup(&fp, &d, &sec, &blk) == 0 && Dedup_Same(d, sec, blk, buf) == 1) {
+        Dedup_Stats.shared += 1;
+        *Device_Number = d;
+        *Sector_Number = sec;
+        *Block_Number = blk;
+
+        // Unless it is this very block, rewritten with the same data.
+        if (b->allocated != 1 || b->slots > 0 || b->device != d || b->sector != sec || b->block != blk) {
+            Pack_Release(b);
+            device[d].Used_Blocks[sec][blk] += 1;
+            *Moved = 1;
+        }
+        return 0;
+    }
+    Dedup_Stats.stored += 1;
+
+    // Copy on write, the other users keep the old data.
+    if (b->allocated == 1 && b->slots == 0 && device[b->device].Used_Blocks[b->sector][b->block] > 1) {
+        Release_Block(b->device, b->sector, b->block);
+        b->allocated = 0;
+    }
+
+    ///////////////////////////
+    // Store it (packed if it compresses) and remember what it holds.
+    if (Compress_Enabled == 1) {
+        if (Pack_Write_Block(fh, File_Block_Number, buf, Device_Number, Sector_Number, Block_Number, Moved) != 0) {
+            return -1;
+        }
+    }
+    else {
+        if (b->allocated == 1 && b->slots == 0) {
+            *Device_Number = b->device;
+            *Sector_Number = b->sector;
+            *Block_Number = b->block;
+        }
+        else {
+            Pack_Release(b);
+            if (Allocate_Block(Device_Number, Sector_Number, Block_Number) != 0) {
+                return -1;
+            }
+            *Moved = 1;
+        }
+        b->slots = 0;
+        if (Write_block(*Device_Number, *Sector_Number, *Block_Number, buf) != 0) {
+            return -1;
+        }
+    }
+    if (b->slots == 0) {
+        lcloud_dedup_insert(&fp, *Device_Number, *Sector_Number, *Block_Number);
+    }
+    else {
+        lcloud_dedup_forget(*Device_Number, *Sector_Number, *Block_Number);
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Cache_Stats_Line
+// Description  : Write one line of a statistics dump, to the dump file if
+//                there is one or else the log.
+//
+// Inputs       : out - the dump file (NULL for the log), and a printf format
+//                with its values
+// Outputs      : none
+void Cache_Stats_Line (FILE *out, const char *fmt, ...) {
+    char line[256];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+
+    if (out != NULL) {
+        fprintf(out, "%s\n", line);
+    }
+    else {
+        logMessage(LOG_INFO_LEVEL, "           ### %s", line);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Cache_Stats_Dump
+// Description  : Dump a snapshot of the cache statistics, for the whole cache,
+//                each device that was used and each file that was read.
+//
+// Inputs       : none
+// Outputs      : 0 - if successful. Else; -1
+int Cache_Stats_Dump (void) {
+    LcCacheStats snap;
+    FILE *out = NULL;
+
+    if (lcloud_cachestats(&snap) != 0) {
+        return -1;
+    }
+    if (Cache_Stats_Path != NULL) {
+        out = fopen(Cache_Stats_Path, "a");
+        if (out == NULL) {
+            logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: Could not open the cache statistics file '%s'", Cache_Stats_Path);
+            return -1;
+        }
+        fprintf(out, "# %ld\n", (long)time(NULL));
+    }
+
+    Cache_Stats_Line(out, "Cache stats: %i of %i blocks in use, hits %llu misses %llu inserts %llu updates %llu evictions %llu rejections %llu prefetch hits %llu prefetch wasted %llu",
+        snap.resident, snap.maxblocks,
+        (unsigned long long)snap.total.hits, (unsigned long long)snap.total.misses,
+        (unsigned long long)snap.total.inserts, (unsigned long long)snap.total.updates,
+        (unsigned long long)snap.total.evictions, (unsigned long long)snap.total.rejections,
+        (unsigned long long)snap.total.prefetch_hits, (unsigned long long)snap.total.prefetch_wasted);
+    for (int d = 0; d < LC_CACHE_MAX_DEVICES; d++) {
+        LcCacheCounters *c = &snap.device[d];
+        if (c->hits + c->misses + c->inserts + c->updates + c->rejections == 0) {
+            continue;
+        }
+        Cache_Stats_Line(out, "  device %2i: hits %llu misses %llu inserts %llu updates %llu evictions %llu rejections %llu prefetch hits %llu prefetch wasted %llu", d,
+            (unsigned long long)c->hits, (unsigned long long)c->misses, (unsigned long long)c->inserts,
+            (unsigned long long)c->updates, (unsigned long long)c->evictions, (unsigned long long)c->rejections,
+            (unsigned long long)c->prefetch_hits, (unsigned long long)c->prefetch_wasted);
+    }
+    if (MRC_Enabled == 1) {
+        Cache_Stats_Line(out, "  predicted hit ratio by size (%llu sampled): 16 %.1f%%, 64 %.1f%%, 256 %.1f%%, 1024 %.1f%%, 4096 %.1f%%",
+            (unsigned long long)lcloud_mrc_sampled(),
+            lcloud_mrc_hit_ratio(16) * 100, lcloud_mrc_hit_ratio(64) * 100, lcloud_mrc_hit_ratio(256) * 100,
+            lcloud_mrc_hit_ratio(1024) * 100, lcloud_mrc_hit_ratio(4096) * 100);
+    }
+    for (int fh = 1; fh <= File_Counter; fh++) {
+        if (FILE_HANDLE[fh].Cache_Hits + FILE_HANDLE[fh].Cache_Misses == 0) {
+            continue;
+        }
+        Cache_Stats_Line(out, "  file %4i: hits %i misses %i (%s)", fh,
+            FILE_HANDLE[fh].Cache_Hits, FILE_HANDLE[fh].Cache_Misses, FILE_HANDLE[fh].File_Name);
+    }
+
+    if (out != NULL) {
+        fclose(out);
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Cache_Stats_Tick
+// Description  : Dump the cache statistics if the interval has passed.
+//
+// Inputs       : none
+// Outputs      : none
+void Cache_Stats_Tick (void) {
+    time_t now;
+
+    if (Cache_Stats_Interval <= 0) {
+        return;
+    }
+    now = time(NULL);
+    if (now >= Cache_Stats_Next) {
+        if (Cache_Stats_Next != 0) {
+            Cache_Stats_Dump();
+        }
+        Cache_Stats_Next = now + Cache_Stats_Interval;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Lc_Read
+// Description  : Read data from the file 
+//
+// Inputs       : fh - file handle for the file to read from
+//                buf - place to put the data
+//                len - the length of the read
+// Outputs      : number of bytes read, -1 if failure
+int Lc_Read (LcFHandle fh, char *buf, size_t len) {
+    logMessage(LOG_OUTPUT_LEVEL, "          ### length handed to the lcread function %i", len);
+    logMessage(LOG_OUTPUT_LEVEL, "          ### The read write head's current position is %i", FILE_HANDLE[fh].position);
+    
+    //memcpy(buf, buf_pointer, 255); // fill the buffer with 0, to make sure that no outside data is getting in
+    Cache_Stats_Tick();
+
+    // Specal case to pretect agest derefrencing
+    if (len <= 0) { 
+        return 0;
+    }
+
+    // Block of data (size 256) sends it to the device. 
+    // The device will hold the block in the device. 
+    // Check length to see if it is valid
+    int Position = FILE_HANDLE[fh].position % 256;
+
+    // Check if file handle valid (is associated with open file)
+    if (FILE_HANDLE[fh].Path != 0) {
+        logMessage(LOG_OUTPUT_LEVEL, "          ### Device for data: %i'", FILE_HANDLE[fh].block[Position].device);
+    }
+    else {
+        logMessage(LOG_ERROR_LEVEL, "          ### ERROR-404: File hande NON-EXESTANCE");
+        return (-1);
+    }
+
+    // Figure out what device/sector/block for the data.
     //int Sector_Number = FILE_HANDLE[fh].position / (256*64);
     int Block_Number = FILE_HANDLE[fh].position / 256;
 
@@ -500,7 +2459,12 @@ int lcread( LcFHandle fh, char *buf, size_t len ) {
     // Keep track of what is allready read
     int Allready_Read = 256 - (FILE_HANDLE[fh].position % 256);
 
-    Read_Block (FILE_HANDLE[fh].block[Block_Number].device, Sectors_In_Device, Blocks_In_Device, buf);
+    // The block comes in whole, only the part asked for goes to buf.
+    char block[256];
+    int Head = FILE_HANDLE[fh].position;
+    if (Read_File_Block (fh, Block_Number, block) != 0) {
+        return (-1);
+    }
 
     ///////////////
     //memcpy(&Cache[Block_Number][Block_Number][Blocks_In_Device][0], buf, 256);  //<-- Uncomment this
@@ -510,18 +2474,25 @@ int lcread( LcFHandle fh, char *buf, size_t len ) {
     // Update the buffer length / update the read-write head.
     FILE_HANDLE[fh].position += len;
 
-    memcpy(buf, buf + Position, 256 - Position);  //<-- Uncomment this
+    memcpy(buf, block + Position, (len < (size_t)Allready_Read) ? len : (size_t)Allready_Read);
 
     if (Number_Of_Blocks > 0) {
         logMessage(LOG_OUTPUT_LEVEL, "          ### More data needed: Begning recurstion");
 
         FILE_HANDLE[fh].position -= data_left;
+        int status;
         if (Position == 0){
             
-            lcread(fh, buf + 256,  len - Allready_Read );
+            status = Lc_Read(fh, buf + 256,  len - Allready_Read );
         }
         else {
-            lcread(fh, buf + 256 - Position,  len - Allready_Read );
+            status = Lc_Read(fh, buf + 256 - Position,  len - Allready_Read );
+        }
+
+        // A block further on could not be read; the head goes back.
+        if (status == -1) {
+            FILE_HANDLE[fh].position = Head;
+            return (-1);
         }
         
         logMessage(LOG_OUTPUT_LEVEL, "          ### End Of Recursion");
@@ -540,172 +2511,570 @@ int lcread( LcFHandle fh, char *buf, size_t len ) {
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : lcwrite
-// Description  : write data to the file
+// Function     : Write_File_Block
+// Description  : Put one block of a file on the devices, placing it first if
+//                it is new, then update the file's map, checksum and journal.
 //
-// Inputs       : fh - file handle for the file to write to
-//                buf - pointer to data to write
-//                len - the length of the write
-// Outputs      : number of bytes written if successful test, -1 if failure
-int lcwrite( LcFHandle fh, char *buf, size_t len ) {
-    
+// Inputs       : The file handle, the block within the file and the buf
+//                pointer holding the 256 bytes.
+// Outputs      : 0 - if the block was written. Else; -1
+int Write_File_Block (LcFHandle fh, int File_Block_Number, char *new_buf) {
+
     // Storing what deviece to write to.
-    int Using_Device_Number = 0;
+    int Using_Device_Number = FILE_HANDLE[fh].block[File_Block_Number].device;
 
-    // Find what device to write to.
-    for (int i=0; i <= 15; i++) {
-        if (device[i].Power == 1) {
-            Using_Device_Number = i;
+    // Find the sector, block and position to put the new data. (Continue searching from last placement)
+    int Sector_Number = FILE_HANDLE[fh].block[File_Block_Number].sector;
+    int Block_Number = FILE_HANDLE[fh].block[File_Block_Number].block;
+
+    // Remember if this write places a new block (it has to be journaled).
+    int New_Block = 0;
+
+    // The file's partial last block (or one that was, and is still packed) is packed with other tails.
+    int Tail = (Tail_Pack_Enabled == 1 && Log_Structured_Enabled == 0 && Compress_Enabled == 0 && Dedup_Enabled == 0 &&
+                (FILE_HANDLE[fh].length < (File_Block_Number + 1) * 256 || FILE_HANDLE[fh].block[File_Block_Number].slots > 0));
+
+    if (FILE_HANDLE[fh].block[File_Block_Number].allocated != 1) {
+
+        ///////////////////////////
+        // Finding a new empty block to allocate. (The log, the packers and dedup place their own blocks.)
+        if (Log_Structured_Enabled == 0 && Compress_Enabled == 0 && Dedup_Enabled == 0 && Tail == 0 &&
+            Run_Take(fh, &Using_Device_Number, &Sector_Number, &Block_Number) != 0) {
+            return -1;  // Every device is full.
+        }
+        New_Block = 1;
+    }
+    logMessage(LOG_OUTPUT_LEVEL, "          ### Writting to device: '%i'  ", Using_Device_Number);
+    logMessage(LOG_OUTPUT_LEVEL, "          ### Writting to sector: '%i' and block number: '%i'", Sector_Number, Block_Number);
+
+    // Call the write block function.
+    int status;
+    if (Log_Structured_Enabled == 1) {
+
+        // The new version goes to the end of the log, the old one (if any) is now dead.
+        // The append may run the cleaner, which can move the old version, so
+        // it is looked up again afterwards.
+        status = Log_Write_Block(fh, File_Block_Number, new_buf, &Using_Device_Number, &Sector_Number, &Block_Number);
+        if (status == 0 && New_Block == 0) {
+            struct Block *Old = &FILE_HANDLE[fh].block[File_Block_Number];
+            lcloud_logfs_release(Old->device, Old->sector, Old->block);
+            device[Old->device].Used_Blocks[Old->sector][Old->block] = 0;
+            Free_Hint_Lower(Old->device, Old->sector, Old->block);
         }
+        New_Block = 1;
+    }
+    else if (Dedup_Enabled == 1) {
+        status = Dedup_Write_Block(fh, File_Block_Number, new_buf, &Using_Device_Number, &Sector_Number, &Block_Number, &New_Block);
+    }
+    else if (Compress_Enabled == 1) {
+        status = Pack_Write_Block(fh, File_Block_Number, new_buf, &Using_Device_Number, &Sector_Number, &Block_Number, &New_Block);
+    }
+    else if (Tail == 1) {
+        status = Tail_Write_Block(fh, File_Block_Number, new_buf, &Using_Device_Number, &Sector_Number, &Block_Number, &New_Block);
+    }
+    else {
+        status = Write_block(device[Using_Device_Number].Number, Sector_Number, Block_Number, new_buf);
     }
+    if (status == -1) {
+        logMessage(LOG_ERROR_LEVEL, "           ### The block was written Unsissesfully");
+        FILE_HANDLE[fh].Last_Valid = 0;
+        return -1;  // THE Block was unable to be written.
+    } 
 
-    // Find the number of sectors and blocks for the current device.
-    int Sectors_In_Device = device[Using_Device_Number].Number_Of_Sectors;
-    int Blocks_In_Device = device[Using_Device_Number].Number_Of_Blocks;
+    // Keep the new contents for the next write into this block.
+    memcpy(FILE_HANDLE[fh].Last_Data, new_buf, 256);
+    FILE_HANDLE[fh].Last_Block = File_Block_Number;
+    FILE_HANDLE[fh].Last_Valid = 1;
+
+    ////////////////////////////
+    // Update that file to know the blocks position.
+    FILE_HANDLE[fh].block[File_Block_Number].device = device[Using_Device_Number].Number;
+    FILE_HANDLE[fh].block[File_Block_Number].sector = Sector_Number;
+    FILE_HANDLE[fh].block[File_Block_Number].block = Block_Number;
+    FILE_HANDLE[fh].block[File_Block_Number].allocated = 1;
+
+    // Remember the checksum of what was written (journaled when the file is closed).
+    if (Checksum_Enabled == 1) {
+        FILE_HANDLE[fh].block[File_Block_Number].crc = lcloud_crc32c(0, new_buf, 256);
+        FILE_HANDLE[fh].block[File_Block_Number].crc_valid = 1;
+        FILE_HANDLE[fh].block[File_Block_Number].crc_dirty = 1;
+    }
+
+    // Log where the block went (once it is out, if it is held in a batch).
+    if (New_Block == 1 && Write_Batch.Open == 1) {
+        Write_Batch.Map_File[Write_Batch.Maps] = fh;
+        Write_Batch.Map_Block[Write_Batch.Maps] = File_Block_Number;
+        Write_Batch.Maps++;
+    }
+    else if (New_Block == 1) {
+        return Journal_Map(fh, File_Block_Number);
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Write_Buffer_Flush
+// Description  : Send every block waiting in a file's write buffer to the
+//                devices, in file order and in one batch (see
+//                Write_Batch_Begin), and empty the buffer.  The new blocks
+//                among them are only placed now, together (see Run_Take).
+//
+// Inputs       : The file handle
+// Outputs      : 0 - if every block was written. Else; -1
+int Write_Buffer_Flush (LcFHandle fh) {
+    int status = 0;
+
+    if (FILE_HANDLE[fh].Buffer_Count == 0) {
+        return 0;
+    }
+    Write_Stats.flushes += 1;
+    int Began = Write_Batch_Begin();
+    int New_Blocks = 0;
+    for (int i = 0; i < FILE_HANDLE[fh].Buffer_Count; i++) {
+        New_Blocks += (FILE_HANDLE[fh].block[FILE_HANDLE[fh].Buffer_First + i].allocated != 1);
+    }
+    Run_Open(New_Blocks);
+    for (int i = 0; i < FILE_HANDLE[fh].Buffer_Count; i++) {
+        if (Write_File_Block(fh, FILE_HANDLE[fh].Buffer_First + i, FILE_HANDLE[fh].Buffer + i * 256) != 0) {
+            status = -1;
+        }
+        Write_Stats.flushed += 1;
+    }
+    Run_Close();
+    if (Began == 1 && Write_Batch_End() != 0) {
+        status = -1;
+    }
+    FILE_HANDLE[fh].Buffer_Count = 0;
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Write_Buffer_Add
+// Description  : Make room in a file's write buffer for a block.  The buffer
+//                only holds a run of blocks, so a block that does not extend
+//                the run (or does not fit) sends the run out first.
+//
+// Inputs       : The file handle and the block within the file
+// Outputs      : pointer to the 256 bytes for the block, NULL if failure
+char * Write_Buffer_Add (LcFHandle fh, int File_Block_Number) {
+    if (FILE_HANDLE[fh].Buffer == NULL) {
+        FILE_HANDLE[fh].Buffer = lcloud_arena_alloc(&Buffer_Arena, Write_Buffer_Blocks * 256);
+        if (FILE_HANDLE[fh].Buffer == NULL) {
+            return NULL;
+        }
+    }
+    if (FILE_HANDLE[fh].Buffer_Count > 0 &&
+        (File_Block_Number != FILE_HANDLE[fh].Buffer_First + FILE_HANDLE[fh].Buffer_Count ||
+         FILE_HANDLE[fh].Buffer_Count == Write_Buffer_Blocks)) {
+        if (Write_Buffer_Flush(fh) != 0) {
+            return NULL;
+        }
+    }
+    if (FILE_HANDLE[fh].Buffer_Count == 0) {
+        FILE_HANDLE[fh].Buffer_First = File_Block_Number;
+    }
+    FILE_HANDLE[fh].Buffer_Count++;
+    return Write_Buffer_Block(fh, File_Block_Number);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Lc_Write
+// Description  : write data to the file
+//
+// Inputs       : fh - file handle for the file to write to
+//                buf - pointer to data to write
+//                len - the length of the write
+// Outputs      : number of bytes written if successful test, -1 if failure
+int Lc_Write (LcFHandle fh, char *buf, size_t len) {
+    Cache_Stats_Tick();
     
     int Position = FILE_HANDLE[fh].position % 256;
 
     // Find how much data exsists
     int File_Block_Number = FILE_HANDLE[fh].position / 256;  //<-- This number is wrong -- thanks past me UGHHH -- spent 8 hours figurning out somting i allready knew, maybe I should switch to IST?
 
-    // Find the sector, block and position to put the new data. (Continue searching from last placement)
-    int Sector_Number = FILE_HANDLE[fh].block[File_Block_Number].sector;
-    int Block_Number = FILE_HANDLE[fh].block[File_Block_Number].block;
-    
-    char new_buf [255] = "";
+    char local_buf [256] = "";
+    char *new_buf = local_buf;
 
+    // The part of this block the write covers.
+    int Chunk = (Position + len < 256) ? len : 256 - Position;
 
-    logMessage(LOG_OUTPUT_LEVEL, "          ### Writting to device: '%i'  ", Using_Device_Number);
     logMessage(LOG_OUTPUT_LEVEL, "          ### Read/Write head: '%i'  ", FILE_HANDLE[fh].position);
     logMessage(LOG_OUTPUT_LEVEL, "          ### Taking input from: '%i'  ", File_Block_Number);
-    logMessage(LOG_OUTPUT_LEVEL, "          ### Writting to sector: '%i' and block number: '%i'", Sector_Number, Block_Number);
 
     ///////////////////////////
-    // If block is not empty; '1' is the 2d array.
+    // A block allready in the write buffer is just changed there.
+    char *Buffered = NULL;
+    if (Write_Buffer_Blocks > 0) {
+        Buffered = Write_Buffer_Block(fh, File_Block_Number);
+    }
+
+    ///////////////////////////
     // Check if the block has data.
-    if (FILE_HANDLE[fh].block[File_Block_Number].allocated == 1) { //// <- Position > 0 // Gets furhter
-        logMessage(LOG_OUTPUT_LEVEL, "          ### There is data in this block -- retreaving old data");
+    if (Buffered != NULL) {
+        new_buf = Buffered;
+        Write_Stats.absorbed += 1;
+    }
+    else if (FILE_HANDLE[fh].block[File_Block_Number].allocated == 1) { //// <- Position > 0 // Gets furhter
 
-        // Read what is allreading in the block.
-        Using_Device_Number = FILE_HANDLE[fh].block[File_Block_Number].device;
+        // Only the bytes the write leaves alone are needed.  None are when it
+        // starts the block and runs to its end (or past the end of the file).
+        if (Position == 0 && (Chunk == 256 || File_Block_Number * 256 + Chunk >= FILE_HANDLE[fh].length)) {
+            Write_Stats.covered += 1;
+        }
+        else if (FILE_HANDLE[fh].Last_Valid == 1 && FILE_HANDLE[fh].Last_Block == File_Block_Number) {
+            memcpy(new_buf, FILE_HANDLE[fh].Last_Data, 256);
+            Write_Stats.merged += 1;
+        }
+        else {
+            logMessage(LOG_OUTPUT_LEVEL, "          ### There is data in this block -- retreaving old data");
 
-        Read_Block (device[Using_Device_Number].Number, FILE_HANDLE[fh].block[File_Block_Number].sector, FILE_HANDLE[fh].block[File_Block_Number].block, new_buf);
+            // Read what is allreading in the block.
+            if (Read_File_Block (fh, File_Block_Number, new_buf) != 0) {
+                return -1;
+            }
+            Write_Stats.read += 1;
+        }
+    }
+    
+    // Value for the amount of data wrote
+    int data_left = len - Chunk;
 
+    // # AFTER WRITTING #
+    // Move past the data, the file only grows if the write ran past its end.
+    memcpy (new_buf + Position, buf, Chunk);
+    FILE_HANDLE[fh].position += Chunk;
+    if (FILE_HANDLE[fh].position > FILE_HANDLE[fh].length) {
+        FILE_HANDLE[fh].length = FILE_HANDLE[fh].position;
     }
-    else {
 
-        ///////////////////////////
-        // Finding a new empty block to allocate.
-        // If another device did not allready take it.
-        while (device[Using_Device_Number].Used_Blocks[Sector_Number][Block_Number] != 0) {
-
-            // If the block if used by a diffrent file, get a new block.
-            if (Block_Number >= Blocks_In_Device-1) {
-                Block_Number = 0;
-                
-                // If the sector is full, find a new sector
-                if (Sector_Number >= Sectors_In_Device-1) {
-                    Sector_Number = 0;
-                    device[Using_Device_Number].Device_Full = 1;
-
-                    // If device is
-                    for (int i=0; i <= 15; i++) {
-                        if (device[i].Power == 1 && device[i].Device_Full == 0) {
-                            logMessage(LOG_OUTPUT_LEVEL, "          ### Device: '%i' is availible at position %i", device[i].Number, i);
-                            Using_Device_Number = i;
-                        }
-                    }
-                    Sectors_In_Device = device[Using_Device_Number].Number_Of_Sectors;
-                    Blocks_In_Device = device[Using_Device_Number].Number_Of_Blocks;
-                }
-                else {
-                    Sector_Number++;
-                }
-            }
-            else {
-                Block_Number++;
+    // The block goes into the write buffer, or without one straight out.
+    if (Buffered == NULL) {
+        if (Write_Buffer_Blocks > 0) {
+            Buffered = Write_Buffer_Add(fh, File_Block_Number);
+            if (Buffered == NULL) {
+                return -1;
             }
+            memcpy(Buffered, new_buf, 256);
         }
-        device[Using_Device_Number].Used_Blocks[Sector_Number][Block_Number] = Using_Device_Number;
+        else if (Write_File_Block(fh, File_Block_Number, new_buf) != 0) {
+            return -1;
+        }
+    }
+
+    ///////////////////////////
+    // for if the size is greater than 256 - position RECURSION!
+    if (data_left > 0) {
         
-        if (Block_Number >= Blocks_In_Device){
-                Block_Number = 0;
-                Sector_Number++;
+        // Write the data left in the buffer, using RECURRSION!!
+        if (Lc_Write(fh, buf + Chunk, data_left) == -1) {
+            return -1;
         }
     }
-    logMessage(LOG_OUTPUT_LEVEL, "          ### Writting to device: '%i'  ", Using_Device_Number);
-    logMessage(LOG_OUTPUT_LEVEL, "          ### Writting to sector: '%i' and block number: '%i'", Sector_Number, Block_Number);
     
-    // Value for the amount of data wrote
-    int data_left = len - (256 - Position);
+    return(len);
+}
+
 
-    // # AFTER WRITTING #
-    // Add the size of the data to the size of the file. 
-    FILE_HANDLE[fh].length += len;
-    FILE_HANDLE[fh].position += len;
-    
-    if (Position + len < 256) {
 
-        // For data less then one block
-        memcpy (new_buf + Position, buf, len); 
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Iov_Plan
+// Description  : Work out where each segment of a vectored call goes, and
+//                every block of the file they touch (each once, in order).
+//
+// Inputs       : fh - the file handle
+//                iov, count - the segments
+//                Off, End - set to where each segment starts and ends
+//                Blocks - set to the blocks touched (from Iov_Arena)
+// Outputs      : the number of blocks touched, -1 if failure
+int Iov_Plan (LcFHandle fh, const LcIoVec *iov, int count, size_t *Off, size_t *End, int **Blocks) {
+    size_t at = FILE_HANDLE[fh].position;
+    int n = 0, spans = 0;
+
+    for (int i = 0; i < count; i++) {
+        Off[i] = (iov[i].off == LC_IOV_HEAD) ? at : iov[i].off;
+        End[i] = Off[i] + iov[i].len;
+        if (End[i] < Off[i] || End[i] > 2000 * 256) {
+            return -1;  // Past the largest file.
+        }
+        if (End[i] > Off[i]) {
+            spans += (End[i] - 1) / 256 - Off[i] / 256 + 1;
+        }
+        at = End[i];
     }
 
-    else {
-        memcpy (new_buf + Position, buf, 256 - Position); 
+    // Mark the blocks, then list them.
+    uint8_t Touched[2000] = {0};
+    for (int i = 0; i < count; i++) {
+        for (size_t blk = Off[i] / 256; End[i] > Off[i] && blk <= (End[i] - 1) / 256; blk++) {
+            Touched[blk] = 1;
+        }
+    }
+    *Blocks = lcloud_arena_alloc(&Iov_Arena, (spans > 0 ? spans : 1) * sizeof(int));
+    if (*Blocks == NULL) {
+        return -1;
+    }
+    for (int blk = 0; blk < 2000; blk++) {
+        if (Touched[blk] == 1) {
+            (*Blocks)[n++] = blk;
+        }
+    }
+    return n;
+}
 
-        // Whole length could not be written, the position must be updatad.
-        FILE_HANDLE[fh].length -= data_left;
-        FILE_HANDLE[fh].position -= data_left;
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Lc_Readv
+// Description  : Read many segments of a file.  The blocks they touch are
+//                planned together, each read once, and the ones not cached
+//                fetched over the bus a batch at a time (one round trip each)
+//                before the segments are copied out of them.
+//
+// Inputs       : fh - the file handle of the file to read from
+//                iov, count - the segments (cut short at the end of the file)
+// Outputs      : number of bytes read, -1 if failure
+int Lc_Readv (LcFHandle fh, const LcIoVec *iov, int count) {
+    size_t *Off = lcloud_arena_alloc(&Iov_Arena, count * sizeof(size_t));
+    size_t *End = lcloud_arena_alloc(&Iov_Arena, count * sizeof(size_t));
+    int *Blocks = NULL, n, total = 0, failed = 0;
+    char block[256];
+    int Held = -1;  // The block in block[]
+
+    Cache_Stats_Tick();
+    n = (Off == NULL || End == NULL) ? -1 : Iov_Plan(fh, iov, count, Off, End, &Blocks);
+    if (n < 0) {
+        lcloud_arena_reset(&Iov_Arena);
+        return -1;
     }
 
-    // Call the write block function.
-    int status = Write_block(device[Using_Device_Number].Number, Sector_Number, Block_Number, new_buf);
-    if (status == -1) {
-        logMessage(LOG_ERROR_LEVEL, "           ### The block was written Unsissesfully");
-        return -1;  // THE Block was unable to be written.
-    } 
+    // Nothing is read past the end of the file.
+    for (int i = 0; i < count; i++) {
+        if (End[i] > (size_t)FILE_HANDLE[fh].length) {
+            End[i] = (Off[i] > (size_t)FILE_HANDLE[fh].length) ? Off[i] : FILE_HANDLE[fh].length;
+        }
+    }
 
-    
+    // A round is half the smallest cache, so it is still cached when it is copied out.
+    for (int first = 0; first < n; first += LC_CACHE_MINBLOCKS / 2) {
+        int last = (first + LC_CACHE_MINBLOCKS / 2 < n) ? first + LC_CACHE_MINBLOCKS / 2 - 1 : n - 1;
 
-    ////////////////////////////
-    // Write to the current block as much as posible.
-    // Create the empty array
-    // Update that file to know the blocks position.
-    FILE_HANDLE[fh].block[File_Block_Number].device = device[Using_Device_Number].Number;
-    FILE_HANDLE[fh].block[File_Block_Number].sector = Sector_Number;
-    FILE_HANDLE[fh].block[File_Block_Number].block = Block_Number;
-    FILE_HANDLE[fh].block[File_Block_Number].allocated = 1;
+        Read_Batch(fh, Blocks + first, last - first + 1);
+        for (int i = 0; i < count; i++) {
+            for (size_t pos = Off[i]; pos < End[i]; pos = (pos / 256 + 1) * 256) {
+                int blk = pos / 256;
+                size_t chunk = (pos / 256 + 1) * 256 > End[i] ? End[i] - pos : 256 - pos % 256;
+
+                if (blk < Blocks[first] || blk > Blocks[last]) {
+                    continue;
+                }
+
+                // A whole block goes straight into the segment.
+                if (chunk == 256) {
+                    if (Read_File_Block(fh, blk, iov[i].base + (pos - Off[i])) != 0) {
+                        failed = 1;
+                    }
+                    continue;
+                }
+                if (blk != Held) {
+                    if (Read_File_Block(fh, blk, block) != 0) {
+                        failed = 1;
+                    }
+                    Held = blk;
+                }
+                memcpy(iov[i].base + (pos - Off[i]), block + pos % 256, chunk);
+            }
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        total += End[i] - Off[i];
+    }
+
+    // A block that could not be read fails the call (the head stays put).
+    if (count > 0 && failed == 0) {
+        FILE_HANDLE[fh].position = End[count - 1];
+    }
+
+    lcloud_arena_reset(&Iov_Arena);
+    return (failed == 0) ? total : -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Lc_Writev
+// Description  : Write many segments of a file.  Each block they touch is
+//                built once (a block shared by segments is not read or
+//                written twice), the old contents the segments leave alone
+//                are fetched a batch at a time, and the new blocks go out
+//                through the write buffer, or without one in one batch.
+//
+// Inputs       : fh - the file handle of the file to write to
+//                iov, count - the segments, applied in order (none may
+//                             start past the end of the file)
+// Outputs      : number of bytes written if successful, -1 if failure
+int Lc_Writev (LcFHandle fh, const LcIoVec *iov, int count) {
+    size_t *Off = lcloud_arena_alloc(&Iov_Arena, count * sizeof(size_t));
+    size_t *End = lcloud_arena_alloc(&Iov_Arena, count * sizeof(size_t));
+    int *Blocks = NULL, *Fetch = NULL, n, fetches = 0, status = 0, total = 0;
+    char *Image = NULL;
+    uint8_t *Kept = NULL;   // The bytes of each block no segment writes
+    size_t Length = FILE_HANDLE[fh].length;
+
+    Cache_Stats_Tick();
+    n = (Off == NULL || End == NULL) ? -1 : Iov_Plan(fh, iov, count, Off, End, &Blocks);
+    for (int i = 0; i < count && n >= 0; i++) {
+        if (Off[i] > Length) {
+            n = -1;     // It would leave a hole.
+        }
+        Length = (End[i] > Length) ? End[i] : Length;
+    }
+    if (n > 0) {
+        Image = lcloud_arena_alloc(&Iov_Arena, n * 256);
+        Kept = lcloud_arena_alloc(&Iov_Arena, n * 256);
+        Fetch = lcloud_arena_alloc(&Iov_Arena, n * sizeof(int));
+    }
+    if (n < 0 || (n > 0 && (Image == NULL || Kept == NULL || Fetch == NULL))) {
+        lcloud_arena_reset(&Iov_Arena);
+        return -1;
+    }
+
+    ///////////////////////////
+    // Find which old bytes are kept (before the file's end), and where they come from.
+    memset(Image, 0, n * 256);
+    memset(Kept, 1, n * 256);
+    for (int k = 0, i = 0; i < count; i++) {
+        for (size_t pos = Off[i]; pos < End[i]; pos = (pos / 256 + 1) * 256) {
+            size_t chunk = (pos / 256 + 1) * 256 > End[i] ? End[i] - pos : 256 - pos % 256;
+            while (Blocks[k] != (int)(pos / 256)) {
+                k = (Blocks[k] < (int)(pos / 256)) ? k + 1 : 0;
+            }
+            memset(Kept + k * 256 + pos % 256, 0, chunk);
+        }
+    }
+    for (int k = 0; k < n; k++) {
+        int blk = Blocks[k], needed = 0;
+        for (int j = 0; j < 256 && blk * 256 + j < FILE_HANDLE[fh].length; j++) {
+            needed |= Kept[k * 256 + j];
+        }
+        char *Buffered = Write_Buffer_Block(fh, blk);
+
+        if (Buffered != NULL) {
+            memcpy(Image + k * 256, Buffered, 256);
+            Write_Stats.absorbed += 1;
+        }
+        else if (FILE_HANDLE[fh].block[blk].allocated != 1) {
+            continue;
+        }
+        else if (needed == 0) {
+            Write_Stats.covered += 1;
+        }
+        else if (FILE_HANDLE[fh].Last_Valid == 1 && FILE_HANDLE[fh].Last_Block == blk) {
+            memcpy(Image + k * 256, FILE_HANDLE[fh].Last_Data, 256);
+            Write_Stats.merged += 1;
+        }
+        else {
+            Fetch[fetches++] = k;
+            Write_Stats.read += 1;
+        }
+    }
+
+    // The blocks to read back go together, a round at a time.
+    for (int first = 0; first < fetches; first += LC_CACHE_MINBLOCKS / 2) {
+        int round = (fetches - first < LC_CACHE_MINBLOCKS / 2) ? fetches - first : LC_CACHE_MINBLOCKS / 2;
+        int Wanted[LC_CACHE_MINBLOCKS / 2];
+
+        for (int j = 0; j < round; j++) {
+            Wanted[j] = Blocks[Fetch[first + j]];
+        }
+        Read_Batch(fh, Wanted, round);
+        for (int j = 0; j < round; j++) {
+            if (Read_File_Block(fh, Wanted[j], Image + Fetch[first + j] * 256) != 0) {
+                status = -1;
+            }
+        }
+    }
 
-    device[Using_Device_Number].Used_Blocks[FILE_HANDLE[fh].block[Block_Number].sector][FILE_HANDLE[fh].block[Block_Number].block] = 1;
+    // An old block that could not be read back fails the write, before anything changes.
+    if (status != 0) {
+        lcloud_arena_reset(&Iov_Arena);
+        return -1;
+    }
 
     ///////////////////////////
-    // for if the size is greater than 256 - position RECURSION!
-    if (256 - Position < len) {
-        
-        // Write the data left in the buffer, using RECURRSION!!
-        lcwrite(fh, buf + (256 - Position), data_left);
+    // Lay the segments over the blocks, in order.
+    for (int k = 0, i = 0; i < count; i++) {
+        for (size_t pos = Off[i]; pos < End[i]; pos = (pos / 256 + 1) * 256) {
+            size_t chunk = (pos / 256 + 1) * 256 > End[i] ? End[i] - pos : 256 - pos % 256;
+            while (Blocks[k] != (int)(pos / 256)) {
+                k = (Blocks[k] < (int)(pos / 256)) ? k + 1 : 0;
+            }
+            memcpy(Image + k * 256 + pos % 256, iov[i].base + (pos - Off[i]), chunk);
+        }
+        total += End[i] - Off[i];
     }
-    
-    logMessage(LOG_OUTPUT_LEVEL, "          ### blocks per sector: '%i'  ", Blocks_In_Device);
-    return(len);
-}
 
+    // Then send them out (without the write buffers, the new ones placed
+    // together).  The length is set first, the tail of the file is found by it.
+    FILE_HANDLE[fh].length = Length;
+    int Began = (Write_Buffer_Blocks > 0) ? 0 : Write_Batch_Begin();
+    if (Write_Buffer_Blocks == 0) {
+        int New_Blocks = 0;
+        for (int k = 0; k < n; k++) {
+            New_Blocks += (FILE_HANDLE[fh].block[Blocks[k]].allocated != 1);
+        }
+        Run_Open(New_Blocks);
+    }
+    for (int k = 0; k < n && status == 0; k++) {
+        if (Write_Buffer_Blocks > 0) {
+            char *Buffered = Write_Buffer_Block(fh, Blocks[k]);
+            if (Buffered == NULL) {
+                Buffered = Write_Buffer_Add(fh, Blocks[k]);
+            }
+            if (Buffered == NULL) {
+                status = -1;
+            }
+            else {
+                memcpy(Buffered, Image + k * 256, 256);
+            }
+        }
+        else if (Write_File_Block(fh, Blocks[k], Image + k * 256) != 0) {
+            status = -1;
+        }
+    }
+    Run_Close();
+    if (Began == 1 && Write_Batch_End() != 0) {
+        status = -1;
+    }
+    if (count > 0) {
+        FILE_HANDLE[fh].position = End[count - 1];
+    }
 
+    lcloud_arena_reset(&Iov_Arena);
+    return (status == 0) ? total : -1;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : lcseek
+// Function     : Lc_Seek
 // Description  : Seek to a specific place in the file
 //
 // Inputs       : fh - the file handle of the file to seek in
 //                off - offset within the file to seek to
 // Outputs      : position if successful test, -1 if failure
-int lcseek( LcFHandle fh, size_t off ) {
+int Lc_Seek (LcFHandle fh, size_t off) {
     // Changes the pointer. (NO OPPERATIONS BEING DONE.)
     //logMessage(LOG_OUTPUT_LEVEL, "LcHandle handed to the lcseek function %i", fh);
     //logMessage(LOG_OUTPUT_LEVEL, "size handed to the lcseek function %i", off);
     //logMessage(LOG_OUTPUT_LEVEL, "The read write head's current position is %i", FILE_HANDLE[fh].position);
     
+    // The buffered writes go out before the head moves.
+    if (Write_Buffer_Flush(fh) != 0) {
+        return (-1);
+    }
+
     // Check if the offset is greater than the lengh of data. 
     if (off <= FILE_HANDLE[fh].length) {
 
@@ -724,15 +3093,33 @@ int lcseek( LcFHandle fh, size_t off ) {
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : lcclose
+// Function     : Lc_Close
 // Description  : Close the file
 //
 // Inputs       : fh - the file handle of the file to close
 // Outputs      : 0 if successful test, -1 if failure
-int lcclose( LcFHandle fh ) {
+int Lc_Close (LcFHandle fh) {
 
-    //1. Set the file handels device to 0.
+    //1. Set the file handels device to 0, and send out the buffered writes (then free the blocks put aside for it).
     FILE_HANDLE[fh].Device_Id = 0;
+    if (Write_Buffer_Flush(fh) != 0) {
+        FILE_HANDLE[fh].Device_Id = -1;
+    }
+    Run_Return(fh);
+
+    //2. Idle time: clean a few segments, then make sure the data is on the devices before its metadata.
+    if (Log_Structured_Enabled == 1) {
+        lcloud_logfs_clean(LC_LOG_CLEAN_IDLE);
+        lcloud_logfs_flush();
+    }
+
+    //3. Commit the file's metadata to the journal (the close fails if it can not be).
+    if (Journal_Enabled == 1) {
+        if ((Checksum_Enabled == 1 && Journal_Checksums(fh, 0) != 0) ||
+            Journal_Length(fh) != 0 || lcloud_journal_commit() != 0) {
+            FILE_HANDLE[fh].Device_Id = -1;
+        }
+    }
 
 
     //3. Check for the return values in the registers for failures, etc.)
@@ -747,15 +3134,38 @@ int lcclose( LcFHandle fh ) {
 
 ////////////////////////////////////////////////////////////////////////////////
 //
-// Function     : lcshutdown
+// Function     : Lc_Shutdown
 // Description  : Shut down the filesystem
 //
 // Inputs       : none
 // Outputs      : 0 if successful test, -1 if failure
-int lcshutdown( void ) {
+int Lc_Shutdown (void) {
 
     // Create a buss address object for packing.
     struct Buss BUSS_ADDRESS;
+    LcSchedStats Sched_Stats;
+    LcGateStats Gate_Stats;
+    const char *Class_Name[LC_SCHED_CLASSES] = { "reads", "writes", "background" };
+
+    //0. Write out the last of the data and metadata, while the devices are still on.
+    for (int fh = 1; fh <= File_Counter; fh++) {
+        Write_Buffer_Flush(fh);
+        Run_Return(fh);
+        FILE_HANDLE[fh].Buffer = NULL;
+    }
+    lcloud_arena_reset(&Buffer_Arena);
+    if (Log_Structured_Enabled == 1) {
+        lcloud_logfs_close();
+    }
+    if (Journal_Enabled == 1) {
+        for (int fh = 1; fh <= File_Counter; fh++) {
+            if (Checksum_Enabled == 1) {
+                Journal_Checksums(fh, 0);
+            }
+            Journal_Length(fh);
+        }
+        lcloud_journal_close();
+    }
 
     //1. Pack the registers using your create_lcloud_registers function
     BUSS_ADDRESS.b0 = 0;
@@ -775,13 +3185,82 @@ int lcshutdown( void ) {
     extract_lcloud_registers(Packed_Registers, &BUSS_ADDRESS);
     //5. Check for the return values in the registers for failures, etc.)
 
-    // Closing the cache
+    // Closing the cache (after a last dump of its statistics)
+    if (Cache_Stats_Interval > 0) {
+        Cache_Stats_Dump();
+        Cache_Stats_Next = 0;
+    }
+    if (Cache_Warm_Enabled == 1 && Cache_Enabled == 1) {
+        lcloud_cache_save(Cache_Warm_Path, Cache_Identity());
+    }
     lcloud_closecache();
+    if (Cache_L2_Enabled == 1) {
+        LcL2Stats Tier;
+        lcloud_l2_stats(&Tier);
+        logMessage(LOG_INFO_LEVEL, "           ### Local cache tier ###: '%llu' misses served, '%llu' not, '%i' blocks kept from the last run, '%i' of '%i' kept for the next",
+            (unsigned long long)Tier.hits, (unsigned long long)Tier.misses, Tier.recovered, Tier.resident, Tier.blocks);
+        lcloud_l2_close(Cache_Identity());
+    }
+    if (MRC_Enabled == 1) {
+        logMessage(LOG_INFO_LEVEL, "           ### Miss ratio curve ###: predicted hit ratio %.1f%% at 16 blocks, %.1f%% at 64, %.1f%% at 256, %.1f%% at 1024, %.1f%% at 4096",
+            lcloud_mrc_hit_ratio(16) * 100, lcloud_mrc_hit_ratio(64) * 100, lcloud_mrc_hit_ratio(256) * 100,
+            lcloud_mrc_hit_ratio(1024) * 100, lcloud_mrc_hit_ratio(4096) * 100);
+        lcloud_mrc_close();
+    }
+    if (Dedup_Enabled == 1) {
+        lcloud_dedup_close();
+    }
+
+    // The next lcopen has to power the bus back on (and remount the journal).
+    buss_on = 0;
+    Pack_Open.allocated = 0;
 
     // Show the hit ratio for the cache accesses.
     logMessage(LOG_INFO_LEVEL, "           ### Cache ###: The hit ratio: '%f' Percent", ((float)Stats.hits)/(((float)Stats.hits + Stats.misses)) * 100 );
     logMessage(LOG_INFO_LEVEL, "           ### Number of hits: '%i'", Stats.hits);
     logMessage(LOG_INFO_LEVEL, "           ### Number of Misses: '%i'", Stats.misses);
+    logMessage(LOG_INFO_LEVEL, "           ### Writes ###: '%i' blocks replaced whole, '%i' merged with the last write, '%i' read back first",
+        Write_Stats.covered, Write_Stats.merged, Write_Stats.read);
+    if (Write_Buffer_Blocks > 0) {
+        logMessage(LOG_INFO_LEVEL, "           ### Write buffers ###: '%i' writes absorbed, '%i' blocks sent in '%i' flushes",
+            Write_Stats.absorbed, Write_Stats.flushed, Write_Stats.flushes);
+    }
+    if (Write_Batch.batches + Write_Batch.prefetched > 0) {
+        logMessage(LOG_INFO_LEVEL, "           ### Batches ###: '%i' blocks written in '%i' round trips, '%i' blocks read ahead",
+            Write_Batch.batched, Write_Batch.batches, Write_Batch.prefetched);
+    }
+    if (Run_Stats.runs > 0) {
+        logMessage(LOG_INFO_LEVEL, "           ### Delayed allocation ###: '%i' new blocks placed in '%i' runs put aside for files ('%i' carried on from the last), '%i' left over and freed",
+            Run_Stats.placed, Run_Stats.runs, Run_Stats.carried, Run_Stats.returned);
+    }
+    if (lcloud_sched_stats(&Sched_Stats) == 0 && Sched_Stats.requests > 0) {
+        logMessage(LOG_INFO_LEVEL, "           ### Scheduler ###: '%llu' transfers asked for, '%llu' merged, '%llu' sent in '%llu' round trips",
+            (unsigned long long)Sched_Stats.requests, (unsigned long long)Sched_Stats.merged,
+            (unsigned long long)Sched_Stats.dispatched, (unsigned long long)Sched_Stats.rounds);
+    }
+    for (int c = 0; c < LC_SCHED_CLASSES && Io_Priority_Enabled == 1; c++) {
+        if (lcloud_sched_gate_stats(c, &Gate_Stats) == 0 && Gate_Stats.turns > 0) {
+            logMessage(LOG_INFO_LEVEL, "           ### Priority ###: '%llu' %s let in ('%llu' waited), 99th percentile wait under '%llu' usec, longest '%llu' usec",
+                (unsigned long long)Gate_Stats.turns, Class_Name[c], (unsigned long long)Gate_Stats.waited,
+                (unsigned long long)Gate_Stats.p99_usec, (unsigned long long)Gate_Stats.max_usec);
+        }
+    }
+    if (Tail_Stats.packed + Tail_Stats.whole > 0) {
+        logMessage(LOG_INFO_LEVEL, "           ### Tails ###: '%i' partial last blocks packed with other tails, '%i' stored whole",
+            Tail_Stats.packed, Tail_Stats.whole);
+    }
+    if (Compress_Enabled == 1) {
+        logMessage(LOG_INFO_LEVEL, "           ### Compression ###: '%i' blocks packed, '%i' skipped, '%i' stored whole",
+            Compress_Stats.packed, Compress_Stats.skipped, Compress_Stats.whole);
+    }
+    if (Checksum_Enabled == 1) {
+        logMessage(LOG_INFO_LEVEL, "           ### Checksums ###: '%i' blocks verified (%s), '%i' mismatches, '%i' repaired from the device",
+            Checksum_Stats.verified, lcloud_crc32c_hardware() ? "CRC32 instruction" : "table", Checksum_Stats.failures, Checksum_Stats.repaired);
+    }
+    if (Dedup_Enabled == 1) {
+        logMessage(LOG_INFO_LEVEL, "           ### Dedup ###: '%i' blocks shared, '%i' stored, '%i' fingerprint collisions",
+            Dedup_Stats.shared, Dedup_Stats.stored, Dedup_Stats.collisions);
+    }
 
     if (BUSS_ADDRESS.b1 != 1) {
         // Device has failed
@@ -791,3 +3270,476 @@ int lcshutdown( void ) {
         return 0;
     }
 }
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : File_Lock_Init
+// Description  : Set up the file locks (once).
+//
+// Inputs       : none
+// Outputs      : none
+void File_Lock_Init (void) {
+    for (int fh = 0; fh < 2000; fh++) {
+        pthread_rwlock_init(&File_Lock[fh], NULL);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Fs_Enter
+// Description  : Take the filesystem for a call.  With Io_Priority_Enabled
+//                the calls waiting go in by class (reads, then writes, then
+//                the files made background), and fairly between the files
+//                of a class, by the blocks each has moved over its weight.
+//                Calls that are not for one file (lcopen, lcshutdown) go in
+//                as writes.
+//
+// Inputs       : fh - the file handle (its lock held, if it is a file; -1 if none)
+//                exclusive - 1 if the call changes the file
+//                len - the bytes it moves
+// Outputs      : none
+void Fs_Enter (LcFHandle fh, int exclusive, size_t len) {
+    if (Io_Priority_Enabled == 1) {
+        int file = (fh >= 0 && fh < 2000);
+        int cls = (file && FILE_HANDLE[fh].Background == 1) ? LC_SCHED_BACKGROUND :
+                  exclusive ? LC_SCHED_WRITE : LC_SCHED_READ;
+        lcloud_sched_enter(cls, fh, (uint32_t)(len / 256 + 1), file ? FILE_HANDLE[fh].Weight : 1);
+    }
+    pthread_mutex_lock(&Fs_Lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : Fs_Leave
+// Description  : Give the filesystem to the next call.
+//
+// Inputs       : none
+// Outputs      : none
+void Fs_Leave (void) {
+    pthread_mutex_unlock(&Fs_Lock);
+    if (Io_Priority_Enabled == 1) {
+        lcloud_sched_leave();
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : File_Lock_Take
+// Description  : Lock a file's map, then the filesystem.
+//
+// Inputs       : fh - the file handle, exclusive - 1 to change the file
+//                len - the bytes the call moves
+// Outputs      : the file's lock (to release), NULL if the handle is out of range
+pthread_rwlock_t * File_Lock_Take (LcFHandle fh, int exclusive, size_t len) {
+    pthread_rwlock_t *lock = NULL;
+
+    pthread_once(&File_Lock_Once, File_Lock_Init);
+    if (fh >= 0 && fh < 2000) {
+        lock = &File_Lock[fh];
+        if (exclusive) {
+            pthread_rwlock_wrlock(lock);
+        }
+        else {
+            pthread_rwlock_rdlock(lock);
+        }
+    }
+    Fs_Enter(fh, exclusive, len);
+    return lock;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : File_Lock_Give
+// Description  : Release what File_Lock_Take took.
+//
+// Inputs       : lock - the file's lock (may be NULL)
+// Outputs      : none
+void File_Lock_Give (pthread_rwlock_t *lock) {
+    Fs_Leave();
+    if (lock != NULL) {
+        pthread_rwlock_unlock(lock);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcopen
+// Description  : Open the file for for reading and writing.  The whole name
+//                is kept (to find the file again), so a name too long for
+//                the journal is refused rather than cut short.
+//
+// Inputs       : path - the path/filename of the file to be read
+// Outputs      : file handle if successful test, -1 if failure
+LcFHandle lcopen( const char *path ) {
+    if (path == NULL || path[0] == 0 || strnlen(path, LC_JOURNAL_MAX_NAME) >= LC_JOURNAL_MAX_NAME) {
+        logMessage(LOG_ERROR_LEVEL, " ### ERROR ###: File names must be 1 to %i bytes", LC_JOURNAL_MAX_NAME - 1);
+        return (-1);
+    }
+    Fs_Enter(-1, 1, 0);
+    LcFHandle fh = Lc_Open(path);
+    Fs_Leave();
+    return fh;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcread
+// Description  : Read data from the file at its read/write head
+//
+// Inputs       : fh - the file handle of the file to read from
+//                buf - place to put the data
+//                len - the length of the read
+// Outputs      : number of bytes read, -1 if failure
+int lcread( LcFHandle fh, char *buf, size_t len ) {
+    pthread_rwlock_t *lock;
+    int status = -1;
+
+    if (fh < 1 || fh >= 2000) {
+        return (-1);
+    }
+    lock = File_Lock_Take(fh, 0, len);
+    if (FILE_HANDLE[fh].Path != 0) {
+        status = Lc_Read(fh, buf, len);
+    }
+    File_Lock_Give(lock);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcwrite
+// Description  : Write data to the file at its read/write head
+//
+// Inputs       : fh - the file handle of the file to write to
+//                buf - pointer to data to write
+//                len - the length of the write
+// Outputs      : number of bytes written if successful test, -1 if failure
+int lcwrite( LcFHandle fh, char *buf, size_t len ) {
+    pthread_rwlock_t *lock;
+    int status = -1;
+
+    if (fh < 1 || fh >= 2000) {
+        return (-1);
+    }
+    lock = File_Lock_Take(fh, 1, len);
+    if (FILE_HANDLE[fh].Path != 0) {
+        status = Lc_Write(fh, buf, len);
+    }
+    File_Lock_Give(lock);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcseek
+// Description  : Seek to a specific place in the file
+//
+// Inputs       : fh - the file handle of the file to seek in
+//                off - offset within the file to seek to
+// Outputs      : position if successful test, -1 if failure
+int lcseek( LcFHandle fh, size_t off ) {
+    pthread_rwlock_t *lock;
+    int status = -1;
+
+    if (fh < 1 || fh >= 2000) {
+        return (-1);
+    }
+    lock = File_Lock_Take(fh, 1, 0);
+    if (FILE_HANDLE[fh].Path != 0) {
+        status = Lc_Seek(fh, off);
+    }
+    File_Lock_Give(lock);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcclose
+// Description  : Close the file
+//
+// Inputs       : fh - the file handle of the file to close
+// Outputs      : 0 if successful test, -1 if failure
+int lcclose( LcFHandle fh ) {
+    pthread_rwlock_t *lock;
+    int status = -1;
+
+    if (fh < 1 || fh >= 2000) {
+        return (-1);
+    }
+    lock = File_Lock_Take(fh, 1, 0);
+    if (FILE_HANDLE[fh].Path != 0) {
+        status = Lc_Close(fh);
+    }
+    File_Lock_Give(lock);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcshutdown
+// Description  : Shut down the filesystem
+//
+// Inputs       : none
+// Outputs      : 0 if successful test, -1 if failure
+int lcshutdown( void ) {
+    Fs_Enter(-1, 1, 0);
+    int status = Lc_Shutdown();
+    Fs_Leave();
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcpread
+// Description  : Read data from a given place in the file, leaving its
+//                read/write head alone.  Readers of one file share its lock
+//                and only take the filesystem for one block at a time, so
+//                several threads can read a file together.
+//
+// Inputs       : fh - the file handle of the file to read from
+//                buf - place to put the data
+//                len - the length of the read
+//                off - where in the file to start
+// Outputs      : number of bytes read (less at the end of the file), -1 if failure
+int lcpread( LcFHandle fh, char *buf, size_t len, size_t off ) {
+    char block[256];
+    size_t done = 0;
+    pthread_rwlock_t *lock;
+
+    if (fh < 1 || fh >= 2000) {
+        return (-1);
+    }
+    lock = File_Lock_Take(fh, 0, 0);
+    if (FILE_HANDLE[fh].Path == 0) {
+        File_Lock_Give(lock);
+        logMessage(LOG_ERROR_LEVEL, "          ### ERROR-404: File hande NON-EXESTANCE");
+        return (-1);
+    }
+    Cache_Stats_Tick();
+    len = (off >= (size_t)FILE_HANDLE[fh].length) ? 0 : (off + len > (size_t)FILE_HANDLE[fh].length) ? FILE_HANDLE[fh].length - off : len;
+    Fs_Leave();
+
+    // One block at a time, copying out of it after the filesystem is let go
+    // (a whole block is read straight into buf).
+    while (done < len) {
+        size_t pos = off + done;
+        size_t chunk = 256 - pos % 256;
+        if (chunk > len - done) {
+            chunk = len - done;
+        }
+        Fs_Enter(fh, 0, chunk);
+        int status = Read_File_Block(fh, pos / 256, (chunk == 256) ? buf + done : block);
+        Fs_Leave();
+        if (status != 0) {
+            pthread_rwlock_unlock(lock);
+            return (-1);
+        }
+        if (chunk < 256) {
+            memcpy(buf + done, block + pos % 256, chunk);
+        }
+        done += chunk;
+    }
+
+    pthread_rwlock_unlock(lock);
+    return (int)done;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcpwrite
+// Description  : Write data at a given place in the file, leaving its
+//                read/write head alone.
+//
+// Inputs       : fh - the file handle of the file to write to
+//                buf - pointer to data to write
+//                len - the length of the write
+//                off - where in the file to start (at most its length)
+// Outputs      : number of bytes written if successful, -1 if failure
+int lcpwrite( LcFHandle fh, char *buf, size_t len, size_t off ) {
+    pthread_rwlock_t *lock;
+    int head, status = -1;
+
+    if (fh < 1 || fh >= 2000) {
+        return (-1);
+    }
+    lock = File_Lock_Take(fh, 1, len);
+    if (FILE_HANDLE[fh].Path != 0 && off <= (size_t)FILE_HANDLE[fh].length) {
+        head = FILE_HANDLE[fh].position;
+        FILE_HANDLE[fh].position = off;
+        status = (len == 0) ? 0 : Lc_Write(fh, buf, len);
+        FILE_HANDLE[fh].position = head;
+    }
+    File_Lock_Give(lock);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcpread_blocks
+// Description  : Read whole blocks of a file, leaving its read/write head
+//                alone.  The blocks not cached are fetched over the bus a
+//                batch at a time (one round trip each, see Read_Batch) and
+//                each is read straight into buf, with no copy between.
+//
+// Inputs       : fh - the file handle of the file to read from
+//                buf - place to put the data (count blocks of it)
+//                block - the first block within the file
+//                count - how many blocks
+// Outputs      : number of bytes read (less at the end of the file), -1 if failure
+int lcpread_blocks( LcFHandle fh, char *buf, size_t block, int count ) {
+    int Blocks[LC_CACHE_MINBLOCKS / 2];
+    char last[256];
+    pthread_rwlock_t *lock;
+    size_t off = block * 256, len;
+    int status = -1, failed = 0;
+
+    if (fh < 1 || fh >= 2000 || count < 0) {
+        return (-1);
+    }
+    lock = File_Lock_Take(fh, 0, (size_t)count * 256);
+    if (FILE_HANDLE[fh].Path != 0) {
+        Cache_Stats_Tick();
+        len = (off >= (size_t)FILE_HANDLE[fh].length) ? 0 :
+              (off + (size_t)count * 256 > (size_t)FILE_HANDLE[fh].length) ? FILE_HANDLE[fh].length - off : (size_t)count * 256;
+
+        // A round is half the smallest cache, so it is still cached when it is read.
+        for (size_t first = 0; first * 256 < len; first += LC_CACHE_MINBLOCKS / 2) {
+            int round = 0;
+            for (; round < LC_CACHE_MINBLOCKS / 2 && (first + round) * 256 < len; round++) {
+                Blocks[round] = block + first + round;
+            }
+            Read_Batch(fh, Blocks, round);
+            for (int k = 0; k < round; k++) {
+                size_t at = (first + k) * 256;
+
+                // Only the part of the last block inside the file is copied out.
+                if (at + 256 > len) {
+                    if (Read_File_Block(fh, Blocks[k], last) != 0) {
+                        failed = 1;
+                    }
+                    memcpy(buf + at, last, len - at);
+                }
+                else if (Read_File_Block(fh, Blocks[k], buf + at) != 0) {
+                    failed = 1;
+                }
+            }
+        }
+        status = (failed == 0) ? (int)len : -1;
+    }
+    File_Lock_Give(lock);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcpwrite_blocks
+// Description  : Write whole blocks of a file, leaving its read/write head
+//                alone.  Every block is replaced, so none is read back, and
+//                without the write buffer they go out together (see
+//                Lc_Writev).
+//
+// Inputs       : fh - the file handle of the file to write to
+//                buf - the data (count blocks of it)
+//                block - the first block within the file (at most its length)
+//                count - how many blocks
+// Outputs      : number of bytes written if successful, -1 if failure
+int lcpwrite_blocks( LcFHandle fh, char *buf, size_t block, int count ) {
+    LcIoVec seg = { buf, (size_t)count * 256, block * 256 };
+    pthread_rwlock_t *lock;
+    int head, status = -1;
+
+    if (fh < 1 || fh >= 2000 || count < 0) {
+        return (-1);
+    }
+    lock = File_Lock_Take(fh, 1, seg.len);
+    if (FILE_HANDLE[fh].Path != 0 && seg.off <= (size_t)FILE_HANDLE[fh].length) {
+        head = FILE_HANDLE[fh].position;
+        status = (count == 0) ? 0 : Lc_Writev(fh, &seg, 1);
+        FILE_HANDLE[fh].position = head;
+    }
+    File_Lock_Give(lock);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcreadv
+// Description  : Read many segments of a file (see Lc_Readv).  The read/write
+//                head ends after the last segment.
+//
+// Inputs       : fh - the file handle of the file to read from
+//                iov - the segments, count - how many
+// Outputs      : number of bytes read, -1 if failure
+int lcreadv( LcFHandle fh, const LcIoVec *iov, int count ) {
+    pthread_rwlock_t *lock;
+    size_t len = 0;
+    int status = -1;
+
+    if (fh < 1 || fh >= 2000 || count < 0) {
+        return (-1);
+    }
+    for (int i = 0; i < count; i++) {
+        len += iov[i].len;
+    }
+    lock = File_Lock_Take(fh, 0, len);
+    if (FILE_HANDLE[fh].Path != 0) {
+        status = (count == 0) ? 0 : Lc_Readv(fh, iov, count);
+    }
+    File_Lock_Give(lock);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcwritev
+// Description  : Write many segments of a file (see Lc_Writev).  The
+//                read/write head ends after the last segment.
+//
+// Inputs       : fh - the file handle of the file to write to
+//                iov - the segments, count - how many
+// Outputs      : number of bytes written if successful, -1 if failure
+int lcwritev( LcFHandle fh, const LcIoVec *iov, int count ) {
+    pthread_rwlock_t *lock;
+    size_t len = 0;
+    int status = -1;
+
+    if (fh < 1 || fh >= 2000 || count < 0) {
+        return (-1);
+    }
+    for (int i = 0; i < count; i++) {
+        len += iov[i].len;
+    }
+    lock = File_Lock_Take(fh, 1, len);
+    if (FILE_HANDLE[fh].Path != 0) {
+        status = (count == 0) ? 0 : Lc_Writev(fh, iov, count);
+    }
+    File_Lock_Give(lock);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcpriority
+// Description  : Make a file's calls foreground (reads ahead of writes) or
+//                background work, let in only when the foreground is idle
+//                (or has been let in LC_SCHED_PASS times while it waited).
+//                Among the busy files of its class it gets a share of the
+//                blocks moved in proportion to its weight.  It holds until
+//                changed.
+//
+// Inputs       : fh - the file handle
+//                prio - LC_PRIO_FOREGROUND or LC_PRIO_BACKGROUND
+//                weight - its share, 1 to LC_PRIO_WEIGHT_MAX
+// Outputs      : 0 if successful, -1 if failure
+int lcpriority( LcFHandle fh, int prio, int weight ) {
+    if (fh < 1 || fh >= 2000 || (prio != LC_PRIO_FOREGROUND && prio != LC_PRIO_BACKGROUND) ||
+        weight < 1 || weight > LC_PRIO_WEIGHT_MAX) {
+        return (-1);
+    }
+    pthread_once(&File_Lock_Once, File_Lock_Init);
+    pthread_rwlock_wrlock(&File_Lock[fh]);
+    FILE_HANDLE[fh].Background = (prio == LC_PRIO_BACKGROUND) ? 1 : 0;
+    FILE_HANDLE[fh].Weight = (int8_t)weight;
+    pthread_rwlock_unlock(&File_Lock[fh]);
+    return 0;
+}
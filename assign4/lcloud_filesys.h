@@ -15,15 +15,31 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // Defines 
+#define LC_IOV_HEAD ((size_t)-1)    // A segment offset: just after the segment before it
+#define LC_PRIO_FOREGROUND 0        // A file's calls go in ahead of background work
+#define LC_PRIO_BACKGROUND 1        // A file's calls take the idle time
+#define LC_PRIO_WEIGHT_MAX 16       // The largest share of a file among those of its class
 
 // Type definitions
 typedef int32_t LcFHandle;
 
+// One segment of a vectored read or write
+typedef struct {
+    char *base;     // The data
+    size_t len;     // Its length
+    size_t off;     // Where in the file (LC_IOV_HEAD to follow the segment
+                    // before it, or the read/write head for the first)
+} LcIoVec;
+
 // File system interface definitions
 
 LcFHandle lcopen( const char *path );
-    // Open the file for for reading and writing
+    // Open the file for for reading and writing (the name is at most LC_JOURNAL_MAX_NAME-1 bytes)
 
 int lcread( LcFHandle fh, char *buf, size_t len );
     // Read data from the file hande
@@ -40,4 +56,29 @@ int lcclose( LcFHandle fh );
 int lcshutdown( void );
     // Shut down the filesystem
 
+int lcpread( LcFHandle fh, char *buf, size_t len, size_t off );
+    // Read data from a place in the file (the read/write head does not move)
+
+int lcpwrite( LcFHandle fh, char *buf, size_t len, size_t off );
+    // Write data at a place in the file (the read/write head does not move)
+
+int lcpread_blocks( LcFHandle fh, char *buf, size_t block, int count );
+    // Read whole blocks, fetched together and straight into buf (the head does not move)
+
+int lcpwrite_blocks( LcFHandle fh, char *buf, size_t block, int count );
+    // Write whole blocks, none read back and sent together (the head does not move)
+
+int lcreadv( LcFHandle fh, const LcIoVec *iov, int count );
+    // Read many segments, the blocks they touch fetched together
+
+int lcwritev( LcFHandle fh, const LcIoVec *iov, int count );
+    // Write many segments, the blocks they touch sent together
+
+int lcpriority( LcFHandle fh, int prio, int weight );
+    // Make a file's calls foreground or background work, with a share of its class (1 to LC_PRIO_WEIGHT_MAX)
+
+#ifdef __cplusplus
+}
+#endif
+
 #endif
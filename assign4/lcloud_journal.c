@@ -0,0 +1,576 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_journal.c
+//  Description    : This is the implementation of the metadata journal for
+//                   the Lion Cloud filesystem.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <cmpsc311_log.h>
+
+// Project include files
+#include <lcloud_journal.h>
+#include <lcloud_controller.h>
+#include <lcloud_xfer.h>
+
+// Information
+//
+// The metadata region is the first LC_JOURNAL_REGION_BLOCKS blocks (counted
+// sector by sector) of one device:
+//
+//   block 0                      - the superblock
+//   blocks 1 .. LOG_BLOCKS       - log half 0
+//   blocks LOG_BLOCKS+1 .. end   - log half 1
+//
+// Only one half is live at a time.  Records are appended to the live half and
+// written out in group commits.  When the half fills, a checkpoint writes the
+// complete state into the other half and then flips the superblock to it, so
+// a crash at any point leaves one consistent half.  Every log block carries
+// the generation of its checkpoint, which is how stale blocks left over from
+// an earlier use of a half are told apart on replay.
+//
+
+// Defines
+#define LC_JOURNAL_HEADER 16    // Bytes of header in each log block
+#define LC_JOURNAL_PAYLOAD (LC_DEVICE_BLOCK_SIZE - LC_JOURNAL_HEADER) // Record bytes per block
+
+// The state of the mounted journal
+static struct Journal_State {
+    int Open;               // If the region is mounted
+    LcDeviceId Device;      // The device holding the region
+    uint16_t Sectors;       // Geometry of that device
+    uint16_t Blocks;
+
+    uint32_t Generation;    // The checkpoint generation of the live half
+    uint8_t Half;           // The live half (0 or 1)
+    int Cursor;             // Block within the live half being filled
+    int Checkpointing;      // Set while a checkpoint is being written
+
+    char Buffer[LC_DEVICE_BLOCK_SIZE];  // The block being filled
+    int Used;               // Bytes of records in the buffer
+    int Dirty;              // If the buffer has not been written
+    int Pending;            // Records since the last group commit
+
+    LcJournalApply Apply;       // Replay callback
+    LcJournalSnapshot Snapshot; // Checkpoint callback
+    LcJournalBarrier Barrier;   // Data-before-metadata callback (NULL if none)
+} Journal;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : journal_checksum
+// Description  : A FNV-1a hash used to detect torn or stale blocks.
+//
+// Inputs       : buf - the bytes to hash, len - the number of bytes
+// Outputs      : the 32-bit checksum
+static uint32_t journal_checksum( const char *buf, int len ) {
+    uint32_t hash = 2166136261u;
+    for (int i = 0; i < len; i++) {
+        hash ^= (uint8_t)buf[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : journal_xfer
+// Description  : Move one block of the region to or from the device.  This
+//                goes straight to the bus so metadata never enters the cache.
+//
+// Inputs       : op - LC_XFER_READ or LC_XFER_WRITE
+//                index - the block number within the region
+//                buf - the 256 byte block
+// Outputs      : 0 if successful, -1 if failure
+static int journal_xfer( int op, int index, char *buf ) {
+
+    // Lay the region out sector by sector
+    if (lcloud_xfer_block(Journal.Device, index / Journal.Blocks, index % Journal.Blocks, op, buf) != 0) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Journal: transfer of region block %i failed", index);
+        return -1;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : journal_write_super
+// Description  : Write the superblock describing the live half.
+//
+// Inputs       : clean - 1 if the filesystem was shut down cleanly
+// Outputs      : 0 if successful, -1 if failure
+static int journal_write_super( int clean ) {
+    char sb[LC_DEVICE_BLOCK_SIZE];
+    uint32_t magic = LC_JOURNAL_MAGIC, version = LC_JOURNAL_VERSION, sum;
+    uint16_t logblocks = LC_JOURNAL_LOG_BLOCKS;
+
+    memset(sb, 0, sizeof(sb));
+    memcpy(sb + 0, &magic, 4);
+    memcpy(sb + 4, &version, 4);
+    memcpy(sb + 8, &Journal.Generation, 4);
+    sb[12] = Journal.Half;
+    sb[13] = (char)clean;
+    memcpy(sb + 14, &logblocks, 2);
+    memcpy(sb + 16, &Journal.Sectors, 2);
+    memcpy(sb + 18, &Journal.Blocks, 2);
+    sum = journal_checksum(sb, 20);
+    memcpy(sb + 20, &sum, 4);
+
+    return journal_xfer(LC_XFER_WRITE, 0, sb);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : journal_flush_block
+// Description  : Write the block being filled to its place in the live half.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+static int journal_flush_block( void ) {
+    uint32_t magic = LC_JOURNAL_MAGIC, sum;
+    uint16_t seq = Journal.Cursor, used = Journal.Used;
+
+    memcpy(Journal.Buffer + 0, &magic, 4);
+    memcpy(Journal.Buffer + 4, &Journal.Generation, 4);
+    memcpy(Journal.Buffer + 8, &seq, 2);
+    memcpy(Journal.Buffer + 10, &used, 2);
+    sum = journal_checksum(Journal.Buffer + LC_JOURNAL_HEADER, Journal.Used);
+    memcpy(Journal.Buffer + 12, &sum, 4);
+
+    // The blocks the records point at go first, or a crash could replay
+    // a map to a block that was never written
+    if (Journal.Barrier != NULL && Journal.Barrier() != 0) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Journal: data could not be written ahead of its records");
+        return -1;
+    }
+    if (journal_xfer(LC_XFER_WRITE, 1 + Journal.Half * LC_JOURNAL_LOG_BLOCKS + Journal.Cursor, Journal.Buffer) != 0) {
+        return -1;
+    }
+    Journal.Dirty = 0;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : journal_encode / journal_decode
+// Description  : Convert a record to and from its packed form:
+//                [type][payload length][payload].
+//
+// Inputs       : rec - the record, out/in - the packed bytes
+// Outputs      : the packed size, or the bytes consumed (0 at the end)
+static int journal_encode( const LcJournalRecord *rec, char *out ) {
+    int len = 0;
+    char *p = out + 2;
+
+    switch (rec->type) {
+    case LC_JREC_FILE:
+        memcpy(p, &rec->fh, 2);
+        len = strnlen(rec->name, LC_JOURNAL_MAX_NAME - 1);
+        memcpy(p + 2, rec->name, len);
+        len += 2;
+        break;
+    case LC_JREC_MAP:
+        memcpy(p, &rec->fh, 2);
+        memcpy(p + 2, &rec->file_block, 2);
+        memcpy(p + 4, &rec->count, 2);
+        p[6] = rec->device;
+        memcpy(p + 7, &rec->sector, 2);
+        memcpy(p + 9, &rec->block, 2);
+        len = 11;
+        break;
+    case LC_JREC_LENGTH:
+        memcpy(p, &rec->fh, 2);
+        memcpy(p + 2, &rec->length, 4);
+        len = 6;
+        break;
+    case LC_JREC_PACK:
+        memcpy(p, &rec->fh, 2);
+        memcpy(p + 2, &rec->file_block, 2);
+        p[4] = rec->device;
+        memcpy(p + 5, &rec->sector, 2);
+        memcpy(p + 7, &rec->block, 2);
+        p[9] = rec->slot;
+        memcpy(p + 10, &rec->clen, 2);
+        len = 12;
+        break;
+    case LC_JREC_CRC:
+        if (rec->count == 0 || rec->count > LC_JOURNAL_CRC_RUN) {
+            return -1;
+        }
+        memcpy(p, &rec->fh, 2);
+        memcpy(p + 2, &rec->file_block, 2);
+        p[4] = (char)rec->count;
+        memcpy(p + 5, rec->crc, rec->count * 4);
+        len = 5 + rec->count * 4;
+        break;
+    default:
+        return -1;
+    }
+    out[0] = rec->type;
+    out[1] = (char)len;
+    return len + 2;
+}
+
+static int journal_decode( const char *in, int avail, LcJournalRecord *rec ) {
+    if (avail < 2 || in[0] == LC_JREC_END) {
+        return 0;
+    }
+    int len = (uint8_t)in[1];
+    const char *p = in + 2;
+    if (len + 2 > avail) {
+        return 0;
+    }
+
+    memset(rec, 0, sizeof(LcJournalRecord));
+    rec->type = in[0];
+    switch (rec->type) {
+    case LC_JREC_FILE:
+        memcpy(&rec->fh, p, 2);
+        memcpy(rec->name, p + 2, len - 2);
+        break;
+    case LC_JREC_MAP:
+        memcpy(&rec->fh, p, 2);
+        memcpy(&rec->file_block, p + 2, 2);
+        memcpy(&rec->count, p + 4, 2);
+        rec->device = p[6];
+        memcpy(&rec->sector, p + 7, 2);
+        memcpy(&rec->block, p + 9, 2);
+        break;
+    case LC_JREC_LENGTH:
+        memcpy(&rec->fh, p, 2);
+        memcpy(&rec->length, p + 2, 4);
+        break;
+    case LC_JREC_PACK:
+        memcpy(&rec->fh, p, 2);
+        memcpy(&rec->file_block, p + 2, 2);
+        rec->device = p[4];
+        memcpy(&rec->sector, p + 5, 2);
+        memcpy(&rec->block, p + 7, 2);
+        rec->slot = p[9];
+        memcpy(&rec->clen, p + 10, 2);
+        break;
+    case LC_JREC_CRC:
+        memcpy(&rec->fh, p, 2);
+        memcpy(&rec->file_block, p + 2, 2);
+        rec->count = (uint8_t)p[4];
+        if (rec->count == 0 || rec->count > LC_JOURNAL_CRC_RUN || len != 5 + rec->count * 4) {
+            return 0;
+        }
+        memcpy(rec->crc, p + 5, rec->count * 4);
+        break;
+    default:
+        return 0;
+    }
+    return len + 2;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : journal_checkpoint
+// Description  : Write the full state into the other half, then switch the
+//                superblock over to it.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+static int journal_checkpoint( void ) {
+
+    // A snapshot that does not fit in a half can not be checkpointed
+    if (Journal.Checkpointing) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Journal: checkpoint does not fit in %i blocks", LC_JOURNAL_LOG_BLOCKS);
+        return -1;
+    }
+    Journal.Checkpointing = 1;
+
+    // Start the new generation in the other half
+    Journal.Generation++;
+    Journal.Half ^= 1;
+    Journal.Cursor = 0;
+    Journal.Used = 0;
+    Journal.Dirty = 0;
+    Journal.Pending = 0;
+    memset(Journal.Buffer, 0, sizeof(Journal.Buffer));
+
+    // The new half must be on the device before the superblock points at it
+    int status = Journal.Snapshot();
+    if (status == 0) {
+        status = lcloud_journal_commit();
+    }
+    if (status == 0) {
+        status = journal_write_super(0);
+    }
+    Journal.Checkpointing = 0;
+
+    // The superblock still names the old half, so stop logging rather than corrupt it
+    if (status != 0) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Journal: checkpoint failed, metadata is no longer being persisted");
+        Journal.Open = 0;
+        return -1;
+    }
+
+    logMessage(LOG_INFO_LEVEL, "           ### Journal: checkpoint generation %u in half %i (%i blocks)",
+        Journal.Generation, Journal.Half, Journal.Cursor + 1);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : journal_replay
+// Description  : Read back the live half, applying each record in order.
+//
+// Inputs       : none
+// Outputs      : the number of records replayed
+static int journal_replay( void ) {
+    char blk[LC_DEVICE_BLOCK_SIZE];
+    LcJournalRecord rec;
+    int records = 0;
+
+    Journal.Cursor = 0;
+    Journal.Used = 0;
+    memset(Journal.Buffer, 0, sizeof(Journal.Buffer));
+
+    for (int i = 0; i < LC_JOURNAL_LOG_BLOCKS; i++) {
+        uint32_t magic, generation, sum;
+        uint16_t seq, used;
+
+        if (journal_xfer(LC_XFER_READ, 1 + Journal.Half * LC_JOURNAL_LOG_BLOCKS + i, blk) != 0) {
+            break;
+        }
+        memcpy(&magic, blk + 0, 4);
+        memcpy(&generation, blk + 4, 4);
+        memcpy(&seq, blk + 8, 2);
+        memcpy(&used, blk + 10, 2);
+        memcpy(&sum, blk + 12, 4);
+
+        // The end of the log is the first block not written in this generation
+        if (magic != LC_JOURNAL_MAGIC || generation != Journal.Generation || seq != i ||
+            used > LC_JOURNAL_PAYLOAD || sum != journal_checksum(blk + LC_JOURNAL_HEADER, used)) {
+            break;
+        }
+
+        for (int off = 0, n; (n = journal_decode(blk + LC_JOURNAL_HEADER + off, used - off, &rec)) > 0; off += n) {
+            Journal.Apply(&rec);
+            records++;
+        }
+
+        // Appending continues in the last good block
+        Journal.Cursor = i;
+        Journal.Used = used;
+        memcpy(Journal.Buffer, blk, sizeof(blk));
+    }
+
+    logMessage(LOG_INFO_LEVEL, "           ### Journal: replayed %i records from %i blocks", records, Journal.Cursor + 1);
+    return records;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_journal_open
+// Description  : Mount the metadata region, replaying the log if the device
+//                already holds one, or formatting a new one if not.
+//
+// Inputs       : did - the device to hold the region
+//                sectors, blocks - the geometry of that device
+//                apply - called for each replayed record
+//                snap - called to re-append the whole state at checkpoint
+//                barrier - called before each log block is written (or NULL)
+// Outputs      : number of records replayed if successful, -1 if failure
+int lcloud_journal_open( LcDeviceId did, uint16_t sectors, uint16_t blocks,
+                         LcJournalApply apply, LcJournalSnapshot snap, LcJournalBarrier barrier ) {
+    char sb[LC_DEVICE_BLOCK_SIZE];
+    uint32_t magic, version, generation, sum;
+    uint16_t logblocks, sbsectors, sbblocks;
+    int records = 0;
+
+    // Make sure the region fits on the device
+    if ((int)sectors * blocks < LC_JOURNAL_REGION_BLOCKS) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Journal: device %i is too small for the metadata region", did);
+        return -1;
+    }
+
+    memset(&Journal, 0, sizeof(Journal));
+    Journal.Device = did;
+    Journal.Sectors = sectors;
+    Journal.Blocks = blocks;
+    Journal.Apply = apply;
+    Journal.Snapshot = snap;
+    Journal.Barrier = barrier;
+
+    if (journal_xfer(LC_XFER_READ, 0, sb) != 0) {
+        return -1;
+    }
+    memcpy(&magic, sb + 0, 4);
+    memcpy(&version, sb + 4, 4);
+    memcpy(&generation, sb + 8, 4);
+    memcpy(&logblocks, sb + 14, 2);
+    memcpy(&sbsectors, sb + 16, 2);
+    memcpy(&sbblocks, sb + 18, 2);
+    memcpy(&sum, sb + 20, 4);
+
+    if (magic == LC_JOURNAL_MAGIC && version == LC_JOURNAL_VERSION && sum == journal_checksum(sb, 20) &&
+        logblocks == LC_JOURNAL_LOG_BLOCKS && sbsectors == sectors && sbblocks == blocks) {
+
+        // Recover the file maps from the live half
+        Journal.Generation = generation;
+        Journal.Half = sb[12] & 1;
+        logMessage(LOG_INFO_LEVEL, "           ### Journal: mounting generation %u (%s shutdown)",
+            generation, sb[13] ? "clean" : "unclean");
+        records = journal_replay();
+        Journal.Open = 1;
+
+        // Keep the next cold start short
+        if (Journal.Cursor >= LC_JOURNAL_LOG_BLOCKS / 2 && journal_checkpoint() != 0) {
+            return -1;
+        }
+    }
+    else {
+
+        // No usable region, start a fresh one (the generation must not match stale
+        // blocks, and names the devices' state, so two formats never share one)
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        uint32_t fresh = ((uint32_t)now.tv_sec * 2654435761u) ^ (uint32_t)now.tv_nsec ^ ((uint32_t)getpid() << 16);
+        logMessage(LOG_INFO_LEVEL, "           ### Journal: formatting metadata region on device %i", did);
+        Journal.Generation = (fresh == 0 || (magic == LC_JOURNAL_MAGIC && fresh == generation)) ? generation + 1 : fresh;
+        Journal.Half = 0;
+        Journal.Open = 1;
+    }
+
+    // The region is in use until lcloud_journal_close marks it clean
+    if (journal_write_super(0) != 0) {
+        Journal.Open = 0;
+        return -1;
+    }
+    return records;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_journal_append
+// Description  : Add a record to the current group commit, moving on to the
+//                next block (or checkpointing) when the current one is full.
+//
+// Inputs       : rec - the record to log
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_journal_append( const LcJournalRecord *rec ) {
+    char packed[LC_JOURNAL_PAYLOAD];
+    int len;
+
+    if (!Journal.Open) {
+        return -1;
+    }
+    if ((len = journal_encode(rec, packed)) < 0) {
+        return -1;
+    }
+
+    // Block is full, write it and move on
+    if (Journal.Used + len > LC_JOURNAL_PAYLOAD) {
+        if (Journal.Dirty && journal_flush_block() != 0) {
+            return -1;
+        }
+        Journal.Cursor++;
+        Journal.Used = 0;
+        memset(Journal.Buffer, 0, sizeof(Journal.Buffer));
+    }
+
+    // Half is full, compact into the other half.  The snapshot can leave the
+    // new block almost full, so start over to find room for the record.  If
+    // the snapshot took the whole half there is no room; compacting again
+    // would only do the same, so logging stops (the caller fails).
+    if (Journal.Cursor >= LC_JOURNAL_LOG_BLOCKS) {
+        if (journal_checkpoint() != 0) {
+            return -1;
+        }
+        if (Journal.Cursor >= LC_JOURNAL_LOG_BLOCKS - 1 && Journal.Used + len > LC_JOURNAL_PAYLOAD) {
+            logMessage(LOG_ERROR_LEVEL, "           ### Journal: checkpoint fills all %i blocks, metadata is no longer being persisted", LC_JOURNAL_LOG_BLOCKS);
+            Journal.Open = 0;
+            return -1;
+        }
+        return lcloud_journal_append(rec);
+    }
+
+    memcpy(Journal.Buffer + LC_JOURNAL_HEADER + Journal.Used, packed, len);
+    Journal.Used += len;
+    Journal.Dirty = 1;
+
+    // Force a group commit once enough records are waiting
+    if (++Journal.Pending >= LC_JOURNAL_GROUP_RECORDS) {
+        return lcloud_journal_commit();
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_journal_commit
+// Description  : Write the pending group of records to the device.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_journal_commit( void ) {
+    if (!Journal.Open) {
+        return -1;
+    }
+    Journal.Pending = 0;
+    if (Journal.Dirty) {
+        return journal_flush_block();
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_journal_close
+// Description  : Commit the last records and mark the region clean.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_journal_close( void ) {
+    if (!Journal.Open) {
+        return -1;
+    }
+    if (lcloud_journal_commit() != 0) {
+        return -1;
+    }
+
+    // Compact now rather than on the next power on
+    if (Journal.Cursor >= LC_JOURNAL_LOG_BLOCKS / 2 && journal_checkpoint() != 0) {
+        return -1;
+    }
+
+    int status = journal_write_super(1);
+    Journal.Open = 0;
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_journal_reserved
+// Description  : Check if a physical block belongs to the metadata region.
+//
+// Inputs       : did, sec, blk - the physical block
+// Outputs      : 1 if reserved, 0 if not
+int lcloud_journal_reserved( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    return Journal.Open && did == Journal.Device &&
+           (int)sec * Journal.Blocks + blk < LC_JOURNAL_REGION_BLOCKS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_journal_generation
+// Description  : Name the state of the devices, for caches kept between
+//                runs.  The generation is stored in the superblock, so it is
+//                the same at the next mount as at close, and a freshly
+//                formatted region gets a new one.
+//
+// Inputs       : none
+// Outputs      : the generation, 0 if the journal was never mounted
+uint32_t lcloud_journal_generation( void ) {
+    return Journal.Generation;
+}
@@ -0,0 +1,88 @@
+#ifndef LCLOUD_JOURNAL_INCLUDED
+#define LCLOUD_JOURNAL_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_journal.h
+//  Description    : This is the metadata journal API for the Lion Cloud
+//                   filesystem.  The file maps and block allocations are
+//                   logged to a reserved region of one device so that they
+//                   survive lcshutdown and are recovered at power on.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+#include <lcloud_controller.h>
+
+// Defines
+#define LC_JOURNAL_MAGIC 0x4c434a4e     // "LCJN", marks the superblock and every log block
+#define LC_JOURNAL_VERSION 1            // On-device format version
+#define LC_JOURNAL_LOG_BLOCKS 128       // Blocks in each half of the log (ping-ponged on checkpoint)
+#define LC_JOURNAL_REGION_BLOCKS (1 + 2 * LC_JOURNAL_LOG_BLOCKS) // Superblock + both log halves
+#define LC_JOURNAL_GROUP_RECORDS 32     // Records batched before a group commit is forced
+#define LC_JOURNAL_MAX_NAME 64          // Longest file name kept in the metadata
+#define LC_JOURNAL_CRC_RUN 16           // Most block checksums in one record
+
+// The types of records held in the log
+typedef enum {
+    LC_JREC_END    = 0,  // No more records in this block
+    LC_JREC_FILE   = 1,  // A file was created (handle, name)
+    LC_JREC_MAP    = 2,  // A run of file blocks was placed (handle, file block, count, device, sector, block)
+    LC_JREC_LENGTH = 3,  // The length of a file changed (handle, length)
+                         // (4 is not used, replaying a MAP or PACK frees the block's old place)
+    LC_JREC_PACK   = 5,  // A file block was packed into slots (handle, file block, device, sector, block, slot, length)
+    LC_JREC_CRC    = 6,  // The checksums of a run of file blocks (handle, file block, count, CRC32C each)
+    LC_JREC_MAXVAL = 7   // Unused MAX value
+} LcJournalRecType;
+
+// One decoded journal record (only the fields for its type are used)
+typedef struct {
+    uint8_t  type;                      // LcJournalRecType
+    uint16_t fh;                        // File handle the record is about
+    uint16_t file_block;                // Block index within the file
+    uint16_t count;                     // Blocks in the run (consecutive on the device)
+    uint32_t length;                    // New file length
+    uint8_t  device;                    // Physical device
+    uint16_t sector;                    // Physical sector
+    uint16_t block;                     // Physical block
+    uint8_t  slot;                      // First slot of a packed block
+    uint16_t clen;                      // Compressed length of a packed block
+    uint32_t crc[LC_JOURNAL_CRC_RUN];   // Block checksums (count of them)
+    char     name[LC_JOURNAL_MAX_NAME]; // File name (NUL terminated)
+} LcJournalRecord;
+
+// Called for every record found during replay
+typedef void (*LcJournalApply)( const LcJournalRecord *rec );
+
+// Called at checkpoint time, must re-append the complete in-memory state
+typedef int (*LcJournalSnapshot)( void );
+
+// Called before records go to the device, must first write the data they point at
+typedef int (*LcJournalBarrier)( void );
+
+//
+// Functional Prototypes
+
+int lcloud_journal_open( LcDeviceId did, uint16_t sectors, uint16_t blocks,
+                         LcJournalApply apply, LcJournalSnapshot snap, LcJournalBarrier barrier );
+    // Mount (replay) or format the metadata region on the device
+
+int lcloud_journal_append( const LcJournalRecord *rec );
+    // Add a record to the current group commit
+
+int lcloud_journal_commit( void );
+    // Write the pending group of records to the device
+
+int lcloud_journal_close( void );
+    // Commit, checkpoint if the log is long, and mark the region clean
+
+int lcloud_journal_reserved( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Check if a physical block belongs to the metadata region
+
+uint32_t lcloud_journal_generation( void );
+    // The generation of the region (names the devices' state between runs)
+
+#endif
@@ -0,0 +1,490 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_journal_test.c
+//  Description    : This is the test of the metadata journal (lcloud_journal)
+//                   on the fake bus (lcloud_fakebus.c).  Files written and
+//                   then lost in a crash (the devices kept, no lcshutdown)
+//                   must come back from the journal as far as it got, the
+//                   closed ones whole (in each layout: blocks in place, the
+//                   log, and dedup with compression), blocks shared by
+//                   dedup must keep their references over a crash, a
+//                   journal too full to checkpoint must
+//                   fail the call that filled it, and file names must be
+//                   kept whole or refused.  Each test runs in a process of
+//                   its own, so a crash is a real exit:
+//
+//                     make lcloud_journal_test && ./lcloud_journal_test
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+// Project include files
+#include <cmpsc311_log.h>
+#include <lcloud_filesys.h>
+#include <lcloud_journal.h>
+#include <lcloud_fakebus.h>
+
+// Defines
+#define TEST_FILES 4                    // Files written before the crash
+#define TEST_FILE_SIZE (40 * 256 + 100) // Bytes in each (blocks and a part)
+#define TEST_FULL_FILES 1000            // Most files made to fill the journal
+#define TEST_SHARED_SIZE (20 * 256)     // Bytes in each file sharing blocks
+#define TEST_FILL_BLOCKS 1500           // Blocks in each file filling the devices
+
+// The filesystem's switches (see lcloud_filesys.c)
+extern int Log_Structured_Enabled, Dedup_Enabled, Compress_Enabled, Write_Buffer_Blocks;
+
+// The layouts the crash test runs in
+static const struct {
+    const char *name;
+    int log, dedup, buffer;     // The switches (dedup brings compression)
+} Test_Modes[] = {
+    { "in place", 0, 0, 8 },
+    { "log, write-through", 1, 0, 0 },
+    { "dedup and compression", 0, 1, 8 },
+};
+#define TEST_MODES ((int)(sizeof(Test_Modes) / sizeof(Test_Modes[0])))
+
+// The layout of the test being run (set before it forks)
+static int Test_Mode;
+
+// How the shared blocks test ends before the devices are filled
+static const char *Test_Endings[] = { "no remount", "shutdown", "crash" };
+#define TEST_STAY 0
+#define TEST_CRASH 2
+#define TEST_ENDINGS 3
+
+// The blocks the devices took after each ending (shared with the test
+// processes; the ending is set before they fork)
+static int *Test_Filled;
+static int Test_Ending;
+
+static void test_shared_fill( void );
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_mode
+// Description  : Switch the filesystem to the layout of the test being run
+//                (before its first call mounts it).
+//
+// Inputs       : none
+// Outputs      : none
+static void test_mode( void ) {
+    Log_Structured_Enabled = Test_Modes[Test_Mode].log;
+    Dedup_Enabled = Test_Modes[Test_Mode].dedup;
+    Compress_Enabled = Test_Modes[Test_Mode].dedup;
+    Write_Buffer_Blocks = Test_Modes[Test_Mode].buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_byte
+// Description  : What a byte of a test file holds.
+//
+// Inputs       : file - which file, at - where in it
+// Outputs      : the byte
+static char test_byte( int file, int at ) {
+    return (char)('a' + (at / 256 * 7 + at + file) % 26);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_length
+// Description  : Find the length of an open file (the largest place it can
+//                seek to).
+//
+// Inputs       : fh - the file, most - the longest it can be
+// Outputs      : the length
+static int test_length( LcFHandle fh, int most ) {
+    int low = 0, high = most;
+
+    while (low < high) {
+        int mid = (low + high + 1) / 2;
+        if (lcseek(fh, mid) == mid) {
+            low = mid;
+        }
+        else {
+            high = mid - 1;
+        }
+    }
+    lcseek(fh, 0);
+    return low;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_check
+// Description  : Check that a file holds the test data up to its length.
+//
+// Inputs       : file - which file, length - how much it should hold
+// Outputs      : 0 if it does, -1 if not
+static int test_check( int file, int length ) {
+    static char buf[TEST_FILE_SIZE];
+    char name[16];
+
+    sprintf(name, "file%d", file);
+    LcFHandle fh = lcopen(name);
+    if (fh < 0 || test_length(fh, TEST_FILE_SIZE) != length) {
+        return -1;
+    }
+    if (length > 0 && lcpread(fh, buf, length, 0) != length) {
+        return -1;
+    }
+    for (int at = 0; at < length; at++) {
+        if (buf[at] != test_byte(file, at)) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_crash_write
+// Description  : Write the test files, close half of them, and crash.  The
+//                closed ones go first, so the others have no close after
+//                them (to flush what they left staged).
+//
+// Inputs       : none
+// Outputs      : does not return
+static void test_crash_write( void ) {
+    static char buf[TEST_FILE_SIZE];
+
+    lcloud_fakebus_wipe();
+    test_mode();
+    for (int k = 0; k < TEST_FILES; k++) {
+        int file = (k < TEST_FILES / 2) ? 2 * k : 2 * (k - TEST_FILES / 2) + 1;
+        char name[16];
+        sprintf(name, "file%d", file);
+        for (int at = 0; at < TEST_FILE_SIZE; at++) {
+            buf[at] = test_byte(file, at);
+        }
+        LcFHandle fh = lcopen(name);
+        if (fh < 0 || lcwrite(fh, buf, TEST_FILE_SIZE) != TEST_FILE_SIZE) {
+            _exit(1);
+        }
+        if (file % 2 == 0 && lcclose(fh) != 0) {
+            _exit(1);
+        }
+    }
+    lcloud_fakebus_crash();
+    _exit(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_crash_read
+// Description  : Mount the crashed devices and check the files: the closed
+//                ones whole, the others as far as the journal got.
+//
+// Inputs       : none
+// Outputs      : does not return
+static void test_crash_read( void ) {
+    int status = 0;
+    char name[16];
+
+    test_mode();
+    for (int file = 0; file < TEST_FILES; file++) {
+        int length = TEST_FILE_SIZE;
+        if (file % 2 == 1) {
+            sprintf(name, "file%d", file);
+            LcFHandle fh = lcopen(name);
+            length = (fh < 0) ? -1 : test_length(fh, TEST_FILE_SIZE);
+        }
+        if (length < 0 || test_check(file, length) != 0) {
+            printf("  file%d: wrong after the crash\n", file);
+            status = 1;
+        }
+    }
+
+    // A clean shutdown keeps them as they are now.
+    if (lcshutdown() != 0 || test_check(0, TEST_FILE_SIZE) != 0) {
+        printf("  file0: wrong after a clean remount\n");
+        status = 1;
+    }
+    lcshutdown();
+    _exit(status);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_random
+// Description  : Fill a buffer with bytes that neither compress nor match
+//                any other fill (by seed).
+//
+// Inputs       : buf, len - the buffer, seed - which fill
+// Outputs      : none
+static void test_random( char *buf, int len, unsigned int seed ) {
+    for (int at = 0; at < len; at++) {
+        seed = seed * 1103515245 + 12345;
+        buf[at] = (char)(seed >> 16);
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_shared_check
+// Description  : Check the files of the shared blocks test hold the data
+//                last written.
+//
+// Inputs       : seed_a, seed_b - the fill each holds (see test_random)
+// Outputs      : 0 if they do, -1 if not
+static int test_shared_check( unsigned int seed_a, unsigned int seed_b ) {
+    static char want[TEST_SHARED_SIZE], got[TEST_SHARED_SIZE];
+    LcFHandle a = lcopen("shared_a"), b = lcopen("shared_b");
+
+    test_random(want, TEST_SHARED_SIZE, seed_a);
+    if (a < 0 || lcpread(a, got, TEST_SHARED_SIZE, 0) != TEST_SHARED_SIZE || memcmp(got, want, TEST_SHARED_SIZE) != 0) {
+        return -1;
+    }
+    test_random(want, TEST_SHARED_SIZE, seed_b);
+    if (b < 0 || lcpread(b, got, TEST_SHARED_SIZE, 0) != TEST_SHARED_SIZE || memcmp(got, want, TEST_SHARED_SIZE) != 0) {
+        return -1;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_shared_write
+// Description  : Make two files share their blocks, then move each block
+//                of one (copy on write) and of the other (packed, then out
+//                of its slots again), close them, and end (see
+//                Test_Endings).
+//
+// Inputs       : none
+// Outputs      : does not return
+static void test_shared_write( void ) {
+    static char buf[TEST_SHARED_SIZE];
+    LcFHandle a, b;
+
+    lcloud_fakebus_wipe();
+    Test_Mode = TEST_MODES - 1;
+    test_mode();
+    Write_Buffer_Blocks = 0;
+    a = lcopen("shared_a");
+    b = lcopen("shared_b");
+    test_random(buf, TEST_SHARED_SIZE, 1);
+    if (lcpwrite(a, buf, TEST_SHARED_SIZE, 0) != TEST_SHARED_SIZE || lcpwrite(b, buf, TEST_SHARED_SIZE, 0) != TEST_SHARED_SIZE) {
+        _exit(1);
+    }
+    test_random(buf, TEST_SHARED_SIZE, 2);
+    if (lcpwrite(a, buf, TEST_SHARED_SIZE, 0) != TEST_SHARED_SIZE) {
+        _exit(1);
+    }
+    memset(buf, 'x', TEST_SHARED_SIZE);
+    if (lcpwrite(b, buf, TEST_SHARED_SIZE, 0) != TEST_SHARED_SIZE) {
+        _exit(1);
+    }
+    test_random(buf, TEST_SHARED_SIZE, 3);
+    if (lcpwrite(b, buf, TEST_SHARED_SIZE, 0) != TEST_SHARED_SIZE || lcclose(a) != 0 || lcclose(b) != 0) {
+        _exit(1);
+    }
+    if (Test_Ending == TEST_STAY) {
+        test_shared_fill();
+    }
+    if (Test_Ending == TEST_CRASH) {
+        lcloud_fakebus_crash();
+    }
+    else if (lcshutdown() != 0) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_shared_fill
+// Description  : Mount the devices the shared blocks test left (unless
+//                they stayed mounted), check its files, write them again,
+//                and fill the devices.  A block
+//                freed while still used would be overwritten, and one with
+//                a reference too many would stay taken when its file moved
+//                off it.  The files must still hold their data.
+//
+// Inputs       : none
+// Outputs      : does not return
+static void test_shared_fill( void ) {
+    static char again[TEST_SHARED_SIZE];
+    char buf[256], name[16];
+    int filled = 0, file = 0, full = 0;
+
+    Test_Mode = TEST_MODES - 1;
+    test_mode();
+    Write_Buffer_Blocks = 0;
+    if (test_shared_check(2, 3) != 0) {
+        printf("  the files sharing blocks are wrong after the remount\n");
+        _exit(1);
+    }
+    for (int seed = 4; seed <= 5; seed++) {
+        test_random(again, TEST_SHARED_SIZE, seed);
+        if (lcpwrite(lcopen((seed == 4) ? "shared_a" : "shared_b"), again, TEST_SHARED_SIZE, 0) != TEST_SHARED_SIZE) {
+            _exit(1);
+        }
+    }
+    while (full == 0) {
+        sprintf(name, "fill%d", file++);
+        LcFHandle fh = lcopen(name);
+        for (int k = 0; k < TEST_FILL_BLOCKS && full == 0; k++) {
+            test_random(buf, sizeof(buf), 100 + filled);
+            full = (fh < 0 || lcwrite(fh, buf, sizeof(buf)) != sizeof(buf));
+            filled += (full == 0);
+        }
+    }
+    if (test_shared_check(4, 5) != 0) {
+        printf("  the files sharing blocks are wrong after the devices filled\n");
+        _exit(1);
+    }
+    Test_Filled[Test_Ending] = filled;
+    _exit(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_full
+// Description  : Make files (long names and a little data) until the
+//                journal can not checkpoint them.  A call must fail, and
+//                every new file after it.
+//
+// Inputs       : none
+// Outputs      : does not return
+static void test_full( void ) {
+    char name[LC_JOURNAL_MAX_NAME], buf[600];
+    int file, failed = 0;
+
+    lcloud_fakebus_wipe();
+    for (file = 0; file < TEST_FULL_FILES && failed == 0; file++) {
+        sprintf(name, "%060d", file);
+        memset(buf, file, sizeof(buf));
+        LcFHandle fh = lcopen(name);
+        failed = (fh < 0 || lcwrite(fh, buf, sizeof(buf)) != sizeof(buf) || lcclose(fh) != 0);
+    }
+    if (failed == 0) {
+        printf("  %d files and the journal never filled\n", file);
+        _exit(1);
+    }
+    if (lcopen("after") >= 0) {
+        printf("  a file was made after the journal failed\n");
+        _exit(1);
+    }
+    _exit(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_names
+// Description  : The longest name is kept whole (two names that differ
+//                only in their last byte are two files, after a remount
+//                too), and a longer one is refused.
+//
+// Inputs       : none
+// Outputs      : does not return
+static void test_names( void ) {
+    char first[LC_JOURNAL_MAX_NAME + 1], second[LC_JOURNAL_MAX_NAME + 1];
+    LcFHandle a, b;
+
+    lcloud_fakebus_wipe();
+    memset(first, 'n', LC_JOURNAL_MAX_NAME - 1);
+    first[LC_JOURNAL_MAX_NAME - 1] = 0;
+    strcpy(second, first);
+    second[LC_JOURNAL_MAX_NAME - 2] = 'm';
+    for (int round = 0; round < 2; round++) {
+        a = lcopen(first);
+        b = lcopen(second);
+        if (a < 0 || b < 0 || a == b) {
+            printf("  the longest names are not two files (round %d)\n", round);
+            _exit(1);
+        }
+        lcshutdown();
+    }
+
+    // One byte more is too long, with or without the same start.
+    first[LC_JOURNAL_MAX_NAME - 1] = 'x';
+    first[LC_JOURNAL_MAX_NAME] = 0;
+    if (lcopen(first) != -1 || lcopen("") != -1) {
+        printf("  a name of the wrong length was opened\n");
+        _exit(1);
+    }
+    _exit(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_run
+// Description  : Run one step of a test in a process of its own.
+//
+// Inputs       : name - what it checks, step - the step
+// Outputs      : 0 if it passed, 1 if not
+static int test_run( const char *name, void (*step)(void) ) {
+    int status = -1;
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        step();
+    }
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("%s: FAILED\n", name);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : Run the journal tests.
+//
+// Inputs       : none
+// Outputs      : 0 if every test passed, 1 if not
+int main( void ) {
+    int failures = 0;
+    char name[64];
+
+    initializeLogWithFilename("lcloud_journal_test.log");
+    setvbuf(stdout, NULL, _IONBF, 0);
+    for (Test_Mode = 0; Test_Mode < TEST_MODES; Test_Mode++) {
+        sprintf(name, "crash (%s): write", Test_Modes[Test_Mode].name);
+        failures += test_run(name, test_crash_write);
+        sprintf(name, "crash (%s): replay", Test_Modes[Test_Mode].name);
+        failures += test_run(name, test_crash_read);
+    }
+    Test_Mode = 0;
+
+    // The devices must take as many blocks after a remount (the references
+    // replayed) as they did while still mounted.
+    Test_Filled = mmap(NULL, TEST_ENDINGS * sizeof(int), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (Test_Filled == MAP_FAILED) {
+        return 1;
+    }
+    for (Test_Ending = 0; Test_Ending < TEST_ENDINGS; Test_Ending++) {
+        sprintf(name, "shared blocks (%s): write%s", Test_Endings[Test_Ending], (Test_Ending == TEST_STAY) ? " and fill" : "");
+        failures += test_run(name, test_shared_write);
+        if (Test_Ending != TEST_STAY) {
+            sprintf(name, "shared blocks (%s): remount and fill", Test_Endings[Test_Ending]);
+            failures += test_run(name, test_shared_fill);
+        }
+    }
+    if (Test_Filled[0] == 0 || Test_Filled[1] != Test_Filled[0] || Test_Filled[2] != Test_Filled[0]) {
+        printf("  the devices took %d blocks with no remount, %d after a shutdown, %d after a crash\n",
+               Test_Filled[0], Test_Filled[1], Test_Filled[2]);
+        printf("shared blocks: as much free after a remount: FAILED\n");
+        failures++;
+    }
+    else {
+        printf("shared blocks: as much free after a remount: passed\n");
+    }
+    failures += test_run("journal too full to checkpoint", test_full);
+    failures += test_run("long names", test_names);
+    lcloud_fakebus_wipe();
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,383 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_l2.c
+//  Description    : This is the implementation of the second cache tier for
+//                   the Lion Cloud filesystem, a memory mapped local file.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stddef.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cmpsc311_log.h>
+
+// Project include files
+#include <lcloud_l2.h>
+#include <lcloud_crc32c.h>
+
+// Information
+//
+// The file is a header page, then the index (a key, checksum and time for
+// every place), then the blocks.  A block can go in the LC_L2_WAYS places
+// of one set, picked by a hash of its address, so a lookup reads one cache
+// line or two of the index.  A full set pushes out its least recently put
+// block.
+//
+// The tier only holds blocks the cache does not: a block moves back into the
+// cache when it is found here, and a block written to the cache drops any
+// copy here.  So a block in the file is never older than the devices.
+//
+// Crash safety: the header is marked in use (and synced) at open, and only
+// marked clean by lcloud_l2_close after the rest of the file is synced.  The
+// blocks are kept at the next open only if the header is clean and names the
+// same devices (the journal's generation); anything else starts empty.  Each
+// block also has a CRC32C of its address and data, checked when it is read,
+// so a torn block is never handed back.
+//
+
+// Defines
+#define LC_L2_HEADER_BYTES 4096  // The header has the first page to itself
+
+// The header of the file
+typedef struct {
+    uint32_t Magic;         // LC_L2_MAGIC
+    uint32_t Version;       // LC_L2_VERSION
+    uint32_t Blocks;        // The geometry it was made with
+    uint32_t Ways;
+    uint32_t Block_Size;
+    uint32_t Identity;      // The devices the blocks came from (0 if unknown)
+    uint32_t Clean;         // 1 if closed cleanly, 0 while in use
+    uint32_t Crc;           // CRC32C of the fields above
+} L2_Header;
+
+// One place in the index
+typedef struct {
+    uint64_t Key;           // The block's address
+    uint32_t Crc;           // CRC32C of the address and the data
+    uint32_t Time;          // When it was put here (0 if the place is empty)
+} L2_Entry;
+
+// The open tier
+static struct L2{
+    int Open;
+    int Fd;
+    char *Map;              // The whole file
+    size_t Size;
+    L2_Header *Header;
+    L2_Entry *Index;
+    char *Data;
+    int Sets;
+    uint32_t Clock;         // The time of the last put
+    LcL2Stats Stats;
+}Tier;
+
+// Pack a block's address into one number.
+#define LC_L2_KEY(did, sec, blk) (((uint64_t)(did) << 32) | ((uint64_t)(sec) << 16) | (uint64_t)(blk))
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : l2_header_crc
+// Description  : The checksum of the header.
+//
+// Inputs       : header - the header
+// Outputs      : the CRC32C of every field before Crc
+static uint32_t l2_header_crc( const L2_Header *header ) {
+    return lcloud_crc32c(0, header, offsetof(L2_Header, Crc));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : l2_block_crc
+// Description  : The checksum of a block (its address too, so a block
+//                can not pass for another).
+//
+// Inputs       : key - the address, data - the block
+// Outputs      : the CRC32C
+static uint32_t l2_block_crc( uint64_t key, const char *data ) {
+    return lcloud_crc32c(lcloud_crc32c(0, &key, sizeof(key)), data, LC_L2_BLOCK_SIZE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : l2_set
+// Description  : The first place of the set a block goes in.
+//
+// Inputs       : key - the address
+// Outputs      : the place
+static int l2_set( uint64_t key ) {
+    return (int)(((key * 0x9e3779b97f4a7c15ull) >> 32) % (uint64_t)Tier.Sets) * LC_L2_WAYS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : l2_find
+// Description  : Look for a block in its set.
+//
+// Inputs       : key - the address
+// Outputs      : the place, -1 if it is not there
+static int l2_find( uint64_t key ) {
+    int First = l2_set(key);
+
+    for (int place = First; place < First + LC_L2_WAYS; place++) {
+        if (Tier.Index[place].Time != 0 && Tier.Index[place].Key == key) {
+            return place;
+        }
+    }
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : l2_drop
+// Description  : Empty a place.
+//
+// Inputs       : place - the place
+// Outputs      : none
+static void l2_drop( int place ) {
+    Tier.Index[place].Time = 0;
+    Tier.Stats.resident--;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_l2_open
+// Description  : Map the tier's file (making it if needed).  Its blocks are
+//                kept only if it was closed cleanly, with the same layout,
+//                for the same devices.
+//
+// Inputs       : path - the file
+//                blocks - the blocks it holds (rounded down to whole sets)
+//                identity - the devices' identity (0 never matches)
+// Outputs      : the number of blocks kept if successful, -1 if failure
+int lcloud_l2_open( const char *path, int blocks, uint32_t identity ) {
+    struct stat Info;
+    size_t Index_Bytes;
+    const char *Cold = NULL;
+
+    if (Tier.Open || blocks < LC_L2_WAYS) {
+        return( -1 );
+    }
+    memset(&Tier, 0, sizeof(Tier));
+    blocks -= blocks % LC_L2_WAYS;
+    Index_Bytes = ((size_t)blocks * sizeof(L2_Entry) + LC_L2_HEADER_BYTES - 1) & ~(size_t)(LC_L2_HEADER_BYTES - 1);
+    Tier.Size = LC_L2_HEADER_BYTES + Index_Bytes + (size_t)blocks * LC_L2_BLOCK_SIZE;
+    Tier.Sets = blocks / LC_L2_WAYS;
+
+    // Open the file at the size of this layout.
+    Tier.Fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (Tier.Fd < 0 || fstat(Tier.Fd, &Info) != 0) {
+        logMessage(LOG_ERROR_LEVEL, "          ### Could not open the local cache tier '%s'.", path);
+        if (Tier.Fd >= 0) {
+            close(Tier.Fd);
+        }
+        return( -1 );
+    }
+    if ((size_t)Info.st_size != Tier.Size) {
+        Cold = "it was made with another size";
+        if (ftruncate(Tier.Fd, Tier.Size) != 0) {
+            logMessage(LOG_ERROR_LEVEL, "          ### Could not size the local cache tier '%s'.", path);
+            close(Tier.Fd);
+            return( -1 );
+        }
+    }
+    Tier.Map = mmap(NULL, Tier.Size, PROT_READ | PROT_WRITE, MAP_SHARED, Tier.Fd, 0);
+    if (Tier.Map == MAP_FAILED) {
+        logMessage(LOG_ERROR_LEVEL, "          ### Could not map the local cache tier '%s'.", path);
+        close(Tier.Fd);
+        return( -1 );
+    }
+    Tier.Header = (L2_Header *)Tier.Map;
+    Tier.Index = (L2_Entry *)(Tier.Map + LC_L2_HEADER_BYTES);
+    Tier.Data = Tier.Map + LC_L2_HEADER_BYTES + Index_Bytes;
+
+    // Decide if the blocks can be trusted.
+    if (Cold == NULL) {
+        L2_Header *Header = Tier.Header;
+        if (Header->Magic != LC_L2_MAGIC || Header->Version != LC_L2_VERSION || Header->Crc != l2_header_crc(Header) ||
+            Header->Blocks != (uint32_t)blocks || Header->Ways != LC_L2_WAYS || Header->Block_Size != LC_L2_BLOCK_SIZE) {
+            Cold = "it has no usable header";
+        }
+        else if (Header->Clean != 1) {
+            Cold = "it was not closed cleanly";
+        }
+        else if (identity == 0 || Header->Identity != identity) {
+            Cold = "the devices have changed";
+        }
+    }
+    if (Cold == NULL) {
+        for (int place = 0; place < blocks; place++) {
+            if (Tier.Index[place].Time != 0) {
+                Tier.Stats.resident++;
+                if (Tier.Index[place].Time > Tier.Clock) {
+                    Tier.Clock = Tier.Index[place].Time;
+                }
+            }
+        }
+        Tier.Stats.recovered = Tier.Stats.resident;
+        logMessage(LOG_INFO_LEVEL, "          ### The local cache tier kept %i blocks from the last run.", Tier.Stats.resident);
+    }
+    else {
+        memset(Tier.Index, 0, Index_Bytes);
+        logMessage(LOG_INFO_LEVEL, "          ### The local cache tier starts empty (%s).", Cold);
+    }
+
+    // Mark the file in use, so a crash from here on leaves it untrusted.
+    Tier.Header->Magic = LC_L2_MAGIC;
+    Tier.Header->Version = LC_L2_VERSION;
+    Tier.Header->Blocks = blocks;
+    Tier.Header->Ways = LC_L2_WAYS;
+    Tier.Header->Block_Size = LC_L2_BLOCK_SIZE;
+    Tier.Header->Identity = identity;
+    Tier.Header->Clean = 0;
+    Tier.Header->Crc = l2_header_crc(Tier.Header);
+    msync(Tier.Map, LC_L2_HEADER_BYTES, MS_SYNC);
+
+    Tier.Stats.blocks = blocks;
+    Tier.Open = 1;
+    return( Tier.Stats.recovered );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_l2_get
+// Description  : Take a block out of the tier, checking its checksum.
+//
+// Inputs       : did, sec, blk - the block's address
+//                block - where to copy the block
+// Outputs      : 0 if found, -1 if not
+int lcloud_l2_get( LcDeviceId did, uint16_t sec, uint16_t blk, char *block ) {
+    uint64_t Key = LC_L2_KEY(did, sec, blk);
+    int Place;
+
+    if (!Tier.Open) {
+        return( -1 );
+    }
+    Place = l2_find(Key);
+    if (Place < 0) {
+        Tier.Stats.misses++;
+        return( -1 );
+    }
+
+    // It goes back to the cache either way.
+    memcpy(block, Tier.Data + (size_t)Place * LC_L2_BLOCK_SIZE, LC_L2_BLOCK_SIZE);
+    l2_drop(Place);
+    if (Tier.Index[Place].Crc != l2_block_crc(Key, block)) {
+        logMessage(LOG_ERROR_LEVEL, "          ### The local cache tier's copy of block %i/%i/%i is corrupt.", did, sec, blk);
+        Tier.Stats.corrupt++;
+        Tier.Stats.misses++;
+        return( -1 );
+    }
+    Tier.Stats.hits++;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_l2_put
+// Description  : Keep a block pushed out of the cache, in place of the least
+//                recently put block of its set if the set is full.
+//
+// Inputs       : did, sec, blk - the block's address
+//                block - the data
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_l2_put( LcDeviceId did, uint16_t sec, uint16_t blk, const char *block ) {
+    uint64_t Key = LC_L2_KEY(did, sec, blk);
+    int Place;
+
+    if (!Tier.Open) {
+        return( -1 );
+    }
+    Place = l2_find(Key);
+    if (Place < 0) {
+        int First = l2_set(Key);
+        Place = First;
+        for (int place = First; place < First + LC_L2_WAYS; place++) {
+            if (Tier.Index[place].Time < Tier.Index[Place].Time) {
+                Place = place;
+            }
+        }
+        if (Tier.Index[Place].Time != 0) {
+            Tier.Stats.drops++;
+        }
+        else {
+            Tier.Stats.resident++;
+        }
+    }
+
+    // Empty the place while it changes (the checksum covers a crash as well).
+    Tier.Index[Place].Time = 0;
+    memcpy(Tier.Data + (size_t)Place * LC_L2_BLOCK_SIZE, block, LC_L2_BLOCK_SIZE);
+    Tier.Index[Place].Key = Key;
+    Tier.Index[Place].Crc = l2_block_crc(Key, block);
+    Tier.Index[Place].Time = ++Tier.Clock;
+    Tier.Stats.stores++;
+    return( 0 );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_l2_forget
+// Description  : Drop the tier's copy of a block, if it has one.
+//
+// Inputs       : did, sec, blk - the block's address
+// Outputs      : none
+void lcloud_l2_forget( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    if (Tier.Open) {
+        int Place = l2_find(LC_L2_KEY(did, sec, blk));
+        if (Place >= 0) {
+            l2_drop(Place);
+        }
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_l2_close
+// Description  : Sync the blocks and index to the disk, then mark the header
+//                clean for the devices named by identity.
+//
+// Inputs       : identity - the devices' identity at shutdown
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_l2_close( uint32_t identity ) {
+    int Status = 0;
+
+    if (!Tier.Open) {
+        return( -1 );
+    }
+    if (msync(Tier.Map, Tier.Size, MS_SYNC) != 0) {
+        Status = -1;
+    }
+    else {
+        Tier.Header->Identity = identity;
+        Tier.Header->Clean = 1;
+        Tier.Header->Crc = l2_header_crc(Tier.Header);
+        if (msync(Tier.Map, LC_L2_HEADER_BYTES, MS_SYNC) != 0) {
+            Status = -1;
+        }
+    }
+    munmap(Tier.Map, Tier.Size);
+    close(Tier.Fd);
+    Tier.Open = 0;
+    return( Status );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_l2_stats
+// Description  : Copy the statistics of the tier.
+//
+// Inputs       : stats - the snapshot to fill
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_l2_stats( LcL2Stats *stats ) {
+    if (stats == NULL) {
+        return( -1 );
+    }
+    *stats = Tier.Stats;
+    return( 0 );
+}
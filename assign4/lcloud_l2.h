@@ -0,0 +1,61 @@
+#ifndef LCLOUD_L2_INCLUDED
+#define LCLOUD_L2_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_l2.h
+//  Description    : This is the second tier of the Lion Cloud cache, kept in
+//                   a memory mapped file on the local disk.  Blocks pushed
+//                   out of the cache go here, and a cache miss looks here
+//                   before going over the bus.  The file survives shutdown,
+//                   so the next power on starts with the blocks warm.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+#include <lcloud_controller.h>
+
+// Defines
+#define LC_L2_MAGIC 0x4c434c32      // "LCL2", marks the file's header
+#define LC_L2_VERSION 1             // On-disk format version
+#define LC_L2_BLOCKS 4096           // Blocks the file holds (1 MB of data)
+#define LC_L2_WAYS 8                // Places a block can go (one set of them)
+#define LC_L2_BLOCK_SIZE 256
+
+// What has happened to the tier
+typedef struct {
+    int blocks;         // The size of the tier
+    int resident;       // Blocks in it now
+    int recovered;      // Blocks kept from the last run (warm restart)
+    uint64_t hits;      // Cache misses the tier served
+    uint64_t misses;    // Cache misses it could not
+    uint64_t stores;    // Blocks put in from the cache
+    uint64_t drops;     // Blocks pushed out of the tier to make room
+    uint64_t corrupt;   // Blocks thrown away because their checksum was wrong
+} LcL2Stats;
+
+//
+// Functional Prototypes
+
+int lcloud_l2_open( const char *path, int blocks, uint32_t identity );
+    // Map the file, keeping its blocks if it was closed cleanly for the same devices
+
+int lcloud_l2_get( LcDeviceId did, uint16_t sec, uint16_t blk, char *block );
+    // Take a block out of the tier (it moves back to the cache)
+
+int lcloud_l2_put( LcDeviceId did, uint16_t sec, uint16_t blk, const char *block );
+    // Keep a block pushed out of the cache
+
+void lcloud_l2_forget( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Drop the tier's copy of a block (the cache has a newer one)
+
+int lcloud_l2_close( uint32_t identity );
+    // Write the file out and mark it clean for the devices named by identity
+
+int lcloud_l2_stats( LcL2Stats *stats );
+    // Copy the statistics of the tier
+
+#endif
@@ -0,0 +1,330 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_layout_test.c
+//  Description    : This is the test of where the Lion Cloud filesystem puts
+//                   blocks, on the fake bus (lcloud_fakebus.c).  Small files
+//                   must read back whole with their tails packed (with the
+//                   cache and write buffers on and off), and rereading them
+//                   after a remount must take fewer requests than with the
+//                   tails in blocks of their own.  Files appended to in
+//                   turn must each be laid out in runs (read back with at
+//                   most three jumps on the devices each, and fewer than
+//                   when placed a block at a time).  Each test runs in a process of
+//                   its own:
+//
+//                     make lcloud_layout_test && ./lcloud_layout_test
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+// Project include files
+#include <cmpsc311_log.h>
+#include <lcloud_filesys.h>
+#include <lcloud_fakebus.h>
+
+// Defines
+#define TEST_SMALL_FILES 60     // Small files written
+#define TEST_SMALL_MOST 510     // The longest of them
+#define TEST_APPEND_FILES 8     // Files appended to in turn
+#define TEST_APPEND_ROUNDS 60   // Appends to each
+#define TEST_APPEND_MOST (TEST_APPEND_ROUNDS * 200)
+
+// The filesystem's switches (see lcloud_filesys.c)
+extern int Tail_Pack_Enabled, Cache_Enabled, Write_Buffer_Blocks, Delayed_Allocation_Blocks;
+
+// The switches each run of the small files test is made with
+static const struct {
+    const char *name;
+    int pack, cache, buffer;
+} Test_Modes[] = {
+    { "tails packed", 1, 1, 8 },
+    { "tails in blocks", 0, 1, 8 },
+    { "tails packed, no cache", 1, 0, 8 },
+    { "tails packed, write-through", 1, 1, 0 },
+    { "tails packed, no cache, write-through", 1, 0, 0 },
+};
+#define TEST_MODES ((int)(sizeof(Test_Modes) / sizeof(Test_Modes[0])))
+
+// The switches each run of the appending files test is made with
+static const struct {
+    const char *name;
+    int delayed, buffer;
+} Test_Append_Modes[] = {
+    { "runs", 16, 8 },
+    { "any free block", 0, 8 },
+    { "runs, write-through", 16, 0 },
+    { "any free block, write-through", 0, 0 },
+};
+#define TEST_APPEND_MODES ((int)(sizeof(Test_Append_Modes) / sizeof(Test_Append_Modes[0])))
+
+// The run of the test (set before it forks)
+static int Test_Mode;
+
+// The requests each run's reread took, and the jumps each appending run's
+// read took (shared with the test processes)
+static uint64_t *Test_Requests;
+static uint64_t *Test_Jumps;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_mode
+// Description  : Switch the filesystem to the run's settings (before its
+//                first call mounts it).
+//
+// Inputs       : none
+// Outputs      : none
+static void test_mode( void ) {
+    Tail_Pack_Enabled = Test_Modes[Test_Mode].pack;
+    Cache_Enabled = Test_Modes[Test_Mode].cache;
+    Write_Buffer_Blocks = Test_Modes[Test_Mode].buffer;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_small
+// Description  : Make the data of a small file.
+//
+// Inputs       : file - which file, buf - where it goes
+// Outputs      : its length
+static int test_small( int file, char *buf ) {
+    int len = 10 + (file * 37) % (TEST_SMALL_MOST - 10);
+
+    for (int at = 0; at < len; at++) {
+        buf[at] = (char)('a' + (file + at * 3) % 26);
+    }
+    return len;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_small_check
+// Description  : Read every small file back whole.
+//
+// Inputs       : none
+// Outputs      : 0 if they all hold their data, -1 if not
+static int test_small_check( void ) {
+    char want[TEST_SMALL_MOST], got[TEST_SMALL_MOST + 256], name[16];
+
+    for (int file = 0; file < TEST_SMALL_FILES; file++) {
+        int len = test_small(file, want);
+        sprintf(name, "small%d", file);
+        LcFHandle fh = lcopen(name);
+        memset(got, 0, sizeof(got));
+        if (fh < 0 || lcpread(fh, got, TEST_SMALL_MOST, 0) != len || memcmp(got, want, len) != 0) {
+            printf("  small%d is wrong\n", file);
+            return -1;
+        }
+        lcclose(fh);
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_small_write
+// Description  : Write the small files (each in two calls, so every tail
+//                grows), check them, and shut down.
+//
+// Inputs       : none
+// Outputs      : does not return
+static void test_small_write( void ) {
+    char buf[TEST_SMALL_MOST], name[16];
+
+    lcloud_fakebus_wipe();
+    test_mode();
+    for (int file = 0; file < TEST_SMALL_FILES; file++) {
+        int len = test_small(file, buf);
+        sprintf(name, "small%d", file);
+        LcFHandle fh = lcopen(name);
+        if (fh < 0 || lcwrite(fh, buf, len / 2) != len / 2 || lcwrite(fh, buf + len / 2, len - len / 2) != len - len / 2 ||
+            lcclose(fh) != 0) {
+            _exit(1);
+        }
+    }
+    if (test_small_check() != 0 || lcshutdown() != 0) {
+        _exit(1);
+    }
+    _exit(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_small_reread
+// Description  : Mount the small files again and reread them, counting the
+//                requests it takes (the mount's included).
+//
+// Inputs       : none
+// Outputs      : does not return
+static void test_small_reread( void ) {
+    LcFakeBusStats stats;
+
+    test_mode();
+    if (test_small_check() != 0) {
+        _exit(1);
+    }
+    lcloud_fakebus_stats(&stats);
+    Test_Requests[Test_Mode] = stats.requests;
+    lcshutdown();
+    _exit(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_append_size
+// Description  : The size of an append (they differ, so the files' blocks
+//                fill at different times).
+//
+// Inputs       : file - which file, round - which append
+// Outputs      : the bytes appended
+static int test_append_size( int file, int round ) {
+    return 100 + 37 * ((round + file) % 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_append
+// Description  : Append to the files in turn, shut down, mount them again
+//                and read each one whole, counting the jumps it takes.
+//
+// Inputs       : none
+// Outputs      : does not return
+static void test_append( void ) {
+    static char buf[TEST_APPEND_MOST];
+    LcFHandle fh[TEST_APPEND_FILES];
+    LcFakeBusStats before, after;
+    char name[16];
+    int length[TEST_APPEND_FILES] = { 0 };
+
+    lcloud_fakebus_wipe();
+    Delayed_Allocation_Blocks = Test_Append_Modes[Test_Mode].delayed;
+    Write_Buffer_Blocks = Test_Append_Modes[Test_Mode].buffer;
+    for (int file = 0; file < TEST_APPEND_FILES; file++) {
+        sprintf(name, "append%d", file);
+        fh[file] = lcopen(name);
+    }
+    for (int round = 0; round < TEST_APPEND_ROUNDS; round++) {
+        for (int file = 0; file < TEST_APPEND_FILES; file++) {
+            int len = test_append_size(file, round);
+            memset(buf, 'a' + file, len);
+            if (lcwrite(fh[file], buf, len) != len) {
+                _exit(1);
+            }
+            length[file] += len;
+        }
+    }
+    if (lcshutdown() != 0) {
+        _exit(1);
+    }
+
+    // Mount them again, then read them back a file at a time.
+    for (int file = 0; file < TEST_APPEND_FILES; file++) {
+        sprintf(name, "append%d", file);
+        fh[file] = lcopen(name);
+    }
+    lcloud_fakebus_stats(&before);
+    for (int file = 0; file < TEST_APPEND_FILES; file++) {
+        if (fh[file] < 0 || lcpread(fh[file], buf, TEST_APPEND_MOST, 0) != length[file]) {
+            _exit(1);
+        }
+        for (int at = 0; at < length[file]; at++) {
+            if (buf[at] != 'a' + file) {
+                printf("  append%d is wrong\n", file);
+                _exit(1);
+            }
+        }
+    }
+    lcloud_fakebus_stats(&after);
+    Test_Jumps[Test_Mode] = after.jumps - before.jumps;
+    lcshutdown();
+    _exit(0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_run
+// Description  : Run one step of a test in a process of its own.
+//
+// Inputs       : name - what it checks, step - the step
+// Outputs      : 0 if it passed, 1 if not
+static int test_run( const char *name, void (*step)(void) ) {
+    int status = -1;
+    pid_t pid = fork();
+
+    if (pid == 0) {
+        step();
+    }
+    if (pid < 0 || waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("%s: FAILED\n", name);
+        return 1;
+    }
+    printf("%s: passed\n", name);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : Run the layout tests.
+//
+// Inputs       : none
+// Outputs      : 0 if every test passed, 1 if not
+int main( void ) {
+    int failures = 0;
+    char name[96];
+
+    initializeLogWithFilename("lcloud_layout_test.log");
+    setvbuf(stdout, NULL, _IONBF, 0);
+    Test_Requests = mmap(NULL, (TEST_MODES + TEST_APPEND_MODES) * sizeof(uint64_t), PROT_READ | PROT_WRITE,
+                         MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (Test_Requests == MAP_FAILED) {
+        return 1;
+    }
+    Test_Jumps = Test_Requests + TEST_MODES;
+
+    // Small files, in every setting.
+    for (Test_Mode = 0; Test_Mode < TEST_MODES; Test_Mode++) {
+        sprintf(name, "small files (%s): write", Test_Modes[Test_Mode].name);
+        failures += test_run(name, test_small_write);
+        sprintf(name, "small files (%s): reread", Test_Modes[Test_Mode].name);
+        failures += test_run(name, test_small_reread);
+    }
+
+    // Packed tails come in together.
+    printf("  rereading took %d requests with the tails packed, %d without\n",
+           (int)Test_Requests[0], (int)Test_Requests[1]);
+    if (Test_Requests[0] == 0 || Test_Requests[0] >= Test_Requests[1]) {
+        printf("small files: fewer requests with the tails packed: FAILED\n");
+        failures++;
+    }
+    else {
+        printf("small files: fewer requests with the tails packed: passed\n");
+    }
+
+    // Files appended to in turn, placed in runs or block by block.
+    for (Test_Mode = 0; Test_Mode < TEST_APPEND_MODES; Test_Mode++) {
+        sprintf(name, "appending files (%s)", Test_Append_Modes[Test_Mode].name);
+        failures += test_run(name, test_append);
+    }
+    for (Test_Mode = 0; Test_Mode < TEST_APPEND_MODES; Test_Mode += 2) {
+        printf("  reading them took %d jumps in runs, %d block by block (%s)\n", (int)Test_Jumps[Test_Mode],
+               (int)Test_Jumps[Test_Mode + 1], (Test_Append_Modes[Test_Mode].buffer > 0) ? "write buffers" : "write-through");
+        if (Test_Jumps[Test_Mode] >= Test_Jumps[Test_Mode + 1] || Test_Jumps[Test_Mode] > 3 * TEST_APPEND_FILES) {
+            printf("appending files: fewer jumps in runs: FAILED\n");
+            failures++;
+        }
+        else {
+            printf("appending files: fewer jumps in runs: passed\n");
+        }
+    }
+    lcloud_fakebus_wipe();
+    return (failures == 0) ? 0 : 1;
+}
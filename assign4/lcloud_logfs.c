@@ -0,0 +1,522 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_logfs.c
+//  Description    : This is the implementation of the log-structured layout
+//                   for the Lion Cloud filesystem.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project include files
+#include <lcloud_logfs.h>
+#include <lcloud_xfer.h>
+
+// Information
+//
+// Each device is cut into segments of LC_LOG_SEGMENT_BLOCKS blocks, counted
+// sector by sector.  One device at a time has an active segment; appended
+// blocks are staged in memory and written to the segment in order, so the
+// bus only ever sees sequential writes.  Blocks that are overwritten before
+// the segment is flushed are never sent at all.
+//
+// Every block in the log remembers its owner (file handle and file block), so
+// the cleaner can move the live blocks of a mostly dead segment to the end of
+// the log and hand the whole segment back as free space.
+//
+
+// Defines
+#define LC_LOG_MAX_DEVICES 15
+#define LC_LOG_OWNER(fh, fblk) ((uint32_t)(fh) * 2048 + (fblk) + 1)  // 0 means free or dead
+
+// The state of one segment
+typedef enum {
+    LC_SEG_FREE     = 0,    // Nothing live, can be made active
+    LC_SEG_ACTIVE   = 1,    // Being appended to
+    LC_SEG_FULL     = 2,    // Closed, may be cleaned
+    LC_SEG_RESERVED = 3     // Holds blocks that are not part of the log
+} LcSegmentState;
+
+// The log state for one device
+static struct Log_Device {
+    int Present;            // If the device is part of the log
+    uint16_t Sectors;       // Geometry of the device
+    uint16_t Blocks;
+    int Total;              // Blocks on the device
+    int Segments;           // Segments on the device
+    int Free_Segments;      // Segments in the LC_SEG_FREE state
+
+    uint8_t *Seg_State;     // LcSegmentState for each segment
+    int *Seg_Live;          // Live blocks in each segment
+    uint32_t *Owner;        // Owner of each block (LC_LOG_OWNER, 0 if dead)
+
+    int Active;             // The active segment (-1 if none)
+    int Fill;               // Blocks appended to the active segment
+    int Flushed;            // Blocks of the active segment allready written
+    char Staged[LC_LOG_SEGMENT_BLOCKS][LC_DEVICE_BLOCK_SIZE]; // The active segment's data
+} Log_Dev[LC_LOG_MAX_DEVICES];
+
+static int Log_Open = 0;            // If the layout is running
+static int Log_Current = -1;        // The device with the segment being appended to
+static int Log_Cleaning = 0;        // Set while the cleaner is moving blocks
+static LcLogRelocate Log_Moved;     // Tells the filesystem where a block moved
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : log_segment_size
+// Description  : The number of blocks in a segment (the last one on a device
+//                may be short).
+//
+// Inputs       : d - the device, seg - the segment
+// Outputs      : the number of blocks
+static int log_segment_size( int d, int seg ) {
+    int left = Log_Dev[d].Total - seg * LC_LOG_SEGMENT_BLOCKS;
+    return (left < LC_LOG_SEGMENT_BLOCKS) ? left : LC_LOG_SEGMENT_BLOCKS;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : log_free_segments
+// Description  : Count the free segments over all devices.
+//
+// Inputs       : none
+// Outputs      : the number of free segments
+static int log_free_segments( void ) {
+    int total = 0;
+    for (int d = 0; d < LC_LOG_MAX_DEVICES; d++) {
+        if (Log_Dev[d].Present) {
+            total += Log_Dev[d].Free_Segments;
+        }
+    }
+    return total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : log_flush_device
+// Description  : Write the staged blocks of a device's active segment, in
+//                order, skipping blocks that died before they were written.
+//
+// Inputs       : d - the device
+// Outputs      : 0 if successful, -1 if failure
+static int log_flush_device( int d ) {
+    struct Log_Device *dev = &Log_Dev[d];
+
+    for (; dev->Active >= 0 && dev->Flushed < dev->Fill; dev->Flushed++) {
+        int lin = dev->Active * LC_LOG_SEGMENT_BLOCKS + dev->Flushed;
+        if (dev->Owner[lin] == 0) {
+            continue;
+        }
+        if (lcloud_xfer_block(d, lin / dev->Blocks, lin % dev->Blocks, LC_XFER_WRITE, dev->Staged[dev->Flushed]) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : log_close_segment
+// Description  : Flush a device's active segment and close it.
+//
+// Inputs       : d - the device
+// Outputs      : 0 if successful, -1 if failure
+static int log_close_segment( int d ) {
+    struct Log_Device *dev = &Log_Dev[d];
+
+    if (dev->Active < 0) {
+        return 0;
+    }
+    if (log_flush_device(d) != 0) {
+        return -1;
+    }
+
+    // A segment that died while it was being filled is free again
+    if (dev->Seg_Live[dev->Active] == 0) {
+        dev->Seg_State[dev->Active] = LC_SEG_FREE;
+        dev->Free_Segments++;
+    }
+    else {
+        dev->Seg_State[dev->Active] = LC_SEG_FULL;
+    }
+    dev->Active = -1;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : log_open_segment
+// Description  : Start a new active segment on the device with the most
+//                free segments, cleaning first if space is low.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if the log is full
+static int log_open_segment( void ) {
+    int best = -1;
+
+    // Keep the reserve for the cleaner itself.  The cleaner appends what it
+    // moves, so it may leave a fresh segment with room in it behind.
+    if (!Log_Cleaning && log_free_segments() <= LC_LOG_CLEAN_RESERVE) {
+        lcloud_logfs_clean(LC_LOG_CLEAN_IDLE);
+        if (Log_Current >= 0 && Log_Dev[Log_Current].Active >= 0 &&
+            Log_Dev[Log_Current].Fill < log_segment_size(Log_Current, Log_Dev[Log_Current].Active)) {
+            return 0;
+        }
+    }
+
+    if (Log_Current >= 0 && log_close_segment(Log_Current) != 0) {
+        return -1;
+    }
+    Log_Current = -1;
+
+    for (int d = 0; d < LC_LOG_MAX_DEVICES; d++) {
+        if (Log_Dev[d].Present && Log_Dev[d].Free_Segments > 0 &&
+            (best == -1 || Log_Dev[d].Free_Segments > Log_Dev[best].Free_Segments)) {
+            best = d;
+        }
+    }
+    if (best == -1) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Log: no free segments left");
+        return -1;
+    }
+
+    // Take the first free segment on that device
+    for (int seg = 0; seg < Log_Dev[best].Segments; seg++) {
+        if (Log_Dev[best].Seg_State[seg] == LC_SEG_FREE) {
+            Log_Dev[best].Seg_State[seg] = LC_SEG_ACTIVE;
+            Log_Dev[best].Free_Segments--;
+            Log_Dev[best].Active = seg;
+            Log_Dev[best].Fill = 0;
+            Log_Dev[best].Flushed = 0;
+            break;
+        }
+    }
+    Log_Current = best;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_init
+// Description  : Start the log-structured layout (devices are added after).
+//
+// Inputs       : relocate - called when the cleaner moves a block
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_logfs_init( LcLogRelocate relocate ) {
+    if (Log_Open) {
+        lcloud_logfs_close();
+    }
+    memset(Log_Dev, 0, sizeof(Log_Dev));
+    Log_Moved = relocate;
+    Log_Current = -1;
+    Log_Cleaning = 0;
+    Log_Open = 1;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_add_device
+// Description  : Divide a device into segments, all of them free.
+//
+// Inputs       : did - the device, sectors, blocks - its geometry
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_logfs_add_device( LcDeviceId did, uint16_t sectors, uint16_t blocks ) {
+    struct Log_Device *dev = &Log_Dev[did];
+
+    if (!Log_Open || did >= LC_LOG_MAX_DEVICES || sectors * blocks == 0) {
+        return -1;
+    }
+    dev->Sectors = sectors;
+    dev->Blocks = blocks;
+    dev->Total = sectors * blocks;
+    dev->Segments = (dev->Total + LC_LOG_SEGMENT_BLOCKS - 1) / LC_LOG_SEGMENT_BLOCKS;
+    dev->Free_Segments = dev->Segments;
+    dev->Seg_State = calloc(dev->Segments, sizeof(uint8_t));
+    dev->Seg_Live = calloc(dev->Segments, sizeof(int));
+    dev->Owner = calloc(dev->Total, sizeof(uint32_t));
+    dev->Active = -1;
+    if (dev->Seg_State == NULL || dev->Seg_Live == NULL || dev->Owner == NULL) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Log: out of memory adding device %i", did);
+        return -1;
+    }
+    dev->Present = 1;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_reserve
+// Description  : Keep a block that does not belong to any file (the journal)
+//                out of the log by reserving its whole segment.
+//
+// Inputs       : did, sec, blk - the physical block
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_logfs_reserve( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    struct Log_Device *dev = &Log_Dev[did];
+
+    if (!Log_Open || did >= LC_LOG_MAX_DEVICES || !dev->Present) {
+        return -1;
+    }
+    int lin = sec * dev->Blocks + blk;
+    int seg = lin / LC_LOG_SEGMENT_BLOCKS;
+
+    // File blocks are tracked as live, not reserved
+    if (dev->Owner[lin] != 0) {
+        return 0;
+    }
+    if (dev->Seg_State[seg] == LC_SEG_FREE) {
+        dev->Free_Segments--;
+    }
+    dev->Seg_State[seg] = LC_SEG_RESERVED;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_mark_live
+// Description  : Record a file block that is allready on the device.  Its
+//                segment is closed, and will be cleaned once mostly dead.
+//
+// Inputs       : did, sec, blk - the physical block
+//                fh, fblk - the file block stored there
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_logfs_mark_live( LcDeviceId did, uint16_t sec, uint16_t blk, uint16_t fh, uint16_t fblk ) {
+    struct Log_Device *dev = &Log_Dev[did];
+
+    if (!Log_Open || did >= LC_LOG_MAX_DEVICES || !dev->Present) {
+        return -1;
+    }
+    int lin = sec * dev->Blocks + blk;
+    int seg = lin / LC_LOG_SEGMENT_BLOCKS;
+
+    if (dev->Seg_State[seg] == LC_SEG_FREE) {
+        dev->Seg_State[seg] = LC_SEG_FULL;
+        dev->Free_Segments--;
+    }
+    if (dev->Owner[lin] == 0) {
+        dev->Seg_Live[seg]++;
+    }
+    dev->Owner[lin] = LC_LOG_OWNER(fh, fblk);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_append
+// Description  : Place a new version of a file block at the end of the log.
+//                The data is staged until the segment is flushed.
+//
+// Inputs       : fh, fblk - the file block
+//                data - the 256 byte block
+//                did, sec, blk - set to where the block was placed
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_logfs_append( uint16_t fh, uint16_t fblk, char *data,
+                         int *did, int *sec, int *blk ) {
+    if (!Log_Open) {
+        return -1;
+    }
+
+    // Move on to a new segment when the current one is full
+    if (Log_Current < 0 || Log_Dev[Log_Current].Active < 0 ||
+        Log_Dev[Log_Current].Fill >= log_segment_size(Log_Current, Log_Dev[Log_Current].Active)) {
+        if (log_open_segment() != 0) {
+            return -1;
+        }
+    }
+
+    struct Log_Device *dev = &Log_Dev[Log_Current];
+    int lin = dev->Active * LC_LOG_SEGMENT_BLOCKS + dev->Fill;
+
+    memcpy(dev->Staged[dev->Fill], data, LC_DEVICE_BLOCK_SIZE);
+    dev->Owner[lin] = LC_LOG_OWNER(fh, fblk);
+    dev->Seg_Live[dev->Active]++;
+    dev->Fill++;
+
+    *did = Log_Current;
+    *sec = lin / dev->Blocks;
+    *blk = lin % dev->Blocks;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_release
+// Description  : Mark the old version of a block as dead.  A closed segment
+//                with nothing left alive is free straight away.
+//
+// Inputs       : did, sec, blk - the physical block
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_logfs_release( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    struct Log_Device *dev = &Log_Dev[did];
+
+    if (!Log_Open || did >= LC_LOG_MAX_DEVICES || !dev->Present) {
+        return -1;
+    }
+    int lin = sec * dev->Blocks + blk;
+    int seg = lin / LC_LOG_SEGMENT_BLOCKS;
+
+    if (dev->Owner[lin] == 0) {
+        return 0;
+    }
+    dev->Owner[lin] = 0;
+    dev->Seg_Live[seg]--;
+
+    if (dev->Seg_State[seg] == LC_SEG_FULL && dev->Seg_Live[seg] == 0) {
+        dev->Seg_State[seg] = LC_SEG_FREE;
+        dev->Free_Segments++;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_staged
+// Description  : Find a block that is in the active segment's memory.
+//
+// Inputs       : did, sec, blk - the physical block
+// Outputs      : the staged block (pointer), NULL if not staged
+char * lcloud_logfs_staged( LcDeviceId did, uint16_t sec, uint16_t blk ) {
+    struct Log_Device *dev = &Log_Dev[did];
+
+    if (!Log_Open || did >= LC_LOG_MAX_DEVICES || !dev->Present || dev->Active < 0) {
+        return NULL;
+    }
+    int idx = sec * dev->Blocks + blk - dev->Active * LC_LOG_SEGMENT_BLOCKS;
+    if (idx < 0 || idx >= dev->Fill) {
+        return NULL;
+    }
+    return dev->Staged[idx];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_flush
+// Description  : Write every staged block (the segments stay active).
+//                Nothing is staged while the layout is not started.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_logfs_flush( void ) {
+    if (!Log_Open) {
+        return 0;
+    }
+    for (int d = 0; d < LC_LOG_MAX_DEVICES; d++) {
+        if (Log_Dev[d].Present && log_flush_device(d) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_clean
+// Description  : Move the live blocks out of the emptiest closed segments
+//                and free them.  Only segments at or under
+//                LC_LOG_CLEAN_PERCENT live are taken, unless the log is close
+//                to its reserve, then any segment with a dead block is.
+//
+// Inputs       : max_segments - the most segments to clean
+// Outputs      : the number of segments freed, -1 if failure
+int lcloud_logfs_clean( int max_segments ) {
+    char data[LC_DEVICE_BLOCK_SIZE];
+    int cleaned = 0;
+
+    if (!Log_Open || Log_Cleaning) {
+        return 0;
+    }
+    Log_Cleaning = 1;
+
+    while (cleaned < max_segments) {
+        int vd = -1, vseg = -1, vlive = 0, vsize = 0;
+        int low = (log_free_segments() <= 2 * LC_LOG_CLEAN_RESERVE);
+
+        // Greedy: the closed segment with the smallest live fraction (the
+        // last segment of a device may be short, so compare fractions)
+        for (int d = 0; d < LC_LOG_MAX_DEVICES; d++) {
+            if (!Log_Dev[d].Present) {
+                continue;
+            }
+            for (int seg = 0; seg < Log_Dev[d].Segments; seg++) {
+                int live = Log_Dev[d].Seg_Live[seg], size = log_segment_size(d, seg);
+                if (Log_Dev[d].Seg_State[seg] == LC_SEG_FULL && live < size &&
+                    (vd == -1 || live * vsize < vlive * size)) {
+                    vd = d;
+                    vseg = seg;
+                    vlive = live;
+                    vsize = size;
+                }
+            }
+        }
+        if (vd == -1 || (!low && vlive * 100 > vsize * LC_LOG_CLEAN_PERCENT)) {
+            break;
+        }
+
+        // Copy each live block to the end of the log
+        struct Log_Device *dev = &Log_Dev[vd];
+        for (int i = 0; i < vsize && dev->Seg_Live[vseg] > 0; i++) {
+            int lin = vseg * LC_LOG_SEGMENT_BLOCKS + i;
+            uint32_t owner = dev->Owner[lin];
+            int nd, ns, nb;
+
+            if (owner == 0) {
+                continue;
+            }
+            if (lcloud_xfer_block(vd, lin / dev->Blocks, lin % dev->Blocks, LC_XFER_READ, data) != 0) {
+                Log_Cleaning = 0;
+                return -1;
+            }
+            if (lcloud_logfs_append((owner - 1) / 2048, (owner - 1) % 2048, data, &nd, &ns, &nb) != 0) {
+                Log_Cleaning = 0;
+                return -1;
+            }
+            dev->Owner[lin] = 0;
+            dev->Seg_Live[vseg]--;
+            Log_Moved((owner - 1) / 2048, (owner - 1) % 2048, nd, ns, nb, data);
+        }
+
+        dev->Seg_State[vseg] = LC_SEG_FREE;
+        dev->Free_Segments++;
+        cleaned++;
+        logMessage(LOG_OUTPUT_LEVEL, "          ### Log: cleaned segment %i on device %i (%i live blocks moved)", vseg, vd, vlive);
+    }
+
+    Log_Cleaning = 0;
+    return cleaned;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_logfs_close
+// Description  : Flush the active segments and release the layout.
+//
+// Inputs       : none
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_logfs_close( void ) {
+    int status = 0;
+
+    if (!Log_Open) {
+        return -1;
+    }
+    for (int d = 0; d < LC_LOG_MAX_DEVICES; d++) {
+        if (!Log_Dev[d].Present) {
+            continue;
+        }
+        if (log_close_segment(d) != 0) {
+            status = -1;
+        }
+        free(Log_Dev[d].Seg_State);
+        free(Log_Dev[d].Seg_Live);
+        free(Log_Dev[d].Owner);
+        Log_Dev[d].Present = 0;
+    }
+    Log_Current = -1;
+    Log_Open = 0;
+    return status;
+}
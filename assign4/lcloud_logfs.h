@@ -0,0 +1,64 @@
+#ifndef LCLOUD_LOGFS_INCLUDED
+#define LCLOUD_LOGFS_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_logfs.h
+//  Description    : This is the log-structured layout API for the Lion Cloud
+//                   filesystem.  Every new or overwritten block is appended
+//                   to the active segment of a device and a cleaner compacts
+//                   the live blocks out of mostly dead segments.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+#include <lcloud_controller.h>
+
+// Defines
+#define LC_LOG_SEGMENT_BLOCKS 16    // Blocks in one segment (consecutive on the device)
+#define LC_LOG_CLEAN_RESERVE 2      // Free segments kept back so the cleaner can always run
+#define LC_LOG_CLEAN_PERCENT 50     // Segments at or below this percent live are worth cleaning
+#define LC_LOG_CLEAN_IDLE 4         // Segments cleaned each time the filesystem is idle
+
+// Called when the cleaner moves a live block, so the file map can follow it
+typedef void (*LcLogRelocate)( uint16_t fh, uint16_t fblk, LcDeviceId did,
+                               uint16_t sec, uint16_t blk, char *data );
+
+//
+// Functional Prototypes
+
+int lcloud_logfs_init( LcLogRelocate relocate );
+    // Start the log-structured layout
+
+int lcloud_logfs_add_device( LcDeviceId did, uint16_t sectors, uint16_t blocks );
+    // Divide a device into segments
+
+int lcloud_logfs_reserve( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Keep a block out of the log (its segment is never used)
+
+int lcloud_logfs_mark_live( LcDeviceId did, uint16_t sec, uint16_t blk, uint16_t fh, uint16_t fblk );
+    // Record a block that is allready on the device (at mount)
+
+int lcloud_logfs_append( uint16_t fh, uint16_t fblk, char *data,
+                         int *did, int *sec, int *blk );
+    // Place a new version of a file block at the end of the log
+
+int lcloud_logfs_release( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Mark an old version of a block as dead
+
+char * lcloud_logfs_staged( LcDeviceId did, uint16_t sec, uint16_t blk );
+    // Find a block that has been appended but not yet written
+
+int lcloud_logfs_flush( void );
+    // Write every staged block to its device
+
+int lcloud_logfs_clean( int max_segments );
+    // Compact live blocks out of the emptiest segments
+
+int lcloud_logfs_close( void );
+    // Flush and release the layout
+
+#endif
@@ -0,0 +1,221 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_mrc.c
+//  Description    : This is the implementation of the miss ratio curve
+//                   estimator for the Lion Cloud cache.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdlib.h>
+#include <string.h>
+#include <cmpsc311_log.h>
+
+// Project include files
+#include <lcloud_mrc.h>
+
+// Information
+//
+// SHARDS: a block is sampled when the hash of its address falls under a
+// threshold, so every access to a sampled block is seen and none to the
+// others.  The reuse distance (distinct blocks touched since the block was
+// last used) is measured among the sampled blocks only and scaled up by
+// 1/rate, which gives the reuse distance in the full stream.  An LRU cache
+// of size c hits exactly the accesses with a distance under c, so the
+// histogram of distances is the whole curve.
+//
+// The sample is kept to LC_MRC_MAX_SAMPLES blocks: when it is full the
+// block with the highest hash is dropped and the threshold lowered to it
+// (the fixed-size variant), so memory stays bounded on any workload.
+//
+
+// Defines
+#define LC_MRC_HASH_SPACE (1u << 24)   // Hash values are taken modulo this
+
+// One block in the sample
+typedef struct {
+    uint64_t key;   // The block's address
+    uint32_t hash;  // Its hash (below the threshold)
+} LcMrcSample;
+
+static LcMrcSample *Mrc_Stack = NULL;   // The sampled blocks, least recently used first
+static int Mrc_Count = 0;               // Blocks in the sample
+static uint32_t Mrc_Threshold = 0;      // Blocks hashing under this are sampled
+static uint64_t *Mrc_Histogram = NULL;  // Accesses by scaled reuse distance
+static uint64_t Mrc_Total = 0;          // Sampled accesses
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : mrc_hash
+// Description  : Hash a block address into the sampling space.
+//
+// Inputs       : key - the address
+// Outputs      : the hash, below LC_MRC_HASH_SPACE
+static uint32_t mrc_hash( uint64_t key ) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    key *= 0xc4ceb9fe1a85ec53ull;
+    key ^= key >> 33;
+    return (uint32_t)(key % LC_MRC_HASH_SPACE);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_mrc_init
+// Description  : Start an empty curve.
+//
+// Inputs       : rate - the fraction of blocks to sample (0 to 1)
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_mrc_init( double rate ) {
+    lcloud_mrc_close();
+    if (rate <= 0 || rate > 1) {
+        return -1;
+    }
+    Mrc_Stack = malloc(LC_MRC_MAX_SAMPLES * sizeof(LcMrcSample));
+    Mrc_Histogram = calloc(LC_MRC_MAX_BLOCKS, sizeof(uint64_t));
+    if (Mrc_Stack == NULL || Mrc_Histogram == NULL) {
+        logMessage(LOG_ERROR_LEVEL, "           ### MRC: out of memory");
+        lcloud_mrc_close();
+        return -1;
+    }
+    Mrc_Threshold = (uint32_t)(rate * LC_MRC_HASH_SPACE);
+    Mrc_Count = 0;
+    Mrc_Total = 0;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_mrc_access
+// Description  : Record one access to a block.  Blocks outside the sample
+//                cost one hash.  Writes put the block in the cache without
+//                looking for it, so they move it up without being counted.
+//
+// Inputs       : did, sec, blk - the block
+//                lookup - 1 if the access looks in the cache, 0 if not
+// Outputs      : none
+void lcloud_mrc_access( LcDeviceId did, uint16_t sec, uint16_t blk, int lookup ) {
+    uint64_t key = ((uint64_t)did << 32) | ((uint64_t)sec << 16) | blk;
+    uint32_t hash;
+    int i;
+
+    if (Mrc_Stack == NULL) {
+        return;
+    }
+    hash = mrc_hash(key);
+    if (hash >= Mrc_Threshold) {
+        return;
+    }
+    if (lookup) {
+        Mrc_Total++;
+    }
+
+    // Find the block, its distance is the number used more recently.
+    for (i = Mrc_Count - 1; i >= 0; i--) {
+        if (Mrc_Stack[i].key == key) {
+            break;
+        }
+    }
+    if (i >= 0) {
+        uint64_t distance = (uint64_t)(Mrc_Count - 1 - i) * LC_MRC_HASH_SPACE / Mrc_Threshold;
+        if (lookup && distance < LC_MRC_MAX_BLOCKS) {
+            Mrc_Histogram[distance]++;
+        }
+        memmove(&Mrc_Stack[i], &Mrc_Stack[i + 1], (Mrc_Count - 1 - i) * sizeof(LcMrcSample));
+        Mrc_Stack[Mrc_Count - 1].key = key;
+        Mrc_Stack[Mrc_Count - 1].hash = hash;
+        return;
+    }
+    // A new block, make room by dropping the highest hash and sampling less.
+    if (Mrc_Count == LC_MRC_MAX_SAMPLES) {
+        int drop = 0;
+        for (i = 1; i < Mrc_Count; i++) {
+            if (Mrc_Stack[i].hash > Mrc_Stack[drop].hash) {
+                drop = i;
+            }
+        }
+        Mrc_Threshold = Mrc_Stack[drop].hash;
+        memmove(&Mrc_Stack[drop], &Mrc_Stack[drop + 1], (Mrc_Count - 1 - drop) * sizeof(LcMrcSample));
+        Mrc_Count--;
+        if (hash >= Mrc_Threshold) {
+            return;
+        }
+    }
+    Mrc_Stack[Mrc_Count].key = key;
+    Mrc_Stack[Mrc_Count].hash = hash;
+    Mrc_Count++;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_mrc_hit_ratio
+// Description  : Predict the hit ratio of an LRU cache of a given size.
+//
+// Inputs       : blocks - the cache size
+// Outputs      : the fraction of accesses that would hit (0 if no data yet)
+double lcloud_mrc_hit_ratio( int blocks ) {
+    uint64_t hits = 0;
+
+    if (Mrc_Histogram == NULL || Mrc_Total == 0) {
+        return 0;
+    }
+    if (blocks > LC_MRC_MAX_BLOCKS) {
+        blocks = LC_MRC_MAX_BLOCKS;
+    }
+    for (int d = 0; d < blocks; d++) {
+        hits += Mrc_Histogram[d];
+    }
+    return (double)hits / Mrc_Total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_mrc_size_for
+// Description  : Find the smallest cache predicted to reach a hit ratio.
+//
+// Inputs       : ratio - the hit ratio wanted (0 to 1)
+// Outputs      : the size in blocks, -1 if no size up to LC_MRC_MAX_BLOCKS does
+int lcloud_mrc_size_for( double ratio ) {
+    uint64_t hits = 0;
+
+    if (Mrc_Histogram == NULL || Mrc_Total == 0) {
+        return -1;
+    }
+    for (int d = 0; d < LC_MRC_MAX_BLOCKS; d++) {
+        hits += Mrc_Histogram[d];
+        if ((double)hits >= ratio * Mrc_Total) {
+            return d + 1;
+        }
+    }
+    return -1;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_mrc_sampled
+// Description  : The number of accesses the curve is built from.
+//
+// Inputs       : none
+// Outputs      : the count of sampled lookups
+uint64_t lcloud_mrc_sampled( void ) {
+    return Mrc_Total;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_mrc_close
+// Description  : Release the estimator.
+//
+// Inputs       : none
+// Outputs      : none
+void lcloud_mrc_close( void ) {
+    free(Mrc_Stack);
+    free(Mrc_Histogram);
+    Mrc_Stack = NULL;
+    Mrc_Histogram = NULL;
+    Mrc_Count = 0;
+    Mrc_Total = 0;
+}
@@ -0,0 +1,46 @@
+#ifndef LCLOUD_MRC_INCLUDED
+#define LCLOUD_MRC_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_mrc.h
+//  Description    : This is the miss ratio curve estimator for the Lion Cloud
+//                   cache.  It samples the block access stream (SHARDS) and
+//                   predicts the hit ratio the cache would have at any size.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+#include <lcloud_controller.h>
+
+// Defines
+#define LC_MRC_MAX_BLOCKS 8192     // The largest cache size predicted
+#define LC_MRC_MAX_SAMPLES 2048    // The most blocks tracked at once
+#define LC_MRC_DEFAULT_RATE 0.1    // The fraction of blocks sampled to start with
+#define LC_MRC_RESIZE_PERIOD 4096  // Accesses between checks of the cache size
+
+//
+// Functional Prototypes
+
+int lcloud_mrc_init( double rate );
+    // Start an empty curve, sampling about rate of the blocks
+
+void lcloud_mrc_access( LcDeviceId did, uint16_t sec, uint16_t blk, int lookup );
+    // Record one access to a block (lookup 0 for a write that only refreshes it)
+
+double lcloud_mrc_hit_ratio( int blocks );
+    // The predicted hit ratio of a cache of the given size (0 to 1)
+
+int lcloud_mrc_size_for( double ratio );
+    // The smallest cache size predicted to hit ratio of the accesses
+
+uint64_t lcloud_mrc_sampled( void );
+    // The number of accesses the curve is built from
+
+void lcloud_mrc_close( void );
+    // Release the estimator
+
+#endif
@@ -31,5 +31,14 @@ LCloudRegisterFrame client_lcloud_bus_request(LCloudRegisterFrame reg, void *buf
 	// This is the implementation of the client operation, as implemented 
 	//  by the 311 student code.
 
+int client_lcloud_connect( void );
+	// Connect to the server (if not already connected)
+
+int client_lcloud_bus_batch( LCloudRegisterFrame *regs, int count );
+	// Send a run of requests that move no data, in one round trip
+
+int client_lcloud_bus_xfer_batch( LCloudRegisterFrame *regs, char **bufs, int count );
+	// Send a run of requests (block transfers too), in one round trip
+
 
 #endif
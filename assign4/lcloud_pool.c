@@ -0,0 +1,114 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_pool.c
+//  Description    : This is the implementation of the I/O buffer pool for
+//                   callers of the Lion Cloud filesystem.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+
+// Project include files
+#include <lcloud_pool.h>
+#include <lcloud_controller.h>
+
+// The buffers kept of each size (a stack each), shared by every thread.
+static struct {
+    void *free[LC_POOL_CLASSES][LC_POOL_KEEP];
+    int count[LC_POOL_CLASSES];
+    pthread_mutex_t lock;
+} Pool = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : pool_class
+// Description  : Find the size a request is rounded up to.
+//
+// Inputs       : bytes - the request
+// Outputs      : the class (LC_POOL_CLASSES if it is too big to keep)
+static int pool_class( size_t bytes ) {
+    int class = 0;
+
+    while (class < LC_POOL_CLASSES && ((size_t)LC_DEVICE_BLOCK_SIZE << class) < bytes) {
+        class++;
+    }
+    return class;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_pool_get
+// Description  : Get a buffer of at least bytes, aligned to LC_POOL_ALIGN,
+//                reusing one given back if there is one of its size.
+//
+// Inputs       : bytes - the size wanted
+//                capacity - set to the size of the buffer
+// Outputs      : the buffer, NULL if out of memory
+void * lcloud_pool_get( size_t bytes, size_t *capacity ) {
+    int class = pool_class(bytes);
+    void *buf = NULL;
+
+    // Too big to keep, it gets its own (in whole blocks).
+    if (class == LC_POOL_CLASSES) {
+        *capacity = (bytes + LC_DEVICE_BLOCK_SIZE - 1) / LC_DEVICE_BLOCK_SIZE * LC_DEVICE_BLOCK_SIZE;
+    }
+    else {
+        *capacity = (size_t)LC_DEVICE_BLOCK_SIZE << class;
+        pthread_mutex_lock(&Pool.lock);
+        if (Pool.count[class] > 0) {
+            buf = Pool.free[class][--Pool.count[class]];
+        }
+        pthread_mutex_unlock(&Pool.lock);
+    }
+    if (buf == NULL && posix_memalign(&buf, LC_POOL_ALIGN, *capacity) != 0) {
+        return NULL;
+    }
+    return buf;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_pool_put
+// Description  : Give a buffer back, keeping it if its size has room.
+//
+// Inputs       : buf - the buffer (may be NULL)
+//                capacity - its size
+// Outputs      : none
+void lcloud_pool_put( void *buf, size_t capacity ) {
+    int class = pool_class(capacity);
+
+    if (buf == NULL) {
+        return;
+    }
+    if (class < LC_POOL_CLASSES && ((size_t)LC_DEVICE_BLOCK_SIZE << class) == capacity) {
+        pthread_mutex_lock(&Pool.lock);
+        if (Pool.count[class] < LC_POOL_KEEP) {
+            Pool.free[class][Pool.count[class]++] = buf;
+            buf = NULL;
+        }
+        pthread_mutex_unlock(&Pool.lock);
+    }
+    free(buf);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_pool_drain
+// Description  : Free every buffer the pool is keeping.
+//
+// Inputs       : none
+// Outputs      : none
+void lcloud_pool_drain( void ) {
+    pthread_mutex_lock(&Pool.lock);
+    for (int class = 0; class < LC_POOL_CLASSES; class++) {
+        while (Pool.count[class] > 0) {
+            free(Pool.free[class][--Pool.count[class]]);
+        }
+    }
+    pthread_mutex_unlock(&Pool.lock);
+}
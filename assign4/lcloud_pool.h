@@ -0,0 +1,44 @@
+#ifndef LCLOUD_POOL_INCLUDED
+#define LCLOUD_POOL_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_pool.h
+//  Description    : This is a pool of aligned I/O buffers for callers of the
+//                   Lion Cloud filesystem.  Buffers are whole blocks, rounded
+//                   up to a power of two of them, and a buffer given back is
+//                   kept for the next request of its size instead of freed.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Defines
+#define LC_POOL_ALIGN 64        // Every buffer starts on a CPU cache line
+#define LC_POOL_CLASSES 8       // Sizes kept: 1, 2, 4 ... 128 blocks
+#define LC_POOL_KEEP 16         // Buffers kept of each size
+
+//
+// Functional Prototypes
+
+void * lcloud_pool_get( size_t bytes, size_t *capacity );
+    // Get a buffer of at least bytes (capacity is set to its real size)
+
+void lcloud_pool_put( void *buf, size_t capacity );
+    // Give a buffer back (capacity as lcloud_pool_get set it)
+
+void lcloud_pool_drain( void );
+    // Free every buffer the pool is keeping
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
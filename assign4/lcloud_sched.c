@@ -0,0 +1,356 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_sched.c
+//  Description    : This is the implementation of the block transfer
+//                   scheduler of the Lion Cloud filesystem.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+
+// Project include files
+#include <lcloud_sched.h>
+#include <lcloud_arena.h>
+
+// Information
+//
+// Transfers of different blocks can go in any order, so the run is sorted
+// by device and then by where each device's head would be: the blocks at or
+// after the last one sent to it first, in order, then the ones before it
+// (one sweep, C-SCAN).  The sort keeps the order of the transfers of one
+// block, so within a block a read that follows a read with no write
+// between is served from the first one, and a write followed by another
+// write with no read between never needs to go out.
+//
+// The gate lets one call at a time into the filesystem.  A call that finds
+// it taken waits in its class with a start tag (start-time fair queuing):
+// the later of the class's virtual time and where its file's last call
+// there finished, so a file that has had more than its share waits behind
+// the others.  A call finishes its cost (in blocks) divided by its file's
+// weight after its tag, so of two busy files in a class the one of weight
+// 4 moves four times the blocks of the one of weight 1.  The next turn goes to the lowest tag of the first class
+// with a call waiting, unless a class below it has been passed over
+// LC_SCHED_PASS times (background work is slowed, never stopped).
+//
+
+// The scheduler
+static struct {
+    int depth;                          // Transfers per round trip
+    uint32_t head[LC_SCHED_DEVICES];    // Where each device was left (sector << 16 | block)
+    LcSchedStats stats;
+} Sched = { LC_XFER_BATCH_MAX };
+
+// Where a run's working arrays come from.  It is reset after each run and
+// keeps its first chunk, so only the first run (or one of more than about a
+// thousand transfers) goes to malloc.
+static LcArena Sched_Arena;
+
+// One transfer while a run is sorted
+typedef struct {
+    int index;          // Its place in the run
+    int sweep;          // 0 if at or after the device's head, 1 if it waits for the next sweep
+    uint32_t where;     // sector << 16 | block
+    LcDeviceId did;
+} LcSchedEntry;
+
+// A call waiting at the gate (on its caller's stack)
+typedef struct LcGateWaiter {
+    uint64_t tag;                   // Its start tag
+    int granted;                    // Its turn came
+    struct LcGateWaiter *next;      // The one that came after it
+} LcGateWaiter;
+
+// The gate
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t turn;            // Signalled when a turn is given
+    int busy;                       // A call is inside
+    LcGateWaiter *waiting[LC_SCHED_CLASSES];
+    int passed[LC_SCHED_CLASSES];   // Turns given over each class's waiters
+    uint64_t vtime[LC_SCHED_CLASSES];
+    uint64_t finish[LC_SCHED_CLASSES][LC_SCHED_FLOWS];
+    uint64_t hist[LC_SCHED_CLASSES][64];    // Waits, by power of two microseconds
+    LcGateStats stats[LC_SCHED_CLASSES];
+} Gate = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER };
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : sched_order
+// Description  : Compare two transfers for qsort: device, sweep, place, then
+//                the order they were asked for (so the sort is stable).
+//
+// Inputs       : a, b - the LcSchedEntry structures
+// Outputs      : <0, 0 or >0
+static int sched_order( const void *a, const void *b ) {
+    const LcSchedEntry *x = a, *y = b;
+
+    if (x->did != y->did) {
+        return (x->did < y->did) ? -1 : 1;
+    }
+    if (x->sweep != y->sweep) {
+        return x->sweep - y->sweep;
+    }
+    if (x->where != y->where) {
+        return (x->where < y->where) ? -1 : 1;
+    }
+    return x->index - y->index;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_sched_init
+// Description  : Set the queue depth and forget where the devices were.
+//
+// Inputs       : depth - transfers per round trip (1 to LC_XFER_BATCH_MAX)
+// Outputs      : none
+void lcloud_sched_init( int depth ) {
+    memset(&Sched, 0, sizeof(Sched));
+    Sched.depth = (depth < 1) ? 1 : (depth > LC_XFER_BATCH_MAX) ? LC_XFER_BATCH_MAX : depth;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_sched_submit
+// Description  : Order, merge and send a run of transfers.  A merged read
+//                gets the data and status of the read that served it, a
+//                dropped write the status of the write that replaced it.
+//
+// Inputs       : xfers - the transfers (their status is set)
+//                count - the number of them
+// Outputs      : 0 if every transfer worked, -1 if any failed
+int lcloud_sched_submit( LcXferBlock *xfers, int count ) {
+    LcSchedEntry *Order = lcloud_arena_alloc(&Sched_Arena, count * sizeof(LcSchedEntry));
+    LcXferBlock *Send = lcloud_arena_alloc(&Sched_Arena, count * sizeof(LcXferBlock));
+    int *Sent_As = lcloud_arena_alloc(&Sched_Arena, count * sizeof(int));     // The transfer sent for each (-1 until known)
+    int *Slot = lcloud_arena_alloc(&Sched_Arena, count * sizeof(int));        // Each sent transfer's place in Send
+    int sends = 0, status = 0;
+
+    if (count <= 0 || Order == NULL || Send == NULL || Sent_As == NULL || Slot == NULL) {
+        lcloud_arena_reset(&Sched_Arena);
+        return (count <= 0) ? 0 : lcloud_xfer_batch(xfers, count);
+    }
+    Sched.stats.requests += count;
+
+    for (int i = 0; i < count; i++) {
+        Order[i].index = i;
+        Order[i].did = xfers[i].did;
+        Order[i].where = ((uint32_t)xfers[i].sec << 16) | xfers[i].blk;
+        Order[i].sweep = (Order[i].where < Sched.head[xfers[i].did]) ? 1 : 0;
+        Sent_As[i] = -1;
+    }
+    qsort(Order, count, sizeof(LcSchedEntry), sched_order);
+
+    // Walk each block's transfers (in the order asked), deciding what is sent.
+    for (int i = 0; i < count; ) {
+        int end = i;
+        while (end < count && Order[end].did == Order[i].did && Order[end].where == Order[i].where) {
+            end++;
+        }
+        for (int j = i; j < end; j++) {
+            LcXferBlock *x = &xfers[Order[j].index];
+            LcXferBlock *prev = (j > i) ? &xfers[Order[j - 1].index] : NULL;
+            LcXferBlock *next = (j + 1 < end) ? &xfers[Order[j + 1].index] : NULL;
+
+            if (x->op == LC_XFER_READ && prev != NULL && prev->op == LC_XFER_READ) {
+                Sent_As[Order[j].index] = Sent_As[Order[j - 1].index];
+                Sched.stats.merged++;
+            }
+            else if (x->op == LC_XFER_WRITE && next != NULL && next->op == LC_XFER_WRITE) {
+                Sched.stats.merged++;   // Replaced by the next write (set below)
+            }
+            else {
+                Slot[sends] = Order[j].index;
+                Send[sends] = *x;
+                Sent_As[Order[j].index] = sends++;
+            }
+        }
+        for (int j = end - 2; j >= i; j--) {
+            if (Sent_As[Order[j].index] < 0) {
+                Sent_As[Order[j].index] = Sent_As[Order[j + 1].index];
+            }
+        }
+        i = end;
+    }
+
+    // Send them a queue depth at a time.
+    for (int first = 0; first < sends; first += Sched.depth) {
+        int n = (sends - first < Sched.depth) ? sends - first : Sched.depth;
+        if (lcloud_xfer_batch(Send + first, n) != 0) {
+            status = -1;
+        }
+        Sched.stats.rounds++;
+    }
+    Sched.stats.dispatched += sends;
+    for (int i = 0; i < sends; i++) {
+        Sched.head[Send[i].did] = ((uint32_t)Send[i].sec << 16) | Send[i].blk;   // Each device ends at its last
+    }
+
+    // Give every transfer the outcome (and for a merged read, the data) of the one sent for it.
+    for (int i = 0; i < count; i++) {
+        LcXferBlock *sent = &Send[Sent_As[i]];
+        xfers[i].status = sent->status;
+        if (Slot[Sent_As[i]] != i && xfers[i].op == LC_XFER_READ && sent->status == 0 && xfers[i].buf != sent->buf) {
+            memcpy(xfers[i].buf, sent->buf, LC_DEVICE_BLOCK_SIZE);
+        }
+    }
+
+    lcloud_arena_reset(&Sched_Arena);
+    return status;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_sched_stats
+// Description  : Copy the statistics of the scheduler.
+//
+// Inputs       : stats - where they go
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_sched_stats( LcSchedStats *stats ) {
+    if (stats == NULL) {
+        return -1;
+    }
+    *stats = Sched.stats;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_sched_enter
+// Description  : Wait for the turn of a call.  Pair with lcloud_sched_leave.
+//
+// Inputs       : cls - the class (LC_SCHED_READ, ...)
+//                flow - the file the call is for
+//                cost - about how many blocks it moves
+//                weight - its file's share (1 to LC_SCHED_WEIGHT_MAX)
+// Outputs      : none
+void lcloud_sched_enter( int cls, int flow, uint32_t cost, int weight ) {
+    LcGateWaiter me = { 0, 0, NULL };
+    struct timespec begin, end;
+    uint64_t *finish, usec = 0;
+    int bucket = 0;
+
+    cls = (cls < 0) ? 0 : (cls >= LC_SCHED_CLASSES) ? LC_SCHED_CLASSES - 1 : cls;
+    flow = (flow < 0) ? 0 : flow % LC_SCHED_FLOWS;
+    weight = (weight < 1) ? 1 : (weight > LC_SCHED_WEIGHT_MAX) ? LC_SCHED_WEIGHT_MAX : weight;
+
+    pthread_mutex_lock(&Gate.lock);
+    finish = &Gate.finish[cls][flow];
+    me.tag = (*finish > Gate.vtime[cls]) ? *finish : Gate.vtime[cls];
+    *finish = me.tag + (uint64_t)((cost > 0) ? cost : 1) * LC_SCHED_WEIGHT_UNIT / weight;
+
+    if (Gate.busy == 0) {
+        Gate.busy = 1;
+        Gate.vtime[cls] = me.tag;
+    }
+    else {
+        LcGateWaiter **tail = &Gate.waiting[cls];
+        while (*tail != NULL) {
+            tail = &(*tail)->next;
+        }
+        *tail = &me;
+        Gate.stats[cls].waited++;
+        clock_gettime(CLOCK_MONOTONIC, &begin);
+        while (me.granted == 0) {
+            pthread_cond_wait(&Gate.turn, &Gate.lock);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        usec = (uint64_t)(end.tv_sec - begin.tv_sec) * 1000000 + (end.tv_nsec - begin.tv_nsec) / 1000;
+        while ((usec >> bucket) != 0 && bucket < 63) {
+            bucket++;
+        }
+    }
+
+    Gate.stats[cls].turns++;
+    Gate.hist[cls][bucket]++;
+    if (usec > Gate.stats[cls].max_usec) {
+        Gate.stats[cls].max_usec = usec;
+    }
+    pthread_mutex_unlock(&Gate.lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_sched_leave
+// Description  : Give the turn to the next call waiting (or open the gate).
+//
+// Inputs       : none
+// Outputs      : none
+void lcloud_sched_leave( void ) {
+    LcGateWaiter **next = NULL;
+    int pick = -1;
+
+    pthread_mutex_lock(&Gate.lock);
+    for (int c = 0; c < LC_SCHED_CLASSES; c++) {
+        if (Gate.waiting[c] == NULL) {
+            continue;
+        }
+        if (pick < 0) {
+            pick = c;
+        }
+        else if (Gate.passed[c] >= LC_SCHED_PASS) {
+            pick = c;
+            break;
+        }
+    }
+
+    if (pick < 0) {
+        Gate.busy = 0;
+    }
+    else {
+        for (int c = 0; c < LC_SCHED_CLASSES; c++) {
+            if (c != pick && Gate.waiting[c] != NULL) {
+                Gate.passed[c]++;
+            }
+        }
+        Gate.passed[pick] = 0;
+
+        // The lowest tag (the first to come of equal ones).
+        for (LcGateWaiter **w = &Gate.waiting[pick]; *w != NULL; w = &(*w)->next) {
+            if (next == NULL || (*w)->tag < (*next)->tag) {
+                next = w;
+            }
+        }
+        LcGateWaiter *granted = *next;
+        *next = granted->next;
+        Gate.vtime[pick] = granted->tag;
+        granted->granted = 1;
+        pthread_cond_broadcast(&Gate.turn);
+    }
+    pthread_mutex_unlock(&Gate.lock);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_sched_gate_stats
+// Description  : Copy how a class did at the gate.
+//
+// Inputs       : cls - the class, stats - where it goes
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_sched_gate_stats( int cls, LcGateStats *stats ) {
+    uint64_t seen = 0;
+
+    if (cls < 0 || cls >= LC_SCHED_CLASSES || stats == NULL) {
+        return -1;
+    }
+    pthread_mutex_lock(&Gate.lock);
+    *stats = Gate.stats[cls];
+    stats->p99_usec = 0;
+    for (int b = 0; b < 64 && stats->turns > 0; b++) {
+        seen += Gate.hist[cls][b];
+        if (seen * 100 >= stats->turns * 99) {
+            stats->p99_usec = (b == 0) ? 0 : (uint64_t)1 << b;
+            if (stats->p99_usec > stats->max_usec) {
+                stats->p99_usec = stats->max_usec;
+            }
+            break;
+        }
+    }
+    pthread_mutex_unlock(&Gate.lock);
+    return 0;
+}
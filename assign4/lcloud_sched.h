@@ -0,0 +1,76 @@
+#ifndef LCLOUD_SCHED_INCLUDED
+#define LCLOUD_SCHED_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_sched.h
+//  Description    : This is the block transfer scheduler of the Lion Cloud
+//                   filesystem.  A run of transfers is put in elevator order
+//                   on each device (by sector, then block, going on from
+//                   where the device was left), reads of the same block are
+//                   merged into one transfer, writes made stale by a later
+//                   write to the block are dropped, and what is left goes to
+//                   the bus a queue depth at a time.  The gate in front of
+//                   the filesystem picks whose call goes next: reads, then
+//                   writes, then background work, and fair between the
+//                   files of each class, each in proportion to its weight.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+#include <lcloud_xfer.h>
+
+// Defines
+#define LC_SCHED_DEVICES 256    // Device ids (the c1 register is 8 bits)
+#define LC_SCHED_FLOWS 2048     // Files queued fairly (a file handle modulo this)
+#define LC_SCHED_PASS 8         // Turns a waiting class gives up to the classes above it
+#define LC_SCHED_WEIGHT_MAX 16  // The largest weight of a file (its share against weight 1)
+#define LC_SCHED_WEIGHT_UNIT 720720 // Virtual time of a block at weight 1 (divisible by 1 to 16)
+
+// The priority classes (the lower goes first)
+#define LC_SCHED_READ 0         // Latency critical reads
+#define LC_SCHED_WRITE 1        // Writes and the rest of the foreground
+#define LC_SCHED_BACKGROUND 2   // Work that takes the idle time
+#define LC_SCHED_CLASSES 3
+
+// What the scheduler has done
+typedef struct {
+    uint64_t requests;      // Transfers asked for
+    uint64_t merged;        // Served by another transfer of the same block
+    uint64_t dispatched;    // Sent to the bus
+    uint64_t rounds;        // Round trips they took
+} LcSchedStats;
+
+// How one class did at the gate
+typedef struct {
+    uint64_t turns;         // Calls let in
+    uint64_t waited;        // Of them, those that found the gate taken
+    uint64_t p99_usec;      // The 99th percentile wait (to a power of two)
+    uint64_t max_usec;      // The longest wait
+} LcGateStats;
+
+//
+// Functional Prototypes
+
+void lcloud_sched_init( int depth );
+    // Set the queue depth (transfers per round trip) and forget where the devices were
+
+int lcloud_sched_submit( LcXferBlock *xfers, int count );
+    // Order, merge and send a run of transfers (each one's status is set)
+
+int lcloud_sched_stats( LcSchedStats *stats );
+    // Copy the statistics of the scheduler
+
+void lcloud_sched_enter( int cls, int flow, uint32_t cost, int weight );
+    // Wait for the turn of a call of a class from a file (cost in blocks, weight 1 to LC_SCHED_WEIGHT_MAX)
+
+void lcloud_sched_leave( void );
+    // Give the turn to the next call
+
+int lcloud_sched_gate_stats( int cls, LcGateStats *stats );
+    // Copy how a class did at the gate
+
+#endif
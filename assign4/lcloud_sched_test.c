@@ -0,0 +1,151 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_sched_test.c
+//  Description    : This is the test of the gate in front of the Lion Cloud
+//                   filesystem (lcloud_sched).  Two files kept busy in one
+//                   class must be let in by their weights, and every call
+//                   into the filesystem (lcopen and lcshutdown too) must go
+//                   through the gate.  It runs on the fake bus:
+//
+//                     make lcloud_sched_test && ./lcloud_sched_test
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+
+// Project include files
+#include <cmpsc311_log.h>
+#include <lcloud_filesys.h>
+#include <lcloud_sched.h>
+#include <lcloud_fakebus.h>
+
+// Defines
+#define TEST_CALLS 20           // Calls waiting for each busy file
+#define TEST_COUNTED 25         // Turns counted (while both files have calls left)
+
+// The turns taken, by flow, in order
+static int Test_Order[2 * TEST_CALLS];
+static int Test_Taken;
+
+// Is the filesystem switched to the gate (see lcloud_filesys.c)
+extern int Io_Priority_Enabled;
+
+// One busy file
+typedef struct {
+    int flow;       // Its file
+    int weight;     // Its share
+} TestFlow;
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_call
+// Description  : Make one call (moving one block) from a file.
+//
+// Inputs       : arg - the TestFlow
+// Outputs      : NULL
+static void * test_call( void *arg ) {
+    TestFlow *me = arg;
+
+    lcloud_sched_enter(LC_SCHED_WRITE, me->flow, 1, me->weight);
+    Test_Order[Test_Taken++] = me->flow;
+    lcloud_sched_leave();
+    return NULL;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_weights
+// Description  : Two files, weights 1 and 4, each have calls waiting at
+//                the gate.  Until the heavier runs out, it must get four
+//                turns in five (with no weights it would get one in two).
+//
+// Inputs       : none
+// Outputs      : 0 if it passed, 1 if not
+static int test_weights( void ) {
+    TestFlow light = { 11, 1 }, heavy = { 12, 4 };
+    pthread_t threads[2 * TEST_CALLS];
+    int got = 0;
+
+    // Hold the gate until all are waiting at it.
+    lcloud_sched_enter(LC_SCHED_WRITE, 0, 1, 1);
+    for (int t = 0; t < 2 * TEST_CALLS; t++) {
+        pthread_create(&threads[t], NULL, test_call, (t % 2 == 0) ? &light : &heavy);
+    }
+    for (LcGateStats stats = { 0 }; stats.waited < 2 * TEST_CALLS; ) {
+        lcloud_sched_gate_stats(LC_SCHED_WRITE, &stats);
+    }
+    lcloud_sched_leave();
+    for (int t = 0; t < 2 * TEST_CALLS; t++) {
+        pthread_join(threads[t], NULL);
+    }
+
+    for (int turn = 0; turn < TEST_COUNTED; turn++) {
+        got += (Test_Order[turn] == heavy.flow);
+    }
+    if (got != TEST_COUNTED * 4 / 5) {
+        printf("  weight 4 got %d of %d turns against weight 1\n", got, TEST_COUNTED);
+        return 1;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_every_call
+// Description  : lcopen, lcpwrite, lcclose and lcshutdown each take a turn
+//                at the gate.
+//
+// Inputs       : none
+// Outputs      : 0 if it passed, 1 if not
+static int test_every_call( void ) {
+    LcGateStats before, after;
+    char buf[100] = { 0 };
+    LcFHandle fh;
+
+    lcloud_fakebus_wipe();
+    Io_Priority_Enabled = 1;
+    lcloud_sched_gate_stats(LC_SCHED_WRITE, &before);
+    fh = lcopen("gated");
+    if (fh < 0 || lcpriority(fh, LC_PRIO_FOREGROUND, 2) != 0 || lcpwrite(fh, buf, sizeof(buf), 0) != sizeof(buf) ||
+        lcclose(fh) != 0 || lcshutdown() != 0) {
+        printf("  a call failed\n");
+        return 1;
+    }
+    lcloud_sched_gate_stats(LC_SCHED_WRITE, &after);
+    if (after.turns - before.turns != 4) {
+        printf("  %d of 4 calls went through the gate\n", (int)(after.turns - before.turns));
+        return 1;
+    }
+    if (lcpriority(fh, LC_PRIO_FOREGROUND, 0) != -1 || lcpriority(fh, LC_PRIO_FOREGROUND, LC_PRIO_WEIGHT_MAX + 1) != -1) {
+        printf("  a weight out of range was taken\n");
+        return 1;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : Run the gate tests.
+//
+// Inputs       : none
+// Outputs      : 0 if every test passed, 1 if not
+int main( void ) {
+    int failures = 0, failed;
+
+    initializeLogWithFilename("lcloud_sched_test.log");
+    setvbuf(stdout, NULL, _IONBF, 0);
+    failed = test_weights();
+    printf("weights: %s\n", failed ? "FAILED" : "passed");
+    failures += failed;
+    failed = test_every_call();
+    printf("every call through the gate: %s\n", failed ? "FAILED" : "passed");
+    failures += failed;
+    lcloud_fakebus_wipe();
+    return (failures == 0) ? 0 : 1;
+}
@@ -9,7 +9,6 @@
 //
 
 // Include Files
-#include <cmpsc311_assocarr.h>
 #include <cmpsc311_log.h>
 #include <cmpsc311_util.h>
 #include <cmpsc311_workload.h>
@@ -26,6 +25,7 @@
 #include <lcloud_controller.h>
 #include <lcloud_filesys.h>
 #include <lcloud_support.h>
+#include <lcloud_strmap.h>
 
 // Defines
 #define LCLOUD_ARGUMENTS "hvl:x:"
@@ -145,14 +145,13 @@ int simulateLionCloud(char* wload)
     workload_state state;
     workload_operation operation;
     LcFHandle fh;
-    AssocArray fhTable;
+    LcStrMap fhTable;
     char buf[LC_MAX_OPERATION_SIZE];
     int opens, reads, writes, seeks, closes;
     fsysdata* fdata;
 
-    /* Init fh table, open the workload for processing */
-    init_assoc(&fhTable, stringCompareCallback, pointerCompareCallback);
-    if (openCmpsc311Workload(&state, wload)) {
+    /* Init fh table (hashed by name), open the workload for processing */
+    if (lcloud_strmap_init(&fhTable) != 0 || openCmpsc311Workload(&state, wload)) {
         logMessage(LOG_ERROR_LEVEL, "CMPSC311 lcloud workload: failed opening workload [%s]", wload);
         return (-1);
     }
@@ -194,7 +193,7 @@ int simulateLionCloud(char* wload)
             fdata->pos = 0;
 
             /* Insert the file into the table */
-            insert_assoc(&fhTable, fdata->filename, fdata);
+            lcloud_strmap_insert(&fhTable, fdata->filename, fdata);
             logMessage(LcSimulatorLLevel, "Open file [%s]", fdata->filename);
             opens++;
             break;
@@ -202,7 +201,7 @@ int simulateLionCloud(char* wload)
         case WL_READ: /* Read a block of data from the file */
 
             /* Find the file for processing */
-            if ((fdata = find_assoc(&fhTable, operation.objname)) == NULL) {
+            if ((fdata = lcloud_strmap_find(&fhTable, operation.objname)) == NULL) {
                 logMessage(LOG_ERROR_LEVEL, "CMPSC311 error reading unknown file [%s], aborting",
                     operation.objname);
                 return (-1);
@@ -244,7 +243,7 @@ int simulateLionCloud(char* wload)
         case WL_WRITE: /* Write a block of data to the file */
 
             /* Find the file for processing */
-            if ((fdata = find_assoc(&fhTable, operation.objname)) == NULL) {
+            if ((fdata = lcloud_strmap_find(&fhTable, operation.objname)) == NULL) {
                 logMessage(LOG_ERROR_LEVEL, "CMPSC311 error writing unknown file [%s], aborting",
                     operation.objname);
                 return (-1);
@@ -278,7 +277,7 @@ int simulateLionCloud(char* wload)
         case WL_CLOSE:
 
             /* Find the file for processing */
-            if ((fdata = find_assoc(&fhTable, operation.objname)) == NULL) {
+            if ((fdata = lcloud_strmap_find(&fhTable, operation.objname)) == NULL) {
                 logMessage(LOG_ERROR_LEVEL, "CMPSC311 error closing unknown file [%s], aborting",
                     operation.objname);
                 return (-1);
@@ -293,7 +292,7 @@ int simulateLionCloud(char* wload)
 
             /* Remove file from file handle table, clean up structures, log */
             logMessage(LcSimulatorLLevel, "Closed file [%s].", fdata->filename);
-            delete_assoc(&fhTable, fdata->filename);
+            lcloud_strmap_delete(&fhTable, fdata->filename);
             free(fdata->filename);
             free(fdata);
             closes++;
@@ -319,5 +318,6 @@ int simulateLionCloud(char* wload)
 
     /* Log, close workload and delete the local file, return successfully  */
     closeCmpsc311Workload(&state);
+    lcloud_strmap_clear(&fhTable, 0, 0);
     return (0);
 }
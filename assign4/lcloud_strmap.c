@@ -0,0 +1,203 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_strmap.c
+//  Description    : This is the implementation of the string hash map used
+//                   by the Lion Cloud simulator.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdlib.h>
+#include <string.h>
+
+// Project include files
+#include <lcloud_strmap.h>
+
+// Information
+//
+// Linear probing in a power of two table.  The 64-bit hash of every key is
+// kept in its slot, so a probe only calls strcmp when the hashes match
+// (almost always the key being looked for), and growing the table does
+// not hash anything again.  A delete shifts the rest of the probe run back
+// instead of leaving a marker, so lookups never slow down as files are
+// opened and closed.
+//
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : strmap_hash
+// Description  : Hash a key (FNV-1a), never 0 (0 marks an empty slot).
+//
+// Inputs       : key - the string
+// Outputs      : the hash
+static uint64_t strmap_hash( const char *key ) {
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (const unsigned char *p = (const unsigned char *)key; *p != '\0'; p++) {
+        hash = (hash ^ *p) * 0x100000001b3ull;
+    }
+    return (hash == 0) ? 1 : hash;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : strmap_slot
+// Description  : Find the slot holding a key, or the empty slot ending its
+//                probe run.
+//
+// Inputs       : map - the map, key - the string, hash - its hash
+// Outputs      : the slot
+static int strmap_slot( LcStrMap *map, const char *key, uint64_t hash ) {
+    int mask = map->size - 1;
+    int slot = (int)(hash & mask);
+
+    while (map->slots[slot].hash != 0 &&
+           (map->slots[slot].hash != hash || strcmp(map->slots[slot].key, key) != 0)) {
+        slot = (slot + 1) & mask;
+    }
+    return slot;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : strmap_resize
+// Description  : Move the keys into a table of a new size.
+//
+// Inputs       : map - the map, size - the new number of slots
+// Outputs      : 0 if successful, -1 if failure
+static int strmap_resize( LcStrMap *map, int size ) {
+    LcStrMapSlot *old = map->slots;
+    int oldsize = map->size;
+
+    map->slots = calloc(size, sizeof(LcStrMapSlot));
+    if (map->slots == NULL) {
+        map->slots = old;
+        return -1;
+    }
+    map->size = size;
+    for (int i = 0; i < oldsize; i++) {
+        if (old[i].hash != 0) {
+            int mask = size - 1;
+            int slot = (int)(old[i].hash & mask);
+            while (map->slots[slot].hash != 0) {
+                slot = (slot + 1) & mask;
+            }
+            map->slots[slot] = old[i];
+        }
+    }
+    free(old);
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_strmap_init
+// Description  : Initialize an empty map.
+//
+// Inputs       : map - the map
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_strmap_init( LcStrMap *map ) {
+    map->count = 0;
+    map->size = LC_STRMAP_MIN_SLOTS;
+    map->slots = calloc(map->size, sizeof(LcStrMapSlot));
+    return (map->slots == NULL) ? -1 : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_strmap_insert
+// Description  : Insert a key/value, doubling the table if it gets too full.
+//                A key already in the map has its value replaced.
+//
+// Inputs       : map - the map, key - the string (kept, not copied),
+//                value - the value
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_strmap_insert( LcStrMap *map, char *key, void *value ) {
+    uint64_t hash = strmap_hash(key);
+    int slot;
+
+    if ((map->count + 1) * 100 > map->size * LC_STRMAP_LOAD_PERCENT &&
+        strmap_resize(map, map->size * 2) != 0) {
+        return -1;
+    }
+    slot = strmap_slot(map, key, hash);
+    if (map->slots[slot].hash == 0) {
+        map->count++;
+    }
+    map->slots[slot].hash = hash;
+    map->slots[slot].key = key;
+    map->slots[slot].value = value;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_strmap_find
+// Description  : Find the value for a key.
+//
+// Inputs       : map - the map, key - the string
+// Outputs      : the value, NULL if the key is not in the map
+void * lcloud_strmap_find( LcStrMap *map, const char *key ) {
+    int slot = strmap_slot(map, key, strmap_hash(key));
+
+    return (map->slots[slot].hash == 0) ? NULL : map->slots[slot].value;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_strmap_delete
+// Description  : Remove a key/value by key, moving back any later keys of
+//                the probe run that belong before the hole.
+//
+// Inputs       : map - the map, key - the string
+// Outputs      : 0 if removed, -1 if the key was not in the map
+int lcloud_strmap_delete( LcStrMap *map, const char *key ) {
+    int mask = map->size - 1;
+    int hole = strmap_slot(map, key, strmap_hash(key));
+
+    if (map->slots[hole].hash == 0) {
+        return -1;
+    }
+    for (int next = (hole + 1) & mask; map->slots[next].hash != 0; next = (next + 1) & mask) {
+        int home = (int)(map->slots[next].hash & mask);
+
+        // Move it if its home is not between the hole and where it is now.
+        if (((next - home) & mask) >= ((next - hole) & mask)) {
+            map->slots[hole] = map->slots[next];
+            hole = next;
+        }
+    }
+    map->slots[hole].hash = 0;
+    map->slots[hole].key = NULL;
+    map->slots[hole].value = NULL;
+    map->count--;
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_strmap_clear
+// Description  : Empty the map and release its table.
+//
+// Inputs       : map - the map
+//                freeKeys, freeValues - free() the keys/values as well
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_strmap_clear( LcStrMap *map, int freeKeys, int freeValues ) {
+    for (int i = 0; i < map->size; i++) {
+        if (map->slots[i].hash != 0) {
+            if (freeKeys) {
+                free(map->slots[i].key);
+            }
+            if (freeValues) {
+                free(map->slots[i].value);
+            }
+        }
+    }
+    free(map->slots);
+    map->slots = NULL;
+    map->size = 0;
+    map->count = 0;
+    return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef LCLOUD_STRMAP_INCLUDED
+#define LCLOUD_STRMAP_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_strmap.h
+//  Description    : This is a hash map from C strings to values for the Lion
+//                   Cloud simulator (open addressing, the hash of each key
+//                   kept beside it).  It takes the place of the CMPSC311
+//                   associative array for the file handle table, which is a
+//                   list searched with strcmp.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+
+// Defines
+#define LC_STRMAP_MIN_SLOTS 16      // Smallest table (a power of two)
+#define LC_STRMAP_LOAD_PERCENT 70   // The table doubles past this full
+
+// One slot of the table
+typedef struct {
+    uint64_t hash;      // The key's hash (0 if the slot is empty)
+    char *key;          // The key (not copied, as with the associative array)
+    void *value;        // The value
+} LcStrMapSlot;
+
+// The map
+typedef struct {
+    LcStrMapSlot *slots;
+    int size;           // Slots in the table (a power of two)
+    int count;          // Keys in the map
+} LcStrMap;
+
+//
+// Functional Prototypes
+
+int lcloud_strmap_init( LcStrMap *map );
+    // Initialize an empty map
+
+int lcloud_strmap_insert( LcStrMap *map, char *key, void *value );
+    // Insert a key/value (replacing the value if the key is there)
+
+void * lcloud_strmap_find( LcStrMap *map, const char *key );
+    // Find the value for a key
+
+int lcloud_strmap_delete( LcStrMap *map, const char *key );
+    // Remove a key/value by key
+
+int lcloud_strmap_clear( LcStrMap *map, int freeKeys, int freeValues );
+    // Empty the map and release its table
+
+#endif
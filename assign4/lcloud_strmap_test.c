@@ -0,0 +1,98 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_strmap_test.c
+//  Description    : This is the test of the simulator's string hash map
+//                   (lcloud_strmap).  A long run of random inserts, finds
+//                   and deletes (the table growing, and deletes shifting
+//                   probe runs back) must always agree with a plain array
+//                   of the same keys:
+//
+//                     make lcloud_strmap_test && ./lcloud_strmap_test
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <stdio.h>
+#include <stdlib.h>
+
+// Project include files
+#include <lcloud_strmap.h>
+
+// Defines
+#define TEST_KEYS 3000          // Keys the run picks from
+#define TEST_STEPS 200000       // Inserts, finds and deletes made
+
+// The keys, and the value each holds in the map (NULL if it is not in it)
+static char Test_Names[TEST_KEYS][16];
+static void *Test_Values[TEST_KEYS];
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : test_agree
+// Description  : Check every key against the map.
+//
+// Inputs       : map - the map, count - the keys that should be in it
+// Outputs      : 0 if they agree, -1 if not
+static int test_agree( LcStrMap *map, int count ) {
+    for (int k = 0; k < TEST_KEYS; k++) {
+        if (lcloud_strmap_find(map, Test_Names[k]) != Test_Values[k]) {
+            printf("  %s: the map holds %p, not %p\n", Test_Names[k], lcloud_strmap_find(map, Test_Names[k]), Test_Values[k]);
+            return -1;
+        }
+    }
+    if (map->count != count) {
+        printf("  the map holds %d keys, not %d\n", map->count, count);
+        return -1;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : main
+// Description  : Run the map test.
+//
+// Inputs       : none
+// Outputs      : 0 if it passed, 1 if not
+int main( void ) {
+    LcStrMap map;
+    int count = 0, status = 0;
+
+    for (int k = 0; k < TEST_KEYS; k++) {
+        sprintf(Test_Names[k], "file%d.dat", k);
+    }
+    srand(311);
+    if (lcloud_strmap_init(&map) != 0) {
+        printf("strmap: FAILED\n");
+        return 1;
+    }
+
+    // Mostly inserts at first (the table grows), then as many deletes.
+    for (int step = 0; step < TEST_STEPS && status == 0; step++) {
+        int k = rand() % TEST_KEYS, op = rand() % 4;
+        if (op < 2 && step < TEST_STEPS / 2) {
+            count += (Test_Values[k] == NULL);
+            Test_Values[k] = &Test_Values[k] + (step % 7);
+            status = lcloud_strmap_insert(&map, Test_Names[k], Test_Values[k]);
+        }
+        else if (op < 3) {
+            status = (lcloud_strmap_delete(&map, Test_Names[k]) == ((Test_Values[k] == NULL) ? -1 : 0)) ? 0 : -1;
+            count -= (Test_Values[k] != NULL);
+            Test_Values[k] = NULL;
+        }
+        else if (lcloud_strmap_find(&map, Test_Names[k]) != Test_Values[k]) {
+            status = -1;
+        }
+        if (status == 0 && step % 10000 == 0) {
+            status = test_agree(&map, count);
+        }
+    }
+    if (status == 0) {
+        status = test_agree(&map, count);
+    }
+    lcloud_strmap_clear(&map, 0, 0);
+    printf("strmap: %s\n", (status == 0) ? "passed" : "FAILED");
+    return (status == 0) ? 0 : 1;
+}
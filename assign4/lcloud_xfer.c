@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_xfer.c
+//  Description    : This is the implementation of the raw block transfers
+//                   for the Lion Cloud filesystem modules.
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Include files
+#include <cmpsc311_log.h>
+
+// Project include files
+#include <lcloud_xfer.h>
+#include <lcloud_network.h>
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_pack_xfer
+// Description  : Pack the registers for a block transfer (b0, b1 are 0 on
+//                a request).
+//
+// Inputs       : did, sec, blk - the physical block
+//                op - LC_XFER_READ or LC_XFER_WRITE
+// Outputs      : the packed registers
+LCloudRegisterFrame lcloud_pack_xfer( LcDeviceId did, uint16_t sec, uint16_t blk, int op ) {
+    return ((uint64_t)LC_BLOCK_XFER << 48) | ((uint64_t)did << 40) |
+           ((uint64_t)op << 32) | ((uint64_t)sec << 16) | (uint64_t)blk;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_xfer_block
+// Description  : Move one block to or from a device over the bus.
+//
+// Inputs       : did, sec, blk - the physical block
+//                op - LC_XFER_READ or LC_XFER_WRITE
+//                buf - the 256 byte block
+// Outputs      : 0 if successful, -1 if failure
+int lcloud_xfer_block( LcDeviceId did, uint16_t sec, uint16_t blk, int op, char *buf ) {
+
+    LCloudRegisterFrame reg = client_lcloud_bus_request(lcloud_pack_xfer(did, sec, blk, op), buf);
+
+    // b1 holds the return status
+    if (reg == (LCloudRegisterFrame)-1 || ((reg >> 56) & 0xF) != 1) {
+        logMessage(LOG_ERROR_LEVEL, "           ### Transfer of block [%i/%i/%i] failed", did, sec, blk);
+        return -1;
+    }
+    return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+//
+// Function     : lcloud_xfer_batch
+// Description  : Move a run of blocks to and from the devices.  Each group
+//                of LC_XFER_BATCH_MAX is sent at once and the answers read
+//                back in order, so the run waits on the bus once a group
+//                instead of once a block.
+//
+// Inputs       : xfers - the transfers
+//                count - the number of them
+// Outputs      : 0 if successful, -1 if any transfer failed
+int lcloud_xfer_batch( LcXferBlock *xfers, int count ) {
+    LCloudRegisterFrame regs[LC_XFER_BATCH_MAX];
+    char *bufs[LC_XFER_BATCH_MAX];
+    int Ret = 0;
+
+    for (int first = 0; first < count; first += LC_XFER_BATCH_MAX) {
+        int n = (count - first < LC_XFER_BATCH_MAX) ? count - first : LC_XFER_BATCH_MAX;
+
+        for (int i = 0; i < n; i++) {
+            LcXferBlock *x = &xfers[first + i];
+            regs[i] = lcloud_pack_xfer(x->did, x->sec, x->blk, x->op);
+            bufs[i] = x->buf;
+        }
+        if (client_lcloud_bus_xfer_batch(regs, bufs, n) != 0) {
+            logMessage(LOG_ERROR_LEVEL, "           ### Batch of %i transfers failed", n);
+            for (int i = first; i < count; i++) {
+                xfers[i].status = -1;
+            }
+            return -1;
+        }
+
+        // b1 holds the return status of each
+        for (int i = 0; i < n; i++) {
+            LcXferBlock *x = &xfers[first + i];
+            x->status = 0;
+            if (((regs[i] >> 56) & 0xF) != 1) {
+                logMessage(LOG_ERROR_LEVEL, "           ### Transfer of block [%i/%i/%i] failed", x->did, x->sec, x->blk);
+                x->status = -1;
+                Ret = -1;
+            }
+        }
+    }
+    return Ret;
+}
@@ -0,0 +1,44 @@
+#ifndef LCLOUD_XFER_INCLUDED
+#define LCLOUD_XFER_INCLUDED
+
+////////////////////////////////////////////////////////////////////////////////
+//
+//  File           : lcloud_xfer.h
+//  Description    : This is the raw block transfer API used by the Lion
+//                   Cloud filesystem modules that must go straight to the
+//                   bus (bypassing the cache).
+//
+//   Author        : *** John Hofbauer ***
+//   Last Modified : *** 10-19-2026 ***
+//
+
+// Includes
+#include <stdint.h>
+#include <lcloud_controller.h>
+
+// Defines
+#define LC_XFER_BATCH_MAX 16    // Most transfers sent in one round trip
+
+// One transfer of a batch
+typedef struct {
+    LcDeviceId did;     // The physical block
+    uint16_t sec;
+    uint16_t blk;
+    int op;             // LC_XFER_READ or LC_XFER_WRITE
+    char *buf;          // The 256 byte block
+    int status;         // Set to 0 if it was moved, -1 if not
+} LcXferBlock;
+
+//
+// Functional Prototypes
+
+LCloudRegisterFrame lcloud_pack_xfer( LcDeviceId did, uint16_t sec, uint16_t blk, int op );
+    // Pack the registers for a LC_BLOCK_XFER request
+
+int lcloud_xfer_block( LcDeviceId did, uint16_t sec, uint16_t blk, int op, char *buf );
+    // Move one block to or from a device
+
+int lcloud_xfer_batch( LcXferBlock *xfers, int count );
+    // Move a run of blocks, pipelined in one round trip each LC_XFER_BATCH_MAX
+
+#endif